@@ -0,0 +1,36 @@
+# opuas/cmake/BuildId.cmake
+#
+# Writes BuildId.h with a hash of the files listed in SOURCE_LIST (one path
+# per line). Run at build time, so any edit to a listed file gives a new id.
+# Paths are hashed relative to SOURCE_ROOT: the same sources give the same
+# id in any checkout or CI workspace.
+#
+# Usage: cmake -DSOURCE_LIST=<file> -DSOURCE_ROOT=<dir> -DOUTPUT=<BuildId.h> -P BuildId.cmake
+
+file(STRINGS "${SOURCE_LIST}" sources)
+set(hashes "")
+foreach(source IN LISTS sources)
+    file(SHA256 "${source}" hash)
+    file(RELATIVE_PATH name "${SOURCE_ROOT}" "${source}")
+    string(APPEND hashes "${name}:${hash}\n")
+endforeach()
+string(SHA256 id "${hashes}")
+string(SUBSTRING "${id}" 0 16 id)
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated by cmake/BuildId.cmake; do not edit.
+#ifndef BUILD_ID_H
+#define BUILD_ID_H
+
+namespace opuas {
+
+// Hash of the sources this build was compiled from.
+constexpr const char* kBuildId = \"${id}\";
+
+} // namespace opuas
+
+#endif // BUILD_ID_H
+")
+# Leave the header untouched when the id is unchanged, so nothing recompiles.
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,45 @@
+// opuas/src/AllocationCounter.cpp
+//
+// Replaces the global allocation functions so --mem-report can count them.
+// Linked into the opuas tool only, not into opuas_core: a library must not
+// take over operator new for the program that links it.
+#include "utils.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void* countedAllocation(std::size_t size) {
+    opuas::utils::noteAllocation();
+    return std::malloc(size ? size : 1);
+}
+
+} // namespace
+
+// Aligned forms keep the library's own pairing and are not counted.
+void* operator new(std::size_t size) {
+    if (void* p = countedAllocation(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* p = countedAllocation(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocation(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocation(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,12 @@
+// opuas/src/Arena.cpp
+#include "Arena.h"
+#include <utility>
+
+namespace opuas {
+
+Arena::Arena(size_t initialSize) : buffer_(initialSize, std::pmr::new_delete_resource()) {}
+
+Arena::Arena(std::shared_ptr<Arena> parent, size_t initialSize)
+    : parent_(std::move(parent)), buffer_(initialSize, parent_->resource()) {}
+
+} // namespace opuas
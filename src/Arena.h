@@ -0,0 +1,37 @@
+// opuas/src/Arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace opuas {
+
+// Monotonic memory (std::pmr) for data that dies all at once: allocation is
+// a pointer bump, deallocation does nothing and the blocks are returned when
+// the arena goes away.
+//
+// A compilation owns one arena (Program::arena) and each kernel a sub-arena
+// of it (Kernel::arena) holding the kernel's instructions. A sub-arena keeps
+// its parent alive, so kernels can move between programs. Passes give their
+// scratch data a local Arena that is freed when the pass returns.
+class Arena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    explicit Arena(size_t initialSize = kDefaultBlockSize);
+    Arena(std::shared_ptr<Arena> parent, size_t initialSize);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &buffer_; }
+
+private:
+    std::shared_ptr<Arena> parent_;
+    std::pmr::monotonic_buffer_resource buffer_;
+};
+
+} // namespace opuas
+
+#endif // ARENA_H
@@ -1,70 +1,146 @@
 // opuas/src/CodeGenerator.cpp
 #include "CodeGenerator.h"
-#include "Parser.h" // To access the parse tree
-#include "utils.h" // For mapPtxOperandToCoasm if needed, or similar helpers
+#include "Arena.h"
+#include "OpuEncoding.h"
+#include "ElfFormat.h"
+#include "utils.h"
 #include <iostream>
 #include <sstream>
 #include <map>
 #include <vector>
+#include <algorithm>
 #include <cstdint>
 
 namespace opuas {
 
-CodeGenerator::CodeGenerator(Parser* parser) : parser_(parser) {
-    if (!parser_) {
-        throw std::invalid_argument("CodeGenerator: Parser pointer cannot be null.");
-    }
-}
+CodeGenerator::CodeGenerator(Program& program) : program_(&program) {}
 
 bool CodeGenerator::generate() {
-    if (!parser_->getParseTree()) {
-        std::cerr << "CodeGenerator Error: No valid parse tree available. Has parsing succeeded?\n";
-        return false;
+    Program& program = *program_;
+    std::clog << "CodeGenerator Info: Encoding " << program.kernels.size() << " kernel(s)...\n";
+
+    codeSegments_.clear();
+    codeObject_ = elf::CodeObject();
+    codeObject_.version = program.version;
+
+    bool ok = true;
+    for (const Kernel& kernel : program.kernels) {
+        elf::KernelCode code;
+        if (!encodeKernel(kernel, code)) {
+            ok = false;
+            continue;
+        }
+        codeSegments_[kernel.name] = code.code;
+        codeObject_.kernels.push_back(std::move(code));
     }
 
-    std::cout << "CodeGenerator Info: Starting code generation from parse tree...\n";
-
-    // --- Core Generation Logic ---
-    // This is where the heavy lifting happens.
-    // You would traverse the parseTree (parser_->getParseTree()) using a Visitor or Listener.
-    // For each instruction node (e.g., AddStatementContext, LdStatementContext),
-    // you would:
-    // 1. Identify the instruction opcode.
-    // 2. Map PTX/CASM operands to COASM operands (using utils::mapPtxOperandToCoasm or similar).
-    // 3. Look up instruction format and encoding details from coasm_infra data (e.g., opcodes.def).
-    // 4. Encode operands into the instruction's bit fields.
-    // 5. Store the resulting uint32_t/uint64_t machine code word(s) in codeSegments_.
-
-    // Placeholder: Simulate successful generation by creating dummy segments.
-    // In reality, this would be driven by traversing parser_->getParseTree().
-    std::vector<uint32_t> dummySegment1 = {0xDEADBEEF, 0xC0FFEE00, 0x12345678};
-    std::vector<uint32_t> dummySegment2 = {0x87654321, 0x00EEFF0C};
-
-    codeSegments_["dummy_text_segment_1"] = dummySegment1;
-    codeSegments_["dummy_text_segment_2"] = dummySegment2;
-
-    // Placeholder: Collect metadata
-    metadata_[".shared_memsize"] = 128;
-    metadata_[".kernel_ctrl"] = 7; // Example value
-    // ... collect other metadata ...
-
-    std::cout << "CodeGenerator Info: Code generation completed (placeholder logic).\n";
-    return true; // Indicate success (or failure based on actual logic)
+    if (ok) std::clog << "CodeGenerator Info: Code generation completed.\n";
+    return ok;
 }
 
 const std::map<std::string, std::vector<uint32_t>>& CodeGenerator::getCodeSegments() const {
     return codeSegments_;
 }
 
-const std::map<std::string, int>& CodeGenerator::getMetadata() const {
-    return metadata_;
+const elf::CodeObject& CodeGenerator::getCodeObject() const {
+    return codeObject_;
+}
+
+namespace {
+
+// Kernel argument names are assembly-time constants; substitute them first
+// so they take the same (inline or literal) form as a plain immediate. The
+// copies' operands come from `resource`.
+std::vector<Instruction> substituteArgs(const Kernel& kernel, std::pmr::memory_resource* resource) {
+    std::vector<Instruction> insts;
+    insts.reserve(kernel.instructions.size());
+    for (const Instruction& original : kernel.instructions) {
+        Instruction& inst = insts.emplace_back(resource);
+        inst = original;
+        for (Operand& operand : inst.operands) {
+            if (operand.kind != OperandKind::Symbol || kernel.labels.count(operand.symbol)) continue;
+            if (const KernelArg* arg = kernel.findArg(operand.symbol)) {
+                operand.kind = OperandKind::Imm;
+                operand.imm = arg->offset;
+            }
+        }
+    }
+    return insts;
+}
+
+std::vector<uint32_t> layoutOffsets(const std::vector<Instruction>& insts) {
+    std::vector<uint32_t> offsets(insts.size() + 1, 0);
+    for (size_t i = 0; i < insts.size(); ++i) {
+        offsets[i + 1] = offsets[i] + static_cast<uint32_t>(isa::encodedSize(insts[i]) * sizeof(uint32_t));
+    }
+    return offsets;
+}
+
+} // namespace
+
+std::vector<uint32_t> CodeGenerator::instructionOffsets(const Kernel& kernel) {
+    Arena scratch;
+    return layoutOffsets(substituteArgs(kernel, scratch.resource()));
 }
 
-// --- Helper functions for actual code generation would go here ---
-// e.g.,
-// uint32_t encodeAddInstruction(const std::string& dst, const std::string& src1, const std::string& src2, const std::string& typeSuffix);
-// void processKernelNode(coasmParser::KernelContext* ctx);
-// void processAddStatementNode(coasmParser::AddStatementContext* ctx);
-// ...
+bool CodeGenerator::encodeKernel(const Kernel& kernel, elf::KernelCode& out) {
+    out = elf::KernelCode();
+    out.name = kernel.name;
+    out.args = kernel.args;
+
+    Arena scratch;
+    std::vector<Instruction> insts = substituteArgs(kernel, scratch.resource());
+
+    // Layout: byte offset of every instruction and label.
+    std::vector<uint32_t> offsets = layoutOffsets(insts);
+
+    bool ok = true;
+    for (size_t i = 0; i < insts.size(); ++i) {
+        const Instruction& inst = insts[i];
+        uint32_t symbolValue = 0;
+        for (const Operand& operand : inst.operands) {
+            if (operand.kind != OperandKind::Symbol) continue;
+            auto label = kernel.labels.find(operand.symbol);
+            if (label != kernel.labels.end()) {
+                symbolValue = offsets[label->second];
+            } else {
+                // Literal word is the last word of the instruction.
+                elf::Relocation reloc;
+                reloc.offset = offsets[i + 1] - sizeof(uint32_t);
+                reloc.symbol = operand.symbol;
+                reloc.type = R_OPU_ABS32;
+                out.relocations.push_back(reloc);
+            }
+        }
+
+        std::string message;
+        if (!isa::encodeInstruction(inst, symbolValue, out.code, message)) {
+            std::cerr << "CodeGenerator Error: line " << inst.line << ": cannot encode '"
+                      << formatInstruction(inst) << "' in kernel '" << kernel.name << "': " << message << "\n";
+            ok = false;
+        }
+    }
+
+    std::vector<std::string> unknownKeys;
+    out.descriptor = elf::KernelDescriptor::fromMetadata(kernel.metadata, &unknownKeys);
+    for (const std::string& key : unknownKeys) {
+        utils::logWarning("Kernel '" + kernel.name + "': metadata key '" + key + "' is not stored in the object.");
+    }
+
+    // Register footprint for the loader.
+    for (const Instruction& inst : insts) {
+        for (const Operand& operand : inst.operands) {
+            uint32_t next = static_cast<uint32_t>(operand.reg) + 1;
+            switch (operand.kind) {
+                case OperandKind::VReg:   out.descriptor.vregCount = std::max(out.descriptor.vregCount, next); break;
+                case OperandKind::VReg64: out.descriptor.vregCount = std::max(out.descriptor.vregCount, next + 1); break;
+                case OperandKind::SReg:   out.descriptor.sregCount = std::max(out.descriptor.sregCount, next); break;
+                case OperandKind::PReg:   out.descriptor.pregCount = std::max(out.descriptor.pregCount, next); break;
+                default: break;
+            }
+        }
+    }
+    return ok;
+}
 
 } // namespace opuas
@@ -0,0 +1,40 @@
+// opuas/src/CodeGenerator.h
+#ifndef CODE_GENERATOR_H
+#define CODE_GENERATOR_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "CodeObject.h"
+
+namespace opuas {
+
+// Encodes the lowered program into machine code and kernel descriptors.
+// Expects stalls to be set (StallSetter) before generate() runs.
+class CodeGenerator {
+public:
+    explicit CodeGenerator(Program& program);
+
+    bool generate();
+    const std::map<std::string, std::vector<uint32_t>>& getCodeSegments() const;
+    const elf::CodeObject& getCodeObject() const;
+
+    // Encode a single kernel: resolves labels to kernel-relative byte offsets,
+    // kernel argument names to their offsets, and records a relocation for
+    // any other symbol.
+    static bool encodeKernel(const Kernel& kernel, elf::KernelCode& out);
+    // Byte offset of every instruction as encodeKernel lays it out, plus the
+    // end of the code as the last element.
+    static std::vector<uint32_t> instructionOffsets(const Kernel& kernel);
+
+private:
+    Program* program_;
+    std::map<std::string, std::vector<uint32_t>> codeSegments_;
+    elf::CodeObject codeObject_;
+};
+
+} // namespace opuas
+
+#endif // CODE_GENERATOR_H
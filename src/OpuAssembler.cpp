@@ -1,62 +1,650 @@
 // opuas/src/OpuAssembler.cpp
 
 #include "OpuAssembler.h"
-#include "Validator.h" // Our validator using coasm_infra's parser
+#include "Parser.h"
+#include "Program.h"
+#include "StallSetter.h"
+#include "RegisterAllocator.h"
+#include "PerfModel.h"
+#include "CodeGenerator.h"
+#include "ElfObjectWriter.h"
+#include "BlockLayout.h"
+#include "ExecutionProfile.h"
+#include "SourceIndex.h"
+#include "ElfObjectReader.h"
+#include "MappedFile.h"
+#include "BuildId.h" // Generated by CMake (cmake/BuildId.cmake)
+#include "utils.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <map>
+#include <set>
+#include <string_view>
+#include <thread>
 
-OpuAssembler::OpuAssembler(const std::string& input, const std::string& output)
-    : inputFile(input), outputFile(output) {}
+namespace {
+
+// Below this the ANTLR parse takes a few milliseconds and threads only add
+// overhead.
+constexpr size_t kParallelParseMinBytes = 256 * 1024;
+
+template <typename T>
+void mix(uint64_t& hash, const T& value) {
+    hash = opuas::utils::hash64(&value, sizeof(value), hash);
+}
+
+void mix(uint64_t& hash, const std::string& text) {
+    mix(hash, text.size());
+    hash = opuas::utils::hash64(text.data(), text.size(), hash);
+}
+
+// Identifies what a kernel is assembled from, for --incremental. The lowered
+// kernel is hashed rather than its text, so formatting, comments, label
+// names and line numbers do not count, and the disassembly of an object
+// fingerprints like the source it came from: branch targets are hashed as
+// instruction indices and argument names as their offsets, which is how the
+// listing writes them, immediates are taken as the 32 bits encoded, and
+// metadata set to 0 is the same as none.
+uint64_t fingerprintKernel(const opuas::Kernel& kernel, const std::vector<int>& version, uint64_t seed) {
+    uint64_t hash = seed;
+    mix(hash, kernel.name);
+    mix(hash, version.size());
+    for (int part : version) mix(hash, part);
+    mix(hash, kernel.args.size());
+    for (const opuas::KernelArg& arg : kernel.args) {
+        mix(hash, arg.name);
+        mix(hash, arg.addressSpace);
+        mix(hash, arg.valueKind);
+        mix(hash, arg.offset);
+        mix(hash, arg.size);
+    }
+    for (const auto& [key, value] : kernel.metadata) {
+        if (value == 0) continue;
+        mix(hash, key);
+        mix(hash, value);
+    }
+    mix(hash, kernel.instructions.size());
+    for (const opuas::Instruction& inst : kernel.instructions) {
+        mix(hash, inst.opcode);
+        mix(hash, inst.type);
+        mix(hash, inst.modifier);
+        mix(hash, inst.stall);
+        mix(hash, inst.wait);
+        mix(hash, inst.operands.size());
+        for (const opuas::Operand& operand : inst.operands) {
+            opuas::OperandKind kind = operand.kind;
+            int64_t imm = operand.imm;
+            if (kind == opuas::OperandKind::Symbol) {
+                auto label = kernel.labels.find(operand.symbol);
+                const opuas::KernelArg* arg = kernel.findArg(operand.symbol);
+                if (label != kernel.labels.end()) {
+                    imm = static_cast<int64_t>(label->second);
+                } else if (arg) {
+                    kind = opuas::OperandKind::Imm;
+                    imm = arg->offset;
+                } else {
+                    mix(hash, operand.symbol); // Another kernel or an external symbol
+                }
+            }
+            mix(hash, kind);
+            mix(hash, operand.reg);
+            mix(hash, static_cast<uint32_t>(imm)); // As encoded: -1 and 0xffffffff are one literal
+        }
+    }
+    return hash ? hash : 1; // 0 means unknown
+}
+
+// Taken before the passes rewrite the kernels.
+std::map<std::string, uint64_t> fingerprintKernels(const opuas::Program& program, uint64_t seed) {
+    std::map<std::string, uint64_t> fingerprints;
+    for (const opuas::Kernel& kernel : program.kernels) {
+        fingerprints[kernel.name] = fingerprintKernel(kernel, program.version, seed);
+    }
+    return fingerprints;
+}
+
+void setFingerprints(const std::map<std::string, uint64_t>& fingerprints, opuas::elf::CodeObject& object) {
+    for (opuas::elf::KernelCode& kernel : object.kernels) {
+        auto fingerprint = fingerprints.find(kernel.name);
+        if (fingerprint != fingerprints.end()) kernel.fingerprint = fingerprint->second;
+    }
+}
+
+} // namespace
+
+OpuAssembler::OpuAssembler(const std::string& input, const std::string& output, const AssemblerOptions& options)
+    : inputFile(input), outputFile(output), options(options) {}
 
 bool OpuAssembler::assemble() {
-    std::cout << "Loading COASM file '" << inputFile << "' for assembly...\n";
+    if (options.streaming || !options.incrementalBase.empty()) return assembleChunked();
 
-    std::ifstream inFile(inputFile);
-    if (!inFile.is_open()) {
-        std::cerr << "Error: Could not open input file " << inputFile << std::endl;
+    opuas::elf::CodeObject object;
+    if (!buildCodeObject(object)) return false;
+
+    // Write ELF object file (elf/ElfObjectWriter)
+    try {
+        opuas::elf::ElfObjectWriter writer(outputFile, options.deduplicate);
+        if (!writer.write(object)) return false;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return false;
     }
+    reportMemory("object writer");
 
-    // Read the entire file content into a string
-    std::stringstream buffer;
-    buffer << inFile.rdbuf();
-    std::string coasmCode = buffer.str();
-    inFile.close();
+    std::clog << "Info: Assembly process completed successfully.\n";
+    return true;
+}
+
+bool OpuAssembler::buildCodeObject(opuas::elf::CodeObject& object) {
+    std::clog << "Loading COASM file '" << inputFile << "' for assembly...\n";
+    allocationMark = opuas::utils::allocationCount();
+
+    // Map the file rather than copying it; empty files cannot be mapped.
+    opuas::elf::MappedFile mapped;
+    std::string buffer;
+    std::string_view coasmCode;
+    if (mapped.open(inputFile)) {
+        coasmCode = std::string_view(mapped.data(), mapped.size());
+    } else if (opuas::utils::readFileToString(inputFile, buffer)) {
+        coasmCode = buffer;
+    } else {
+        std::cerr << "Error: Could not open input file " << inputFile << std::endl;
+        return false;
+    }
 
     if (coasmCode.empty()) {
         std::cerr << "Error: Input COASM file is empty.\n";
         return false;
     }
 
-    std::cout << "Validating COASM syntax using coasm_infra parser...\n";
+    std::clog << "Parsing COASM using coasm_infra parser...\n";
     // --- Core Integration Point ---
-    // Use the Validator class which wraps coasm_infra's generated ANTLR parser
-    if (!validateCoasmSyntax(coasmCode)) {
+    // The Parser checks syntax with coasm_infra's generated ANTLR parser and
+    // lowers the source into opuas's internal representation. Large inputs
+    // are split at kernel boundaries and the pieces parsed on worker threads.
+    opuas::SourceIndex index(inputFile);
+    opuas::Program program;
+    const bool parallel = options.threads != 1 && coasmCode.size() >= kParallelParseMinBytes;
+    const bool indexed = parallel && index.scan(coasmCode);
+    bool parsed;
+    if (indexed && index.getChunks().size() > 1) {
+        parsed = parseChunks(coasmCode, index, program);
+    } else {
+        opuas::Parser parser(std::string(coasmCode), inputFile);
+        parsed = parser.parse();
+        if (parsed) program = std::move(parser.getProgram());
+    }
+    if (!parsed) {
         std::cerr << "Validation Error: COASM syntax is invalid according to coasm_infra parser.\n";
         return false; // Fail assembly if syntax is wrong
     } else {
-        std::cout << "Validation Info: COASM syntax is valid.\n";
+        std::clog << "Validation Info: COASM syntax is valid.\n";
+    }
+    reportMemory("front end");
+
+    opuas::sim::ExecutionProfile profile;
+    const bool useProfile = !options.layoutProfileFile.empty();
+    if (useProfile && !loadLayoutProfile(profile)) return false;
+
+    const std::map<std::string, uint64_t> fingerprints = fingerprintKernels(program, fingerprintSeed());
+    std::vector<opuas::algorithms::KernelPerf> perf;
+    if (!runPasses(program, useProfile ? &profile : nullptr, perf, object)) return false;
+    reportMemory("passes");
+    setFingerprints(fingerprints, object);
+    if (!options.perfReportFormat.empty() && !writePerfReport(perf)) return false;
+    return true;
+}
+
+// Each chunk carries the declarations, metadata and opu.version it needs
+// (SourceIndex), so chunks parse independently; their kernels are then
+// joined in file order. Diagnostics are collected per chunk and printed in
+// file order afterwards. Lines shared by every chunk would report the same
+// problem once per chunk, so repeated messages are printed once.
+bool OpuAssembler::parseChunks(std::string_view coasmCode, const opuas::SourceIndex& index,
+                               opuas::Program& program) {
+    const size_t chunkCount = index.getChunks().size();
+    std::vector<opuas::Program> programs(chunkCount);
+    std::vector<std::string> diagnostics(chunkCount);
+    std::vector<char> ok(chunkCount, 0);
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next++; i < chunkCount; i = next++) {
+            std::vector<opuas::SourceChunk> source;
+            if (!index.chunkSource(coasmCode, i, source)) {
+                diagnostics[i] = "Error: Could not split '" + inputFile + "' for parsing.\n";
+                continue;
+            }
+            std::ostringstream messages;
+            opuas::Parser parser(source, inputFile);
+            source.clear();
+            parser.setDiagnostics(messages);
+            ok[i] = parser.parse();
+            if (ok[i]) programs[i] = std::move(parser.getProgram());
+            diagnostics[i] = messages.str();
+        }
+    };
+    unsigned workers = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = static_cast<unsigned>(std::min<size_t>(workers, chunkCount));
+    if (workers <= 1) {
+        work();
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < workers; ++t) pool.emplace_back(work);
+        for (std::thread& thread : pool) thread.join();
+    }
+
+    std::set<std::string> printed;
+    for (const std::string& messages : diagnostics) {
+        std::istringstream lines(messages);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (printed.insert(line).second) std::cerr << line << std::endl;
+        }
+    }
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) return false;
+
+    for (opuas::Program& piece : programs) {
+        for (opuas::Kernel& kernel : piece.kernels) program.kernels.push_back(std::move(kernel));
+        if (program.version.empty()) program.version = std::move(piece.version);
+    }
+    std::clog << "Info: Parsed " << chunkCount << " chunk(s) on " << workers << " thread(s).\n";
+    return true;
+}
+
+// The input is indexed in one pass, then each chunk (normally one kernel) is
+// read back, parsed, run through the passes and appended to the object
+// before the next one is read. Only the index, per-kernel metadata and the
+// perf report outlive a chunk. With --incremental, a chunk whose kernels
+// fingerprint like the previous object's is still parsed, but its kernels
+// are copied from there instead of going through the passes.
+bool OpuAssembler::assembleChunked() {
+    std::clog << "Indexing COASM file '" << inputFile << "' for "
+              << (options.streaming ? "streaming" : "incremental") << " assembly...\n";
+    allocationMark = opuas::utils::allocationCount();
+
+    std::ifstream inFile(inputFile, std::ios::binary);
+    if (!inFile.is_open()) {
+        std::cerr << "Error: Could not open input file " << inputFile << std::endl;
+        return false;
+    }
+    opuas::SourceIndex index(inputFile);
+    if (!index.scan(inFile)) return false;
+    const std::vector<opuas::KernelChunk>& chunks = index.getChunks();
+
+    opuas::sim::ExecutionProfile profile;
+    const bool useProfile = !options.layoutProfileFile.empty();
+    if (useProfile && !loadLayoutProfile(profile)) return false;
+    const uint64_t seed = fingerprintSeed();
+
+    // Read before the output, often the same file, is truncated.
+    opuas::elf::CodeObject previous;
+    std::map<std::string, size_t> previousKernels;
+    if (!options.incrementalBase.empty() && loadPreviousObject(previous)) {
+        for (size_t k = 0; k < previous.kernels.size(); ++k) previousKernels[previous.kernels[k].name] = k;
+    }
+
+    std::vector<opuas::algorithms::KernelPerf> perf;
+    std::vector<int> version;
+    size_t kernelCount = 0, reused = 0;
+    uint64_t largestChunk = 0;
+    try {
+        opuas::elf::ElfObjectWriter writer(outputFile, options.deduplicate);
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            std::vector<opuas::SourceChunk> source;
+            if (!index.chunkSource(inFile, i, source)) return false;
+            uint64_t chunkSize = 0;
+            for (const opuas::SourceChunk& piece : source) chunkSize += piece.text.size();
+            largestChunk = std::max(largestChunk, chunkSize);
+
+            opuas::Parser parser(source, inputFile);
+            source.clear();
+            if (!parser.parse()) {
+                std::cerr << "Validation Error: COASM syntax is invalid according to coasm_infra parser.\n";
+                return false;
+            }
+            opuas::Program& program = parser.getProgram();
+            const std::map<std::string, uint64_t> fingerprints = fingerprintKernels(program, seed);
+
+            bool unchanged = !program.kernels.empty();
+            for (const auto& [name, fingerprint] : fingerprints) {
+                auto match = previousKernels.find(name);
+                unchanged = unchanged && match != previousKernels.end() &&
+                            previous.kernels[match->second].fingerprint == fingerprint;
+            }
+            if (unchanged) {
+                for (const opuas::Kernel& kernel : program.kernels) {
+                    if (!writer.addKernel(previous.kernels[previousKernels[kernel.name]])) return false;
+                }
+                kernelCount += program.kernels.size();
+                reused += program.kernels.size();
+                version = previous.version;
+                continue;
+            }
+
+            opuas::elf::CodeObject object;
+            if (!runPasses(program, useProfile ? &profile : nullptr, perf, object)) return false;
+            setFingerprints(fingerprints, object);
+            for (const opuas::elf::KernelCode& kernel : object.kernels) {
+                if (!writer.addKernel(kernel)) return false;
+            }
+            kernelCount += object.kernels.size();
+            version = object.version;
+        }
+        if (!writer.finish(version)) return false;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    if (options.streaming) {
+        std::clog << "Info: Streamed " << kernelCount << " kernel(s) in " << chunks.size()
+                  << " chunk(s); largest chunk " << largestChunk << " bytes of source.\n";
+    }
+    if (!options.incrementalBase.empty()) {
+        std::clog << "Info: Incremental: " << reused << " kernel(s) reused from '" << options.incrementalBase
+                  << "', " << (kernelCount - reused) << " reassembled.\n";
+    }
+    reportMemory("assembly");
+    if (!options.perfReportFormat.empty() && !writePerfReport(perf)) return false;
+    std::clog << "Info: Assembly process completed successfully.\n";
+    return true;
+}
+
+bool OpuAssembler::loadPreviousObject(opuas::elf::CodeObject& previous) {
+    if (!options.perfReportFormat.empty()) {
+        std::clog << "Info: The performance report needs every kernel analyzed; nothing is reused.\n";
+        return false;
+    }
+    if (!opuas::utils::pathExists(options.incrementalBase)) {
+        std::clog << "Info: No previous object '" << options.incrementalBase << "'; assembling every kernel.\n";
+        return false;
+    }
+    try {
+        opuas::elf::ElfObjectReader reader(options.incrementalBase);
+        if (!reader.read()) {
+            std::cerr << "Warning: Could not read previous object '" << options.incrementalBase
+                      << "'; assembling every kernel.\n";
+            return false;
+        }
+        previous = reader.getCodeObject();
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << "; assembling every kernel.\n";
+        return false;
+    }
+    return true;
+}
+
+uint64_t OpuAssembler::fingerprintSeed() const {
+    // Anything besides the source that changes the output goes in here,
+    // starting with the assembler's own code (BuildId.h, from CMake).
+    const std::string version = std::string("opuas ") + opuas::kBuildId;
+    uint64_t seed = opuas::utils::hash64(version.data(), version.size());
+    const std::string budget = std::to_string(options.maxRegs) + "/" + std::to_string(options.targetOccupancy) +
+                               (options.autoRegisterLimit ? "/auto" : "");
+    if (budget != "0/0") seed = opuas::utils::hash64(budget.data(), budget.size(), seed);
+    std::string profile;
+    if (!options.layoutProfileFile.empty() && opuas::utils::readFileToString(options.layoutProfileFile, profile)) {
+        seed = opuas::utils::hash64(profile.data(), profile.size(), seed);
+    }
+    return seed;
+}
+
+bool OpuAssembler::runPasses(opuas::Program& program, const opuas::sim::ExecutionProfile* profile,
+                             std::vector<opuas::algorithms::KernelPerf>& perf, opuas::elf::CodeObject& object) {
+    // Fit %v registers to their budgets (algorithms/RegisterAllocator), so
+    // that stalls and the report see the spill code and the new pressure.
+    // This runs first: a profile was taken from an object built with the
+    // same budgets, so its PCs count the spill code too.
+    if (!applyRegisterBudgets(program)) {
+        return false;
+    }
+
+    // Profile-guided block layout runs before stalls so that labels and
+    // stalls are computed for the final instruction order.
+    if (profile && !applyBlockLayout(program, *profile)) {
+        return false;
+    }
+
+    // Analyze dependencies/stalls (algorithms/StallSetter)
+    for (opuas::Kernel& kernel : program.kernels) {
+        opuas::algorithms::StallSetter stallSetter(kernel);
+        if (!stallSetter.analyzeAndSet()) {
+            std::cerr << "Error: Stall analysis failed for kernel '" << kernel.name << "'.\n";
+            return false;
+        }
+    }
+
+    if (!options.perfReportFormat.empty()) {
+        opuas::algorithms::PerfModel model;
+        for (const opuas::Kernel& kernel : program.kernels) {
+            perf.push_back(model.analyze(kernel));
+        }
+    }
+
+    // Generate machine code and kernel descriptors (CodeGenerator)
+    opuas::CodeGenerator codegen(program);
+    if (!codegen.generate()) {
+        std::cerr << "Error: Code generation failed.\n";
+        return false;
+    }
+    object = codegen.getCodeObject();
+    return true;
+}
+
+void OpuAssembler::reportMemory(const std::string& phase) {
+    if (!options.memoryReport) return;
+    const uint64_t count = opuas::utils::allocationCount();
+    std::clog << "Memory Info: " << phase << ": " << (count - allocationMark) << " allocation(s), peak RSS "
+              << opuas::utils::peakResidentBytes() / 1024 << " KiB\n";
+    allocationMark = opuas::utils::allocationCount();
+}
+
+bool OpuAssembler::writePerfReport(const std::vector<opuas::algorithms::KernelPerf>& kernels) {
+    std::string report;
+    if (options.perfReportFormat == "json") {
+        report = opuas::algorithms::PerfModel::toJson(kernels);
+    } else if (options.perfReportFormat == "text") {
+        report = opuas::algorithms::PerfModel::toText(kernels);
+    } else {
+        std::cerr << "Error: Unknown performance report format '" << options.perfReportFormat << "'.\n";
+        return false;
     }
 
-    // --- Placeholder for subsequent steps ---
-    // 1. Parse the COASM code into an AST (using our own Parser or coasm_infra's visitor/listener)
-    // 2. Perform semantic analysis (resolve symbols, check types, etc.)
-    // 3. Allocate registers (algorithms/RegisterAllocator)
-    // 4. Analyze dependencies/stalls (algorithms/StallSetter)
-    // 5. Generate machine code (CodeGenerator)
-    // 6. Write ELF object file (elf/ElfObjectWriter)
-    std::cout << "Info: Assembly process (validation only) completed successfully.\n";
-    std::cout << "Info: Full assembly pipeline (codegen, ELF writing) is not yet implemented.\n";
+    // Progress and info lines go to std::clog, so stdout holds only the report.
+    if (options.perfReportFile.empty()) {
+        std::cout << report;
+        return true;
+    }
+    std::ofstream reportFile(options.perfReportFile);
+    if (!reportFile.is_open()) {
+        std::cerr << "Error: Could not open performance report file " << options.perfReportFile << std::endl;
+        return false;
+    }
+    reportFile << report;
+    return true;
+}
 
-    // For testing purposes, just write the validated code to the output file
-    std::ofstream outFile(outputFile);
-    if (!outFile.is_open()) {
-        std::cerr << "Error: Could not open output file " << outputFile << std::endl;
+bool OpuAssembler::loadLayoutProfile(opuas::sim::ExecutionProfile& profile) {
+    std::ifstream profileFile(options.layoutProfileFile);
+    if (!profileFile.is_open()) {
+        std::cerr << "Error: Could not open profile file " << options.layoutProfileFile << std::endl;
         return false;
     }
-    outFile << coasmCode; // Echo input to output for now
-    outFile.close();
+    std::stringstream buffer;
+    buffer << profileFile.rdbuf();
+    std::string message;
+    if (!opuas::sim::ExecutionProfile::parse(buffer.str(), profile, message)) {
+        std::cerr << "Error: " << options.layoutProfileFile << ": " << message << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Per kernel, .max_regs or .target_occupancy in opu.kernels overrides the
+// command line. Neither key goes into the object; the limit the kernel was
+// allocated for is kept in .kernel_ctrl instead.
+bool OpuAssembler::applyRegisterBudgets(opuas::Program& program) {
+    const opuas::isa::TargetInfo& target = opuas::isa::getTargetInfo();
+    auto occupancyLimit = [&](const opuas::Kernel& kernel, int64_t waves) {
+        const int maxWaves = target.simdsPerCU * target.maxWavesPerSimd;
+        if (waves > maxWaves) {
+            std::cerr << "Warning: Kernel '" << kernel.name << "': target occupancy " << waves
+                      << " waves/CU is above the hardware limit of " << maxWaves << ".\n";
+            waves = maxWaves;
+        }
+        const int64_t wavesPerSimd = (waves + target.simdsPerCU - 1) / target.simdsPerCU;
+        const int64_t regs = target.vregsPerSimd / wavesPerSimd / target.vregGranule * target.vregGranule;
+        return static_cast<int>(std::min<int64_t>(regs, opuas::isa::kMaxVRegs));
+    };
+
+    for (opuas::Kernel& kernel : program.kernels) {
+        const int64_t maxRegs = kernel.getMetadata(".max_regs");
+        const int64_t occupancy = kernel.getMetadata(".target_occupancy");
+        kernel.metadata.erase(".max_regs");
+        kernel.metadata.erase(".target_occupancy");
+
+        int limit = 0;
+        std::string reason;
+        if (maxRegs > 0) {
+            limit = static_cast<int>(std::min<int64_t>(maxRegs, INT_MAX));
+            reason = ".max_regs";
+        } else if (occupancy > 0) {
+            limit = occupancyLimit(kernel, occupancy);
+            reason = ".target_occupancy " + std::to_string(occupancy);
+        } else if (options.maxRegs > 0) {
+            limit = options.maxRegs;
+            reason = "--max-regs";
+        } else if (options.targetOccupancy > 0) {
+            limit = occupancyLimit(kernel, options.targetOccupancy);
+            reason = "--target-occupancy " + std::to_string(options.targetOccupancy);
+        } else if (options.autoRegisterLimit) {
+            limit = chooseRegisterLimit(kernel);
+            reason = "auto";
+        } else {
+            continue;
+        }
+        if (limit == 0) continue; // No %v registers to budget
+
+        opuas::algorithms::RegisterAllocator allocator(kernel);
+        if (!allocator.allocate(limit)) {
+            std::cerr << "Error: Kernel '" << kernel.name << "' (" << reason << "): " << allocator.getError() << ".\n";
+            return false;
+        }
+        const opuas::algorithms::AllocationResult& result = allocator.getResult();
+        const uint32_t ctrl = static_cast<uint32_t>(kernel.getMetadata(".kernel_ctrl"));
+        kernel.metadata[".kernel_ctrl"] = (ctrl & ~opuas::isa::kKernelCtrlRegLimitMask) |
+                                          (static_cast<uint32_t>(limit) << opuas::isa::kKernelCtrlRegLimitShift);
+        if (result.registersBefore > limit) {
+            std::clog << "Info: Kernel '" << kernel.name << "': %v limit " << limit << " (" << reason << "), "
+                      << result.registersBefore << " -> " << result.registersAfter << " registers";
+            if (result.spilled || result.rematerialized) {
+                std::clog << ", " << result.spilled << " value(s) spilled (" << result.spillBytes
+                          << " bytes of private memory), " << result.rematerialized << " rematerialized";
+            }
+            std::clog << ".\n";
+        }
+    }
+    return true;
+}
+
+// Try the %v limit of every occupancy step below the kernel's footprint and
+// keep the one the static model expects to finish the most waves.
+int OpuAssembler::chooseRegisterLimit(const opuas::Kernel& kernel) {
+    const opuas::isa::TargetInfo& target = opuas::isa::getTargetInfo();
+    opuas::algorithms::PerfModel model;
+    auto estimate = [&](opuas::Kernel& trial) {
+        opuas::algorithms::StallSetter stallSetter(trial);
+        if (!stallSetter.analyzeAndSet()) return -1.0;
+        return model.analyze(trial).throughput.wavesPerKcycle;
+    };
+
+    // Trials allocate from the default resource, not the kernel's arena.
+    opuas::Kernel asWritten = kernel;
+    asWritten.arena.reset();
+    const int footprint = model.analyze(kernel).registers.vregsUsed;
+    int best = footprint;
+    double bestThroughput = estimate(asWritten);
+    int tried = footprint;
+    for (int waves = 1; waves <= target.maxWavesPerSimd; ++waves) {
+        const int limit = std::min(target.vregsPerSimd / waves / target.vregGranule * target.vregGranule,
+                                   opuas::isa::kMaxVRegs);
+        if (limit <= 0 || limit >= tried) continue;
+        tried = limit;
+        opuas::Kernel trial = kernel;
+        trial.arena.reset();
+        opuas::algorithms::RegisterAllocator allocator(trial);
+        if (!allocator.allocate(limit)) continue;
+        const double throughput = estimate(trial);
+        if (throughput > bestThroughput) {
+            best = limit;
+            bestThroughput = throughput;
+        }
+    }
+    return best;
+}
+
+bool OpuAssembler::applyBlockLayout(opuas::Program& program, const opuas::sim::ExecutionProfile& profile) {
+    for (opuas::Kernel& kernel : program.kernels) {
+        const opuas::sim::KernelProfile* counts = profile.findKernel(kernel.name);
+        if (!counts) {
+            std::clog << "Info: No profile for kernel '" << kernel.name << "'; layout unchanged.\n";
+            continue;
+        }
 
-    return true; // Indicate success (validation passed)
+        // PCs refer to the layout the profiled object was assembled with:
+        // the source order after register allocation.
+        std::vector<uint32_t> offsets = opuas::CodeGenerator::instructionOffsets(kernel);
+        std::map<uint32_t, size_t> indexOf;
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) indexOf[offsets[i]] = i;
+
+        opuas::algorithms::LayoutProfile layoutProfile;
+        bool matches = true;
+        for (const auto& [pc, pcCounts] : counts->pcs) {
+            auto index = indexOf.find(pc);
+            if (index == indexOf.end()) {
+                matches = false;
+                break;
+            }
+            layoutProfile.counts[index->second] = pcCounts.count;
+        }
+        for (const auto& [pc, branch] : counts->branches) {
+            auto index = indexOf.find(pc);
+            if (index == indexOf.end() || !kernel.instructions[index->second].isBranch()) {
+                matches = false;
+                break;
+            }
+            layoutProfile.branchBias[index->second] = {branch.takenLanes, branch.notTakenLanes};
+        }
+        if (!matches) {
+            std::cerr << "Warning: Profile for kernel '" << kernel.name
+                      << "' does not match its instructions; layout unchanged.\n";
+            continue;
+        }
+        for (const auto& [label, count] : counts->labels) {
+            auto index = kernel.labels.find(label);
+            if (index == kernel.labels.end()) {
+                std::cerr << "Warning: Profile label '" << label << "' not found in kernel '" << kernel.name << "'.\n";
+                continue;
+            }
+            uint64_t& known = layoutProfile.counts[index->second];
+            known = std::max(known, count);
+        }
+
+        opuas::algorithms::BlockLayout layout(kernel);
+        if (!layout.apply(layoutProfile)) return false;
+        const opuas::algorithms::LayoutStats& stats = layout.getStats();
+        if (!stats.applied) {
+            std::clog << "Info: Kernel '" << kernel.name << "': layout already matches the profile.\n";
+            continue;
+        }
+        std::clog << "Info: Kernel '" << kernel.name << "': " << stats.blocksMoved << " block(s) moved, "
+                  << stats.branchesFlipped << " branch(es) flipped, " << stats.branchesAdded << " added, "
+                  << stats.branchesRemoved << " removed; estimated taken branches " << stats.takenBefore
+                  << " -> " << stats.takenAfter << ".\n";
+    }
+    return true;
 }
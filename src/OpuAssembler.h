@@ -3,17 +3,72 @@
 #ifndef OPU_ASSEMBLER_H
 #define OPU_ASSEMBLER_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <vector>
+
+namespace opuas {
+class Parser;
+class SourceIndex;
+struct Program;
+struct Kernel;
+namespace elf {
+struct CodeObject;
+}
+namespace algorithms {
+struct KernelPerf;
+}
+namespace sim {
+struct ExecutionProfile;
+}
+}
+
+struct AssemblerOptions {
+    std::string perfReportFormat; // "text" or "json"; empty disables the report
+    std::string perfReportFile;   // Report destination; empty means standard output
+    std::string layoutProfileFile; // Execution profile for basic block layout; empty disables it
+    bool streaming = false;        // Assemble kernel by kernel with bounded memory
+    std::string incrementalBase;   // Previous object to copy unchanged kernels from; empty disables it
+    unsigned threads = 0;          // Threads parsing large inputs; 0 uses every hardware thread
+    bool memoryReport = false;     // Print allocation counts and peak RSS per phase
+    bool deduplicate = true;       // Share identical kernel bodies and argument lists in the object
+    // %v register budget for kernels whose opu.kernels entry sets neither
+    // .max_regs nor .target_occupancy. At most one applies.
+    int maxRegs = 0;               // %v registers per kernel; 0 keeps the registers as written
+    int targetOccupancy = 0;       // Waves per CU the %v registers must allow
+    bool autoRegisterLimit = false; // Keep the limit with the best static throughput estimate
+};
 
 class OpuAssembler {
 private:
     std::string inputFile;
     std::string outputFile;
+    AssemblerOptions options;
+    uint64_t allocationMark = 0;
+
+    bool assembleChunked();
+    bool loadPreviousObject(opuas::elf::CodeObject& previous);
+    uint64_t fingerprintSeed() const;
+    bool parseChunks(std::string_view coasmCode, const opuas::SourceIndex& index, opuas::Program& program);
+    bool loadLayoutProfile(opuas::sim::ExecutionProfile& profile);
+    // Layout, stalls and code generation on a parsed program.
+    bool runPasses(opuas::Program& program, const opuas::sim::ExecutionProfile* profile,
+                   std::vector<opuas::algorithms::KernelPerf>& perf, opuas::elf::CodeObject& object);
+    // Allocations since the previous report and the peak RSS so far.
+    void reportMemory(const std::string& phase);
+    bool writePerfReport(const std::vector<opuas::algorithms::KernelPerf>& kernels);
+    bool applyBlockLayout(opuas::Program& program, const opuas::sim::ExecutionProfile& profile);
+    bool applyRegisterBudgets(opuas::Program& program);
+    int chooseRegisterLimit(const opuas::Kernel& kernel);
 
 public:
-    OpuAssembler(const std::string& input, const std::string& output);
+    OpuAssembler(const std::string& input, const std::string& output,
+                 const AssemblerOptions& options = AssemblerOptions());
     bool assemble(); // Main assembly function
+    // Everything up to (not including) writing the object file.
+    bool buildCodeObject(opuas::elf::CodeObject& object);
 };
 
 #endif // OPU_ASSEMBLER_H
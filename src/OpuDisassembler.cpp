@@ -1,21 +1,314 @@
 // opuas/src/OpuDisassembler.cpp
 
 #include "OpuDisassembler.h"
+#include "ElfObjectReader.h"
+#include "OpuEncoding.h"
+#include "ControlFlowGraph.h"
+#include "Liveness.h"
+#include "PerfModel.h"
+#include "ExecutionProfile.h"
+#include "Arena.h"
+#include "utils.h"
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <map>
+#include <sstream>
 
-OpuDisassembler::OpuDisassembler(const std::string& input, const std::string& output)
-    : inputFile(input), outputFile(output) {}
+namespace {
+
+// Column the per-instruction comments start in.
+constexpr size_t kAnnotationColumn = 56;
+
+std::string percent(uint64_t part, uint64_t whole) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << (whole ? 100.0 * part / whole : 0.0) << "%";
+    return out.str();
+}
+
+std::string blockName(const opuas::algorithms::BasicBlock& block, size_t index) {
+    if (!block.label.empty()) return block.label;
+    return index == 0 ? "<entry>" : "<block " + std::to_string(index) + ">";
+}
+
+template <typename Indices>
+std::string indexList(const Indices& values) {
+    std::string out;
+    for (size_t value : values) out += (out.empty() ? "" : ", ") + std::to_string(value);
+    return "[" + out + "]";
+}
+
+} // namespace
+
+OpuDisassembler::OpuDisassembler(const std::string& input, const std::string& output,
+                                 const DisassemblerOptions& options)
+    : inputFile(input), outputFile(output), options(options) {}
 
 bool OpuDisassembler::disassemble() {
-    std::cout << "Disassembling '" << inputFile << "' is not yet implemented.\n";
-    // Placeholder logic
+    opuas::elf::ElfObjectReader reader(inputFile);
+    if (!reader.read()) {
+        std::cerr << "Error: Could not read object file " << inputFile << std::endl;
+        return false;
+    }
+
+    opuas::sim::ExecutionProfile profile;
+    if (!options.profileFile.empty()) {
+        std::string text;
+        if (!opuas::utils::readFileToString(options.profileFile, text)) return false;
+        std::string message;
+        if (!opuas::sim::ExecutionProfile::parse(text, profile, message)) {
+            std::cerr << "Error: " << options.profileFile << ": " << message << std::endl;
+            return false;
+        }
+    }
+    const bool annotate = options.annotate || !options.profileFile.empty();
+
+    opuas::Program program;
+    std::vector<std::vector<uint32_t>> offsets;
+    program.version = reader.getCodeObject().version;
+    for (const opuas::elf::KernelCode& code : reader.getCodeObject().kernels) {
+        opuas::Kernel kernel;
+        if (!decodeKernel(code, kernel, &offsets.emplace_back())) return false;
+        program.kernels.push_back(std::move(kernel));
+    }
+
     std::ofstream outFile(outputFile);
     if (!outFile.is_open()) {
         std::cerr << "Error: Could not open output file " << outputFile << std::endl;
         return false;
     }
-    outFile << "; Disassembly of " << inputFile << " (Not Implemented)\n";
+    if (annotate) {
+        outFile << "    .text\n";
+        for (size_t k = 0; k < program.kernels.size(); ++k) {
+            const opuas::Kernel& kernel = program.kernels[k];
+            const opuas::sim::KernelProfile* kernelProfile = profile.findKernel(kernel.name);
+            if (!options.profileFile.empty() && !kernelProfile) {
+                opuas::utils::logWarning("Profile '" + options.profileFile + "' has no counters for kernel '" +
+                                         kernel.name + "'.");
+            }
+            printAnnotatedKernel(kernel, offsets[k], kernelProfile, outFile);
+        }
+        printMetadata(program, outFile);
+    } else {
+        printProgram(program, outFile);
+    }
     outFile.close();
     return true;
 }
+
+bool OpuDisassembler::decodeKernel(const opuas::elf::KernelCode& code, opuas::Kernel& kernel,
+                                   std::vector<uint32_t>* offsets) {
+    using namespace opuas;
+    kernel = Kernel();
+    kernel.name = code.name;
+    kernel.args = code.args;
+    kernel.metadata = code.descriptor.toMetadata();
+
+    std::map<uint32_t, const elf::Relocation*> relocAt;
+    for (const elf::Relocation& reloc : code.relocations) relocAt[reloc.offset] = &reloc;
+
+    std::map<uint32_t, size_t> indexOfOffset;
+    std::vector<uint32_t> instOffsets;
+    size_t pos = 0;
+    while (pos < code.code.size()) {
+        isa::DecodedInstruction decoded;
+        std::string message;
+        if (!isa::decodeInstruction(code.code.data() + pos, code.code.size() - pos, decoded, message)) {
+            std::cerr << "Disassembler Error: kernel '" << code.name << "' at offset 0x" << std::hex
+                      << pos * sizeof(uint32_t) << std::dec << ": " << message << "\n";
+            return false;
+        }
+        const uint32_t offset = static_cast<uint32_t>(pos * sizeof(uint32_t));
+        if (decoded.literalOperand >= 0) {
+            auto reloc = relocAt.find(offset + static_cast<uint32_t>(isa::kBaseWords * sizeof(uint32_t)));
+            if (reloc != relocAt.end()) {
+                Operand& operand = decoded.inst.operands[decoded.literalOperand];
+                operand.kind = OperandKind::Symbol;
+                operand.symbol = reloc->second->symbol;
+            }
+        }
+        indexOfOffset[offset] = kernel.instructions.size();
+        instOffsets.push_back(offset);
+        kernel.instructions.push_back(decoded.inst);
+        pos += decoded.words;
+    }
+
+    // Branch targets are kernel-relative byte offsets; give each one a label.
+    for (Instruction& inst : kernel.instructions) {
+        if (!inst.isBranch()) continue;
+        Operand& target = inst.operands.back();
+        if (target.kind != OperandKind::Imm) continue;
+        auto index = indexOfOffset.find(static_cast<uint32_t>(target.imm));
+        if (index == indexOfOffset.end()) {
+            std::cerr << "Disassembler Error: kernel '" << code.name << "' branches to 0x" << std::hex
+                      << target.imm << std::dec << ", which is not an instruction boundary\n";
+            return false;
+        }
+        std::string label = "BB_" + std::to_string(target.imm);
+        kernel.labels[label] = index->second;
+        target.kind = OperandKind::Symbol;
+        target.symbol = label;
+    }
+
+    if (offsets) *offsets = instOffsets;
+    return true;
+}
+
+void OpuDisassembler::printProgram(const opuas::Program& program, std::ostream& out) {
+    using namespace opuas;
+    out << "    .text\n";
+    for (const Kernel& kernel : program.kernels) {
+        out << "    .global " << kernel.name << "\n";
+        out << "    .type " << kernel.name << ",@function\n";
+        out << kernel.name << ":\n";
+        std::multimap<size_t, std::string> labels = kernel.labelsByIndex();
+        for (size_t i = 0; i <= kernel.instructions.size(); ++i) {
+            auto range = labels.equal_range(i);
+            for (auto it = range.first; it != range.second; ++it) out << it->second << ":\n";
+            if (i < kernel.instructions.size()) out << "    " << formatInstruction(kernel.instructions[i]) << "\n";
+        }
+    }
+    printMetadata(program, out);
+}
+
+void OpuDisassembler::printAnnotatedKernel(const opuas::Kernel& kernel, const std::vector<uint32_t>& offsets,
+                                           const opuas::sim::KernelProfile* profile, std::ostream& out) {
+    using namespace opuas;
+    using algorithms::BasicBlock;
+    using algorithms::Loop;
+
+    Arena scratch;
+    algorithms::ControlFlowGraph cfg(kernel, scratch.resource());
+    algorithms::LivenessAnalysis liveness(kernel, cfg, scratch.resource());
+    const algorithms::KernelPerf perf = algorithms::PerfModel().analyze(kernel);
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    const std::pmr::vector<algorithms::RegisterSet>& liveBefore = liveness.getLiveBefore();
+    const std::vector<Loop> loops = cfg.findLoops();
+
+    // Dynamic issues per instruction; an instruction is hot when it issues at
+    // least half as often as the kernel's most frequent one and more often
+    // than the average executed instruction.
+    std::vector<uint64_t> issues(kernel.instructions.size(), 0);
+    uint64_t totalIssues = 0, maxIssues = 0, executed = 0;
+    if (profile) {
+        for (size_t i = 0; i < issues.size() && i < offsets.size(); ++i) {
+            auto counters = profile->pcs.find(offsets[i]);
+            if (counters == profile->pcs.end()) continue;
+            issues[i] = counters->second.count;
+            totalIssues += issues[i];
+            maxIssues = std::max(maxIssues, issues[i]);
+            executed += issues[i] ? 1 : 0;
+        }
+    }
+    std::vector<bool> hot(issues.size());
+    for (size_t i = 0; i < issues.size(); ++i) {
+        hot[i] = issues[i] * 2 >= maxIssues && issues[i] * executed > totalIssues;
+    }
+
+    // Innermost loop of every block.
+    std::vector<const Loop*> loopOf(blocks.size(), nullptr);
+    for (const Loop& loop : loops) {
+        for (size_t b : loop.blocks) {
+            if (!loopOf[b] || loopOf[b]->depth < loop.depth) loopOf[b] = &loop;
+        }
+    }
+
+    out << "// kernel " << kernel.name << ": " << perf.instructions << " instructions, " << blocks.size()
+        << " blocks, " << loops.size() << " loops, " << perf.totalStalls << " stall cycles, " << perf.waits
+        << " scoreboard waits\n";
+    out << "// registers: %v " << perf.registers.vregsUsed << " used (peak live " << perf.registers.peakV
+        << "), %s " << perf.registers.sregsUsed << " used (peak live " << perf.registers.peakS << "), %p "
+        << perf.registers.pregsUsed << " used (peak live " << perf.registers.peakP << "); occupancy "
+        << perf.occupancy.wavesPerCU << " waves/CU (limited by " << perf.occupancy.limiter << ")\n";
+    if (profile) {
+        out << "// profile: " << totalIssues << " issues, " << profile->totalStallCycles() << " stall cycles, "
+            << profile->totalWaits() << " waits, " << std::count_if(hot.begin(), hot.end(), [](bool h) { return h; })
+            << " hot instructions\n";
+    }
+    out << "    .global " << kernel.name << "\n";
+    out << "    .type " << kernel.name << ",@function\n";
+    out << kernel.name << ":\n";
+
+    std::multimap<size_t, std::string> labels = kernel.labelsByIndex();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const BasicBlock& block = blocks[b];
+        const algorithms::BlockPerf& blockPerf = perf.blocks[b];
+
+        for (const Loop& loop : loops) {
+            if (loop.header != b) continue;
+            int instructions = 0, issueCycles = 0, waits = 0;
+            size_t peakLive = 0;
+            uint64_t loopIssues = 0;
+            for (size_t member : loop.blocks) {
+                instructions += static_cast<int>(blocks[member].end - blocks[member].begin);
+                issueCycles += perf.blocks[member].issueCycles;
+                for (size_t i = blocks[member].begin; i < blocks[member].end; ++i) {
+                    waits += kernel.instructions[i].wait ? 1 : 0;
+                    peakLive = std::max(peakLive, liveBefore[i].count());
+                    loopIssues += issues[i];
+                }
+            }
+            out << "// loop " << blockName(block, b) << " (depth " << loop.depth << "): blocks "
+                << indexList(loop.blocks) << ", latches " << indexList(loop.latches) << "; " << instructions
+                << " instructions, " << issueCycles << " issue cycles per iteration, " << waits
+                << " scoreboard waits, peak live " << peakLive;
+            if (profile) out << "; " << loopIssues << " issues (" << percent(loopIssues, totalIssues) << ")";
+            out << "\n";
+        }
+
+        out << "// block " << b << " " << blockName(block, b) << " [" << block.begin << ", " << block.end
+            << "): preds " << indexList(block.preds)
+            << ", succs " << indexList(block.succs)
+            << ", issue " << blockPerf.issueCycles << ", critical path " << blockPerf.criticalPath;
+        if (loopOf[b]) {
+            out << ", loop depth " << loopOf[b]->depth << " (header "
+                << blockName(blocks[loopOf[b]->header], loopOf[b]->header) << ")";
+        }
+        out << "\n";
+
+        for (size_t i = block.begin; i < block.end; ++i) {
+            auto range = labels.equal_range(i);
+            for (auto it = range.first; it != range.second; ++it) out << it->second << ":\n";
+
+            const Instruction& inst = kernel.instructions[i];
+            std::string text = "    " + formatInstruction(inst);
+            text.resize(std::max(text.size() + 1, kAnnotationColumn), ' ');
+            out << text << "// " << std::hex << "0x" << std::setw(4) << std::setfill('0')
+                << (i < offsets.size() ? offsets[i] : 0) << std::dec << std::setfill(' ') << " stall "
+                << inst.stall << (inst.wait ? " wait " : " ")
+                << isa::latencyClassName(isa::latencyClassOf(inst.opcode, inst.modifier)) << " live "
+                << liveBefore[i].count();
+            if (profile) {
+                out << " issues " << issues[i] << " (" << percent(issues[i], totalIssues) << ")"
+                    << (hot[i] ? " hot" : "");
+            }
+            out << "\n";
+        }
+    }
+    // Labels past the last instruction.
+    auto range = labels.equal_range(kernel.instructions.size());
+    for (auto it = range.first; it != range.second; ++it) out << it->second << ":\n";
+}
+
+void OpuDisassembler::printMetadata(const opuas::Program& program, std::ostream& out) {
+    using namespace opuas;
+    out << "-\nopu.kernels:\n";
+    for (const Kernel& kernel : program.kernels) {
+        out << " - .name: " << kernel.name << "\n";
+        if (!kernel.args.empty()) {
+            out << "   .args:\n";
+            for (const KernelArg& arg : kernel.args) {
+                out << "     - .address_space: " << arg.addressSpace << " .name: " << arg.name
+                    << " .offset: " << arg.offset << " .size: " << arg.size
+                    << " .value_kind: " << arg.valueKind << "\n";
+            }
+        }
+        for (const auto& [key, value] : kernel.metadata) out << "   " << key << ": " << value << "\n";
+    }
+    if (!program.version.empty()) {
+        out << "opu.version:\n";
+        for (int word : program.version) out << " - " << word << "\n";
+    }
+    out << "...\n";
+}
@@ -3,16 +3,50 @@
 #ifndef OPU_DISASSEMBLER_H
 #define OPU_DISASSEMBLER_H
 
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <vector>
+#include "Program.h"
+#include "CodeObject.h"
+
+namespace opuas {
+namespace sim {
+struct KernelProfile;
+}
+}
+
+struct DisassemblerOptions {
+    bool annotate = false;        // Comment blocks, loops, stalls, latency classes and live registers
+    std::string profileFile;      // Per-PC execution profile marking hot instructions; implies annotate
+};
 
 class OpuDisassembler {
 private:
     std::string inputFile;
     std::string outputFile;
+    DisassemblerOptions options;
+
+    // Metadata sections that follow the kernels.
+    static void printMetadata(const opuas::Program& program, std::ostream& out);
 
 public:
-    OpuDisassembler(const std::string& input, const std::string& output);
+    OpuDisassembler(const std::string& input, const std::string& output,
+                    const DisassemblerOptions& options = DisassemblerOptions());
     bool disassemble(); // Main disassembly function
+
+    // Decode one kernel back into the internal representation. Branch targets
+    // become labels, relocated literals become symbol operands. `offsets`
+    // receives the byte offset of every instruction.
+    static bool decodeKernel(const opuas::elf::KernelCode& code, opuas::Kernel& kernel,
+                             std::vector<uint32_t>* offsets = nullptr);
+    // Print kernels and their opu.kernels / opu.version metadata as COASM.
+    static void printProgram(const opuas::Program& program, std::ostream& out);
+    // One kernel with its basic blocks, loops and per-instruction costs as
+    // comments, so the listing still reassembles to the same code. `offsets`
+    // comes from decodeKernel; `profile` may be null.
+    static void printAnnotatedKernel(const opuas::Kernel& kernel, const std::vector<uint32_t>& offsets,
+                                     const opuas::sim::KernelProfile* profile, std::ostream& out);
 };
 
 #endif // OPU_DISASSEMBLER_H
@@ -0,0 +1,74 @@
+// opuas/src/OpuLinker.cpp
+
+#include "OpuLinker.h"
+#include "ElfLinker.h"
+#include "ElfObjectReader.h"
+#include "ElfObjectWriter.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+OpuLinker::OpuLinker(const std::vector<std::string>& inputs, const std::string& output, unsigned threads,
+                     bool deduplicate)
+    : inputFiles(inputs), outputFile(output), threads(threads), deduplicate(deduplicate) {}
+
+bool OpuLinker::link() {
+    std::clog << "Linking " << inputFiles.size() << " object file(s)...\n";
+
+    // Inputs are independent: map and decode them on worker threads, each
+    // copying its sections out of its own mapping.
+    std::vector<opuas::elf::CodeObject> objects(inputFiles.size());
+    std::vector<std::string> errors(inputFiles.size());
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next++; i < inputFiles.size(); i = next++) {
+            try {
+                opuas::elf::ElfObjectReader reader(inputFiles[i]);
+                if (reader.read()) {
+                    objects[i] = reader.getCodeObject();
+                } else {
+                    errors[i] = "could not read object file " + inputFiles[i];
+                }
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        }
+    };
+    unsigned workers = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = static_cast<unsigned>(std::min<size_t>(workers, inputFiles.size()));
+    if (workers <= 1) {
+        work();
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < workers; ++t) pool.emplace_back(work);
+        for (std::thread& thread : pool) thread.join();
+    }
+    for (const std::string& error : errors) {
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
+        }
+    }
+
+    opuas::elf::ElfLinker linker(deduplicate);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (!linker.addObject(inputFiles[i], objects[i])) return false;
+    }
+    opuas::elf::CodeObject linked;
+    if (!linker.link(linked)) return false;
+
+    std::clog << "Linker Info: " << linked.kernels.size() << " kernel(s), " << linker.getResolvedCount()
+              << " relocation(s) resolved.\n";
+    for (const std::string& symbol : linker.getUndefinedSymbols()) {
+        std::cerr << "Linker Warning: symbol '" << symbol << "' is undefined; its relocations are kept.\n";
+    }
+
+    try {
+        opuas::elf::ElfObjectWriter writer(outputFile, deduplicate);
+        return writer.write(linked);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+}
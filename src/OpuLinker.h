@@ -0,0 +1,22 @@
+// opuas/src/OpuLinker.h
+
+#ifndef OPU_LINKER_H
+#define OPU_LINKER_H
+
+#include <string>
+#include <vector>
+
+class OpuLinker {
+private:
+    std::vector<std::string> inputFiles;
+    std::string outputFile;
+    unsigned threads;   // Input loading workers; 0 picks one per hardware thread
+    bool deduplicate;   // Share identical kernel bodies and argument lists in the output
+
+public:
+    OpuLinker(const std::vector<std::string>& inputs, const std::string& output, unsigned threads = 0,
+              bool deduplicate = true);
+    bool link(); // Merge the input objects into the output object
+};
+
+#endif // OPU_LINKER_H
@@ -0,0 +1,66 @@
+// opuas/src/OpuPatcher.cpp
+
+#include "OpuPatcher.h"
+#include "OpuAssembler.h"
+#include "CodeObject.h"
+#include "ElfObjectReader.h"
+#include "ElfPatcher.h"
+#include <iostream>
+#include <fstream>
+
+OpuPatcher::OpuPatcher(const std::string& object, const std::string& replacement, const std::string& kernel)
+    : objectFile(object), replacementFile(replacement), kernelName(kernel) {}
+
+bool OpuPatcher::patch() {
+    // The replacement is either an object or COASM source to assemble.
+    char magic[4] = {};
+    {
+        std::ifstream probe(replacementFile, std::ios::binary);
+        if (!probe.is_open()) {
+            std::cerr << "Error: Could not open replacement file " << replacementFile << std::endl;
+            return false;
+        }
+        probe.read(magic, sizeof(magic));
+    }
+
+    opuas::elf::CodeObject replacement;
+    try {
+        if (std::string(magic, sizeof(magic)) == "\x7f" "ELF") {
+            opuas::elf::ElfObjectReader reader(replacementFile);
+            if (!reader.read()) return false;
+            replacement = reader.getCodeObject();
+        } else {
+            OpuAssembler assembler(replacementFile, "");
+            if (!assembler.buildCodeObject(replacement)) return false;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    const opuas::elf::KernelCode* kernel = nullptr;
+    if (!kernelName.empty()) {
+        kernel = replacement.findKernel(kernelName);
+        if (!kernel) {
+            std::cerr << "Error: Kernel '" << kernelName << "' not found in " << replacementFile << std::endl;
+            return false;
+        }
+    } else if (replacement.kernels.size() == 1) {
+        kernel = &replacement.kernels.front();
+    } else {
+        std::cerr << "Error: " << replacementFile << " has " << replacement.kernels.size()
+                  << " kernels; select one with --kernel.\n";
+        return false;
+    }
+
+    std::clog << "Patching kernel '" << kernel->name << "' in '" << objectFile << "'...\n";
+    opuas::elf::ElfPatcher patcher(objectFile);
+    if (!patcher.replaceKernel(*kernel)) return false;
+    if (patcher.wasInPlace()) {
+        std::clog << "Patch Info: patched in place, " << patcher.getBytesWritten() << " byte(s) written.\n";
+    } else {
+        std::clog << "Patch Info: " << patcher.getBytesWritten() << " byte(s) written in place, "
+                  << patcher.getBytesAppended() << " byte(s) appended.\n";
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+// opuas/src/OpuPatcher.h
+
+#ifndef OPU_PATCHER_H
+#define OPU_PATCHER_H
+
+#include <string>
+
+class OpuPatcher {
+private:
+    std::string objectFile;
+    std::string replacementFile; // .coasm source or an object holding the new kernel
+    std::string kernelName;      // Empty: the replacement's only kernel
+
+public:
+    OpuPatcher(const std::string& object, const std::string& replacement, const std::string& kernel = "");
+    bool patch(); // Replace the kernel in objectFile without rewriting the rest of it
+};
+
+#endif // OPU_PATCHER_H
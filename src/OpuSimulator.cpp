@@ -0,0 +1,151 @@
+// opuas/src/OpuSimulator.cpp
+
+#include "OpuSimulator.h"
+#include "ElfObjectReader.h"
+#include "ExecutionProfile.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+OpuSimulator::OpuSimulator(const std::string& input, const std::string& profileOutput, const SimulatorOptions& options)
+    : inputFile(input), profileFile(profileOutput), options(options) {}
+
+bool OpuSimulator::simulate() {
+    std::clog << "Loading object file '" << inputFile << "' for simulation...\n";
+    opuas::elf::CodeObject object;
+    try {
+        opuas::elf::ElfObjectReader reader(inputFile);
+        if (!reader.read()) return false;
+        object = reader.getCodeObject();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    const opuas::elf::KernelCode* kernel = nullptr;
+    if (!options.kernelName.empty()) {
+        kernel = object.findKernel(options.kernelName);
+    } else if (object.kernels.size() == 1) {
+        kernel = &object.kernels[0];
+    }
+    if (!kernel) {
+        std::cerr << "Error: " << (options.kernelName.empty() ? "Use --kernel to choose one of"
+                                                              : "Kernel '" + options.kernelName + "' not found in")
+                  << " the object's kernels:";
+        for (const opuas::elf::KernelCode& code : object.kernels) std::cerr << " " << code.name;
+        std::cerr << "\n";
+        return false;
+    }
+
+    opuas::sim::LaunchConfig config;
+    config.grid = options.grid;
+    config.block = options.block;
+    config.threads = options.threads;
+    config.waveInstructionLimit = options.waveInstructionLimit;
+    if (!buildParams(*kernel, config.params)) return false;
+
+    std::vector<uint8_t> memory;
+    if (!options.memoryFile.empty()) {
+        std::ifstream memFile(options.memoryFile, std::ios::binary);
+        if (!memFile.is_open()) {
+            std::cerr << "Error: Could not open memory image " << options.memoryFile << std::endl;
+            return false;
+        }
+        memory.assign(std::istreambuf_iterator<char>(memFile), std::istreambuf_iterator<char>());
+    }
+    if (memory.size() < options.memorySize) memory.resize(options.memorySize, 0);
+
+    opuas::sim::Simulator simulator(*kernel, &object.symbols);
+    opuas::sim::ExecutionProfile profile;
+    profile.kernels.emplace_back();
+    if (!simulator.load() || !simulator.run(config, memory, profile.kernels.back())) {
+        std::cerr << "Simulator Error: " << simulator.getError() << std::endl;
+        return false;
+    }
+
+    const opuas::sim::KernelProfile& result = profile.kernels.back();
+    uint64_t branches = 0, divergent = 0;
+    for (const auto& [pc, counters] : result.branches) {
+        branches += counters.executed;
+        divergent += counters.divergent;
+    }
+    const uint64_t instructions = result.totalInstructions();
+    std::clog << "Simulator Info: " << result.workgroups << " workgroup(s), " << result.waves << " wave(s), "
+              << instructions << " wave instruction(s), " << result.totalStallCycles() << " stall cycle(s), "
+              << result.totalWaits() << " wait(s).\n";
+    if (instructions) {
+        std::clog << "Simulator Info: SIMD lane utilization " << std::fixed << std::setprecision(1)
+                  << 100.0 * result.totalLanes() / (instructions * 32.0) << "%, " << divergent << " of " << branches
+                  << " branch issue(s) divergent.\n";
+    }
+
+    // Progress and info lines go to std::clog, so stdout holds only the profile.
+    if (profileFile.empty()) {
+        std::cout << profile.toText();
+    } else {
+        std::ofstream out(profileFile);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open profile file " << profileFile << std::endl;
+            return false;
+        }
+        out << profile.toText();
+    }
+
+    if (!options.memoryOutFile.empty()) {
+        std::ofstream memOut(options.memoryOutFile, std::ios::binary);
+        if (!memOut.is_open()) {
+            std::cerr << "Error: Could not open output file " << options.memoryOutFile << std::endl;
+            return false;
+        }
+        memOut.write(reinterpret_cast<const char*>(memory.data()), memory.size());
+    }
+    return true;
+}
+
+// Lay the --arg values out at the offsets from the kernel's .args. Values
+// containing '.' are floating point, sized by the argument (f32 or f64).
+bool OpuSimulator::buildParams(const opuas::elf::KernelCode& kernel, std::vector<uint8_t>& params) {
+    if (options.args.size() > kernel.args.size()) {
+        std::cerr << "Error: Kernel '" << kernel.name << "' takes " << kernel.args.size() << " argument(s), got "
+                  << options.args.size() << ".\n";
+        return false;
+    }
+    size_t size = 0;
+    for (const opuas::KernelArg& arg : kernel.args) size = std::max<size_t>(size, arg.offset + arg.size);
+    params.assign(size, 0);
+
+    for (size_t i = 0; i < options.args.size(); ++i) {
+        const opuas::KernelArg& arg = kernel.args[i];
+        const std::string& text = options.args[i];
+        uint64_t bits = 0;
+        try {
+            bool isFloat = text.find('.') != std::string::npos && text.compare(0, 2, "0x") != 0;
+            if (isFloat && arg.size == 4) {
+                float value = std::stof(text);
+                uint32_t word;
+                memcpy(&word, &value, sizeof(word));
+                bits = word;
+            } else if (isFloat) {
+                double value = std::stod(text);
+                memcpy(&bits, &value, sizeof(bits));
+            } else if (!text.empty() && text[0] == '-') {
+                bits = static_cast<uint64_t>(std::stoll(text, nullptr, 0));
+            } else {
+                bits = std::stoull(text, nullptr, 0);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value '" << text << "' for argument '" << arg.name << "'.\n";
+            return false;
+        }
+        if (arg.size > sizeof(bits)) {
+            std::cerr << "Error: Argument '" << arg.name << "' is " << arg.size << " bytes; only scalars are supported.\n";
+            return false;
+        }
+        memcpy(params.data() + arg.offset, &bits, arg.size); // Little-endian target
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+// opuas/src/OpuSimulator.h
+
+#ifndef OPU_SIMULATOR_H
+#define OPU_SIMULATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Simulator.h"
+
+struct SimulatorOptions {
+    std::string kernelName;          // Kernel to launch; may be empty if the object has one kernel
+    opuas::sim::Dim3 grid;
+    opuas::sim::Dim3 block;
+    std::vector<std::string> args;   // Argument values, in .args order
+    std::string memoryFile;          // Initial global memory image
+    uint64_t memorySize = 0;         // Minimum size of global memory (zero-filled)
+    std::string memoryOutFile;       // Global memory after the launch
+    unsigned threads = 1;
+    uint64_t waveInstructionLimit = opuas::sim::kDefaultWaveInstructionLimit;
+};
+
+class OpuSimulator {
+private:
+    std::string inputFile;
+    std::string profileFile;         // Empty means standard output
+    SimulatorOptions options;
+
+    bool buildParams(const opuas::elf::KernelCode& kernel, std::vector<uint8_t>& params);
+
+public:
+    OpuSimulator(const std::string& input, const std::string& profileOutput,
+                 const SimulatorOptions& options = SimulatorOptions());
+    bool simulate(); // Load the object, run the kernel, write the profile
+};
+
+#endif // OPU_SIMULATOR_H
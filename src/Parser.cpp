@@ -1,50 +1,116 @@
 // opuas/src/Parser.cpp
 #include "Parser.h"
-#include "antlr4-runtime.h"
-// Include headers generated by coasm_infra's ANTLR from coasm.g4
-#include "coasmLexer.h"
-#include "coasmParser.h"
+#include "ProgramBuilder.h"
 #include <iostream>
 #include <sstream>
-#include <memory>
+#include <string_view>
+#include <algorithm>
+#include <utility>
 
 namespace opuas {
 
-Parser::Parser(const std::string& coasmCode) : inputCode(coasmCode) {}
+// Reports ANTLR syntax errors at their line and column in the source file
+// rather than in the concatenated chunks.
+class Parser::ErrorListener : public antlr4::BaseErrorListener {
+public:
+    explicit ErrorListener(const Parser& owner) : owner_(owner) {}
+
+    void syntaxError(antlr4::Recognizer*, antlr4::Token*, size_t line, size_t charPositionInLine,
+                     const std::string& msg, std::exception_ptr) override {
+        *owner_.diagnostics << "Parser Error: " << owner_.sourceName << ":" << owner_.fileLine(line) << ":"
+                            << charPositionInLine + 1 << ": " << msg << std::endl;
+    }
+
+private:
+    const Parser& owner_;
+};
+
+Parser::Parser(std::string coasmCode, const std::string& sourceName)
+    : inputCode(std::move(coasmCode)), sourceName(sourceName), chunkStarts{{0, 1, 1}}, diagnostics(&std::cerr) {}
+
+Parser::Parser(const std::vector<SourceChunk>& chunks, const std::string& sourceName)
+    : sourceName(sourceName), diagnostics(&std::cerr) {
+    int inputLine = 1;
+    for (const SourceChunk& chunk : chunks) {
+        if (chunk.text.empty()) continue;
+        chunkStarts.push_back({inputCode.size(), inputLine, chunk.firstLine});
+        inputCode += chunk.text;
+        if (inputCode.back() != '\n') inputCode += '\n';
+        inputLine += static_cast<int>(std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+        if (chunk.text.back() != '\n') ++inputLine;
+    }
+}
+
+Parser::~Parser() = default;
+
+void Parser::setDiagnostics(std::ostream& stream) {
+    diagnostics = &stream;
+}
+
+int Parser::fileLine(size_t inputLine) const {
+    for (auto it = chunkStarts.rbegin(); it != chunkStarts.rend(); ++it) {
+        if (static_cast<size_t>(it->inputLine) <= inputLine) {
+            return it->fileLine + static_cast<int>(inputLine - it->inputLine);
+        }
+    }
+    return static_cast<int>(inputLine);
+}
 
 bool Parser::parse() {
+    if (!checkSyntax()) return false;
+
+    // Lower the validated source into kernels, instructions and metadata.
+    program = Program();
+    ProgramBuilder builder(sourceName, *diagnostics);
+    bool built = true;
+    const std::string_view code(inputCode);
+    for (size_t i = 0; i < chunkStarts.size(); ++i) {
+        const size_t begin = chunkStarts[i].offset;
+        const size_t end = i + 1 < chunkStarts.size() ? chunkStarts[i + 1].offset : inputCode.size();
+        built = builder.addSource(code.substr(begin, end - begin), chunkStarts[i].fileLine, program) && built;
+    }
+    if (!builder.finish(program) || !built) {
+        *diagnostics << "Parser Error: Failed to lower COASM code into the internal representation.\n";
+        return false;
+    }
+    std::string().swap(inputCode); // The program no longer refers to the text
+    return true;
+}
+
+// The ANTLR objects are locals: every token and tree node is released before
+// lowering starts.
+bool Parser::checkSyntax() {
     try {
-        antlr4::ANTLRInputStream input(inputCode);
-        coasmLexer lexer(&input); // Use coasm_infra's generated lexer
+        antlr4::ANTLRInputStream inputStream(inputCode);
+        coasmLexer lexer(&inputStream); // Use coasm_infra's generated lexer
         antlr4::CommonTokenStream tokens(&lexer);
         coasmParser parser(&tokens); // Use coasm_infra's generated parser
+        ErrorListener errorListener(*this);
+        lexer.removeErrorListeners();
+        lexer.addErrorListener(&errorListener);
+        parser.removeErrorListeners();
+        parser.addErrorListener(&errorListener);
 
         // Parse the entire input (assuming 'prog' is the start rule)
-        parseTree = parser.prog();
+        parser.prog();
 
         size_t numErrors = parser.getNumberOfSyntaxErrors();
         if (numErrors > 0) {
-            std::cerr << "Parser Error: " << numErrors << " syntax error(s) found in COASM code.\n";
-            // ANTLR usually prints errors to stderr already via its default error listener
-            parseTree.reset(); // Clear the tree on error
+            *diagnostics << "Parser Error: " << numErrors << " syntax error(s) found in COASM code.\n";
             return false;
-        } else {
-            // std::cout << "Parser Info: No syntax errors detected.\n";
-            return true;
         }
     } catch (const std::exception& e) {
-        std::cerr << "Parser Error: Exception occurred during parsing: " << e.what() << std::endl;
-        parseTree.reset();
+        *diagnostics << "Parser Error: Exception occurred during parsing: " << e.what() << std::endl;
         return false;
     } catch (...) {
-        std::cerr << "Parser Error: Unknown exception occurred during parsing." << std::endl;
-        parseTree.reset();
+        *diagnostics << "Parser Error: Unknown exception occurred during parsing." << std::endl;
         return false;
     }
+    return true;
 }
 
-coasmParser::ProgContext* Parser::getParseTree() {
-    return parseTree.get();
+Program& Parser::getProgram() {
+    return program;
 }
 
 } // namespace opuas
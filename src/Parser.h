@@ -0,0 +1,58 @@
+// opuas/src/Parser.h
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "SourceChunk.h"
+#include "antlr4-runtime.h"
+// Include headers generated by coasm_infra's ANTLR from coasm.g4
+#include "coasmLexer.h"
+#include "coasmParser.h"
+
+namespace opuas {
+
+// Front end: checks COASM syntax with coasm_infra's generated parser and
+// lowers the source into the opuas internal representation.
+class Parser {
+public:
+    explicit Parser(std::string coasmCode, const std::string& sourceName = "<input>");
+    // Parse slices of one file as a unit; diagnostics keep the file's lines.
+    explicit Parser(const std::vector<SourceChunk>& chunks, const std::string& sourceName = "<input>");
+
+    ~Parser();
+
+    // Where syntax and lowering errors go (default std::cerr); parsers on
+    // worker threads collect them to print in file order.
+    void setDiagnostics(std::ostream& stream);
+
+    // The ANTLR tree and tokens only exist during parse(); the lowered
+    // program is what later passes use.
+    bool parse();
+    Program& getProgram();
+
+private:
+    class ErrorListener;
+
+    bool checkSyntax();
+
+    struct ChunkStart {
+        size_t offset;      // In inputCode
+        int inputLine;      // Line of inputCode the chunk starts on
+        int fileLine;       // Line of the source file it came from
+    };
+    int fileLine(size_t inputLine) const;
+
+    std::string inputCode;
+    std::string sourceName;
+    std::vector<ChunkStart> chunkStarts;
+    std::ostream* diagnostics;
+
+    Program program;
+};
+
+} // namespace opuas
+
+#endif // PARSER_H
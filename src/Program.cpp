@@ -0,0 +1,85 @@
+// opuas/src/Program.cpp
+#include "Program.h"
+#include <iomanip>
+#include <sstream>
+
+namespace opuas {
+
+int64_t Kernel::getMetadata(const std::string& key, int64_t defaultValue) const {
+    auto it = metadata.find(key);
+    return it != metadata.end() ? it->second : defaultValue;
+}
+
+const KernelArg* Kernel::findArg(const std::string& argName) const {
+    for (const KernelArg& arg : args) {
+        if (arg.name == argName) return &arg;
+    }
+    return nullptr;
+}
+
+std::multimap<size_t, std::string> Kernel::labelsByIndex() const {
+    std::multimap<size_t, std::string> byIndex;
+    for (const auto& [label, index] : labels) {
+        byIndex.emplace(index, label);
+    }
+    return byIndex;
+}
+
+Kernel* Program::findKernel(const std::string& name) {
+    for (Kernel& kernel : kernels) {
+        if (kernel.name == name) return &kernel;
+    }
+    return nullptr;
+}
+
+std::string formatOperand(const Operand& operand) {
+    switch (operand.kind) {
+        case OperandKind::VReg:    return "%v" + std::to_string(operand.reg);
+        case OperandKind::VReg64:  return "%vd" + std::to_string(operand.reg);
+        case OperandKind::SReg:    return "%s" + std::to_string(operand.reg);
+        case OperandKind::PReg:    return "%p" + std::to_string(operand.reg);
+        case OperandKind::Special: return isa::specialRegisterName(operand.reg);
+        case OperandKind::Symbol:  return operand.symbol;
+        case OperandKind::Imm: {
+            if (operand.imm <= 64) return std::to_string(operand.imm);
+            std::ostringstream hex;
+            hex << "0x" << std::hex << operand.imm;
+            return hex.str();
+        }
+        case OperandKind::None:    break;
+    }
+    return "";
+}
+
+std::string formatInstruction(const Instruction& inst) {
+    std::ostringstream out;
+    std::string mnemonic = isa::formatMnemonic(inst.opcode, inst.type, inst.modifier);
+    const std::pmr::vector<Operand>& ops = inst.operands;
+    if (ops.empty()) return mnemonic;
+    out << std::left << std::setw(15) << mnemonic << " ";
+
+    auto address = [&](size_t base) {
+        const Operand& offset = ops[base + 1];
+        if (offset.kind == OperandKind::Imm && offset.imm == 0) return "[" + formatOperand(ops[base]) + "]";
+        return "[" + formatOperand(ops[base]) + " + " + formatOperand(offset) + "]";
+    };
+
+    switch (inst.info().format) {
+        case isa::Format::MLOAD:
+            out << formatOperand(ops[0]) << ", " << address(1);
+            break;
+        case isa::Format::MSTORE:
+            out << address(0) << ", " << formatOperand(ops[2]);
+            break;
+        case isa::Format::SCBRANCH:
+            // Branches name the predicate without '%': "s_branch_tccnz p0 BB0_3"
+            out << "p" << ops[0].reg << " " << formatOperand(ops[1]);
+            break;
+        default:
+            for (size_t i = 0; i < ops.size(); ++i) out << (i ? ", " : "") << formatOperand(ops[i]);
+            break;
+    }
+    return out.str();
+}
+
+} // namespace opuas
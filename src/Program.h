@@ -0,0 +1,105 @@
+// opuas/src/Program.h
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "OpuIsa.h"
+
+namespace opuas {
+
+// --- Internal Representation ---
+// The parse tree is lowered into this form once; every pass (register
+// allocation, stall setting, code generation, reports) works on it.
+
+enum class OperandKind : uint8_t {
+    None,
+    VReg,     // %vN  (32-bit vector register)
+    VReg64,   // %vdN (pair %vN, %vN+1)
+    SReg,     // %sN
+    PReg,     // %pN
+    Special,  // %tid.x, %ctaid.x, ...
+    Imm,      // Integer or float bit pattern
+    Symbol,   // Label, kernel argument or external symbol
+};
+
+struct Operand {
+    OperandKind kind = OperandKind::None;
+    int reg = 0;          // Register index, or special register id
+    int64_t imm = 0;      // Value for OperandKind::Imm
+    std::string symbol;   // Name for OperandKind::Symbol
+
+    bool isRegister() const {
+        return kind == OperandKind::VReg || kind == OperandKind::VReg64 ||
+               kind == OperandKind::SReg || kind == OperandKind::PReg;
+    }
+};
+
+struct Instruction {
+    Instruction() = default;
+    // Operands allocated from `resource` (the kernel's arena); copies use the
+    // default resource.
+    explicit Instruction(std::pmr::memory_resource* resource) : operands(resource) {}
+
+    isa::Opcode opcode = isa::Opcode::Nop;
+    isa::DataType type = isa::DataType::None;
+    uint8_t modifier = 0;
+    // Operand order follows the format: destination first for VOP*/VCMP/MLOAD,
+    // MLOAD is {dst, base, offset}, MSTORE is {base, offset, value},
+    // SCBRANCH is {predicate, target}.
+    std::pmr::vector<Operand> operands;
+    int stall = 0;      // Cycles to hold the next issue (StallSetter)
+    bool wait = false;  // Wait for outstanding memory results before issue (StallSetter)
+    int line = 0;       // Source line, for diagnostics
+
+    const isa::OpcodeInfo& info() const { return isa::getOpcodeInfo(opcode); }
+    bool isBranch() const {
+        return info().format == isa::Format::SBRANCH || info().format == isa::Format::SCBRANCH;
+    }
+    bool isTerminator() const { return isBranch() || opcode == isa::Opcode::Exit; }
+};
+
+struct KernelArg {
+    std::string name;
+    std::string addressSpace;
+    std::string valueKind;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct Kernel {
+    std::shared_ptr<Arena> arena;              // Sub-arena of Program::arena; null outside the assembler
+    std::string name;
+    std::vector<Instruction> instructions;
+    std::map<std::string, size_t> labels;      // Label -> index of the instruction it precedes
+    std::vector<KernelArg> args;               // From opu.kernels .args
+    std::map<std::string, int64_t> metadata;   // From opu.kernels (".shared_memsize", ...)
+    int line = 0;
+
+    int64_t getMetadata(const std::string& key, int64_t defaultValue = 0) const;
+    const KernelArg* findArg(const std::string& argName) const;
+    // Labels grouped by the instruction index they precede.
+    std::multimap<size_t, std::string> labelsByIndex() const;
+};
+
+struct Program {
+    std::shared_ptr<Arena> arena;   // Per-compilation arena, created by ProgramBuilder
+    std::vector<Kernel> kernels;
+    std::vector<int> version;   // opu.version
+
+    Kernel* findKernel(const std::string& name);
+};
+
+// --- COASM Text ---
+// Format operands and instructions the way the assembler reads them back.
+std::string formatOperand(const Operand& operand);
+std::string formatInstruction(const Instruction& inst);
+
+} // namespace opuas
+
+#endif // PROGRAM_H
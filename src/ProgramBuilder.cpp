@@ -0,0 +1,474 @@
+// opuas/src/ProgramBuilder.cpp
+#include "ProgramBuilder.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory_resource>
+#include <sstream>
+
+namespace opuas {
+
+namespace {
+
+// First block of a kernel's sub-arena; later blocks grow geometrically.
+constexpr size_t kKernelArenaSize = 4 * 1024;
+
+bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$' || c == '@';
+}
+
+bool isIdentifier(std::string_view text) {
+    if (text.empty() || std::isdigit(static_cast<unsigned char>(text[0]))) return false;
+    for (char c : text) {
+        if (!isIdentifierChar(c)) return false;
+    }
+    return true;
+}
+
+// Lines are handled as views into the source; only what ends up in the
+// program is copied.
+constexpr const char* kWhitespace = " \t\n\r\f\v";
+
+std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(kWhitespace);
+    if (start == std::string_view::npos) return {};
+    return text.substr(start, text.find_last_not_of(kWhitespace) - start + 1);
+}
+
+std::string_view stripComment(std::string_view line) {
+    size_t pos = line.find("//");
+    size_t semi = line.find(';');
+    if (semi != std::string_view::npos && (pos == std::string_view::npos || semi < pos)) pos = semi;
+    return line.substr(0, pos);
+}
+
+void splitWords(std::string_view text, std::pmr::vector<std::string_view>& words) {
+    for (text = trim(text); !text.empty();) {
+        size_t end = text.find_first_of(kWhitespace);
+        words.push_back(text.substr(0, end));
+        text = trim(text.substr(std::min(end, text.size())));
+    }
+}
+
+bool isKey(std::string_view word) {
+    return word.size() >= 2 && word.front() == '.' && word.back() == ':';
+}
+
+// Split operands on top-level commas; operands without commas ("p0 BB0_3")
+// are split on whitespace instead.
+void splitOperands(std::string_view text, std::pmr::vector<std::string_view>& operands) {
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i < text.size()) {
+            if (text[i] == '[') depth++;
+            if (text[i] == ']') depth--;
+            if (text[i] != ',' || depth != 0) continue;
+        }
+        std::string_view piece = trim(text.substr(start, i - start));
+        start = i + 1;
+        if (piece.find('[') != std::string_view::npos) {
+            operands.push_back(piece);
+        } else {
+            splitWords(piece, operands);
+        }
+    }
+}
+
+bool parseInteger(const std::string& text, int64_t& value) {
+    if (text.empty()) return false;
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used, 0);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Integers (decimal/hex), PTX-style float bit patterns (0f3F800000) and
+// decimal floats, which are stored as their IEEE single-precision bits.
+bool parseImmediate(const std::string& text, int64_t& value) {
+    if (parseInteger(text, value)) return true;
+    if (text.size() == 10 && (text.compare(0, 2, "0f") == 0 || text.compare(0, 2, "0F") == 0)) {
+        return parseInteger("0x" + text.substr(2), value);
+    }
+    if (text.find_first_of(".eE") == std::string::npos) return false;
+    try {
+        size_t used = 0;
+        float f = std::stof(text, &used);
+        if (used != text.size()) return false;
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        value = bits;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Parse "%v12", "%vd0", "%s3", "%p1", and the bare "p0" form when
+// `barePredicate` is set (only a conditional branch's predicate; elsewhere
+// "p0" is a symbol).
+bool parseRegister(std::string_view text, Operand& operand, bool barePredicate) {
+    size_t pos = (!text.empty() && text[0] == '%') ? 1 : 0;
+    OperandKind kind;
+    if (text.compare(pos, 2, "vd") == 0) { kind = OperandKind::VReg64; pos += 2; }
+    else if (text.compare(pos, 1, "v") == 0) { kind = OperandKind::VReg; pos += 1; }
+    else if (text.compare(pos, 1, "s") == 0) { kind = OperandKind::SReg; pos += 1; }
+    else if (text.compare(pos, 1, "p") == 0) { kind = OperandKind::PReg; pos += 1; }
+    else return false;
+    if (text[0] != '%' && (kind != OperandKind::PReg || !barePredicate)) return false;
+    if (pos >= text.size()) return false;
+    for (size_t i = pos; i < text.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) return false;
+    }
+    operand.kind = kind;
+    if (text.size() - pos > 9) return false; // Out of range; avoids overflow below
+    operand.reg = 0;
+    for (size_t i = pos; i < text.size(); ++i) operand.reg = operand.reg * 10 + (text[i] - '0');
+    return true;
+}
+
+} // namespace
+
+ProgramBuilder::ProgramBuilder(const std::string& sourceName, std::ostream& diagnostics)
+    : sourceName_(sourceName), diagnostics_(&diagnostics) {}
+
+bool ProgramBuilder::build(const std::string& coasmCode, Program& program) {
+    reset();
+    bool ok = addSource(coasmCode, 1, program);
+    return finish(program) && ok;
+}
+
+void ProgramBuilder::reset() {
+    section_ = Section::Text;
+    functions_.clear();
+    currentKernel_ = -1;
+    kernelEntries_.clear();
+    version_.clear();
+    inArgs_ = false;
+}
+
+bool ProgramBuilder::addSource(std::string_view text, int firstLine, Program& program) {
+    int lineNo = firstLine - 1;
+    bool ok = true;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t newline = text.find('\n', pos);
+        if (newline == std::string_view::npos) newline = text.size();
+        ++lineNo;
+        ok = processLine(text.substr(pos, newline - pos), lineNo, program) && ok;
+        pos = newline + 1;
+    }
+    return ok;
+}
+
+bool ProgramBuilder::processLine(std::string_view rawLine, int lineNo, Program& program) {
+    std::string_view line = trim(stripComment(rawLine));
+    if (line.empty()) return true;
+    size_t indent = rawLine.find_first_not_of(" \t");
+
+    // YAML document markers around the metadata blocks.
+    if (line == "-" || line == "---" || line == "...") return true;
+    if (line == "opu.kernels:") { section_ = Section::Kernels; currentKernel_ = -1; return true; }
+    if (line == "opu.version:") { section_ = Section::Version; currentKernel_ = -1; return true; }
+
+    if (section_ == Section::Kernels) return processKernelsLine(line, indent, lineNo);
+    if (section_ == Section::Version) return processVersionLine(std::string(line), lineNo);
+
+    if (line[0] == '.') return processDirective(line, lineNo);
+
+    // Labels, optionally followed by an instruction on the same line.
+    size_t colon = line.find(':');
+    if (colon != std::string_view::npos && isIdentifier(line.substr(0, colon))) {
+        std::string label(line.substr(0, colon));
+        if (functions_.count(label)) {
+            if (program.findKernel(label)) return error(lineNo, "Redefinition of kernel '" + label + "'");
+            if (!program.arena) program.arena = std::make_shared<Arena>();
+            Kernel kernel;
+            kernel.arena = std::make_shared<Arena>(program.arena, kKernelArenaSize);
+            kernel.name = label;
+            kernel.line = lineNo;
+            program.kernels.push_back(std::move(kernel));
+            currentKernel_ = static_cast<int>(program.kernels.size()) - 1;
+        } else if (currentKernel_ < 0) {
+            return error(lineNo, "Label '" + label + "' outside of a kernel");
+        } else {
+            Kernel& kernel = program.kernels[currentKernel_];
+            if (!kernel.labels.emplace(label, kernel.instructions.size()).second) {
+                return error(lineNo, "Duplicate label '" + label + "'");
+            }
+        }
+        std::string_view rest = trim(line.substr(colon + 1));
+        return rest.empty() ? true : processLine(rest, lineNo, program);
+    }
+
+    if (currentKernel_ < 0) return error(lineNo, "Instruction outside of a kernel: '" + std::string(line) + "'");
+    return processInstruction(line, lineNo, program.kernels[currentKernel_]);
+}
+
+bool ProgramBuilder::processDirective(std::string_view line, int lineNo) {
+    const std::string_view directive = line.substr(0, line.find_first_of(kWhitespace));
+    if (directive == ".type") {
+        // ".type <name>,@function"; a single trailing comma is tolerated.
+        std::string_view rest = line.substr(directive.size());
+        if (!rest.empty() && rest.back() == ',') rest.remove_suffix(1);
+        const size_t comma = rest.find(',');
+        if (comma != std::string_view::npos && rest.find(',', comma + 1) == std::string_view::npos &&
+            trim(rest.substr(comma + 1)) == "@function") {
+            functions_.emplace(trim(rest.substr(0, comma)));
+        }
+        return true;
+    }
+    if (directive == ".text" || directive == ".global" || directive == ".globl" ||
+        directive == ".p2align" || directive == ".align" || directive == ".size") {
+        return true;
+    }
+    *diagnostics_ << "Warning: " << sourceName_ << ":" << lineNo << ": ignoring unknown directive '" << directive << "'"
+                  << std::endl;
+    return true;
+}
+
+bool ProgramBuilder::processInstruction(std::string_view text, int lineNo, Kernel& kernel) {
+    size_t split = text.find_first_of(" \t");
+    std::string mnemonic(text.substr(0, split));
+    std::string_view operandText = split == std::string_view::npos ? std::string_view() : text.substr(split + 1);
+
+    Instruction inst(kernel.arena ? kernel.arena->resource() : std::pmr::get_default_resource());
+    inst.line = lineNo;
+    if (!isa::parseMnemonic(mnemonic, inst.opcode, inst.type, inst.modifier)) {
+        return error(lineNo, "Unknown instruction '" + mnemonic + "'");
+    }
+
+    // The pieces only live for this line; a small stack buffer holds them.
+    std::array<std::byte, 512> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    std::pmr::vector<std::string_view> pieces(&scratch);
+    splitOperands(operandText, pieces);
+    size_t operandCount = pieces.size();
+    for (std::string_view piece : pieces) operandCount += piece.front() == '[' ? 1 : 0; // Base and offset
+    inst.operands.reserve(operandCount);
+
+    const isa::Format format = inst.info().format;
+    for (std::string_view piece : pieces) {
+        if (piece.front() == '[') {
+            if (format != isa::Format::MLOAD && format != isa::Format::MSTORE) {
+                return error(lineNo, "Unexpected address operand for '" + mnemonic + "'");
+            }
+            Operand base, offset;
+            if (!parseAddress(piece, base, offset, lineNo)) return false;
+            inst.operands.push_back(base);
+            inst.operands.push_back(offset);
+            continue;
+        }
+        Operand operand;
+        const bool barePredicate = format == isa::Format::SCBRANCH && inst.operands.empty();
+        if (!parseOperand(piece, operand, lineNo, barePredicate)) return false;
+        inst.operands.push_back(operand);
+    }
+
+    if (!checkOperands(inst, lineNo)) return false;
+    kernel.instructions.push_back(std::move(inst));
+    return true;
+}
+
+bool ProgramBuilder::parseOperand(std::string_view view, Operand& operand, int lineNo, bool barePredicate) {
+    if (view.empty()) return error(lineNo, "Empty operand");
+    if (parseRegister(view, operand, barePredicate)) {
+        if (operand.reg < 0 || operand.reg > 63) {
+            return error(lineNo, "Register index out of range in '" + std::string(view) + "'");
+        }
+        if (operand.kind == OperandKind::VReg64 && operand.reg % 2 != 0) {
+            return error(lineNo, "64-bit register '" + std::string(view) + "' must use an even index");
+        }
+        return true;
+    }
+    const std::string text(view);
+    int specialId;
+    if (isa::lookupSpecialRegister(text, specialId)) {
+        operand.kind = OperandKind::Special;
+        operand.reg = specialId;
+        return true;
+    }
+    if (text[0] == '%') return error(lineNo, "Unknown register '" + text + "'");
+    int64_t value;
+    if (parseImmediate(text, value)) {
+        operand.kind = OperandKind::Imm;
+        operand.imm = value;
+        return true;
+    }
+    if (isIdentifier(text)) {
+        operand.kind = OperandKind::Symbol;
+        operand.symbol = text;
+        return true;
+    }
+    return error(lineNo, "Invalid operand '" + text + "'");
+}
+
+bool ProgramBuilder::parseAddress(std::string_view text, Operand& base, Operand& offset, int lineNo) {
+    if (text.size() < 2 || text.back() != ']') return error(lineNo, "Malformed address '" + std::string(text) + "'");
+    std::string_view inner = text.substr(1, text.size() - 2);
+    size_t plus = inner.find('+');
+    if (!parseOperand(trim(inner.substr(0, plus)), base, lineNo)) return false;
+    if (!base.isRegister()) return error(lineNo, "Address base must be a register in '" + std::string(text) + "'");
+    if (plus == std::string_view::npos) {
+        offset.kind = OperandKind::Imm;
+        offset.imm = 0;
+        return true;
+    }
+    return parseOperand(trim(inner.substr(plus + 1)), offset, lineNo);
+}
+
+bool ProgramBuilder::checkOperands(const Instruction& inst, int lineNo) {
+    auto name = [&inst]() { return isa::formatMnemonic(inst.opcode, inst.type, inst.modifier); };
+    size_t expected = 0;
+    switch (inst.info().format) {
+        case isa::Format::VOP1:     expected = 2; break;
+        case isa::Format::VOP2:     expected = 3; break;
+        case isa::Format::VOP3:     expected = 4; break;
+        case isa::Format::VCMP:     expected = 3; break;
+        case isa::Format::MLOAD:    expected = 3; break;
+        case isa::Format::MSTORE:   expected = 3; break;
+        case isa::Format::SOPP:     expected = 0; break;
+        case isa::Format::SBRANCH:  expected = 1; break;
+        case isa::Format::SCBRANCH: expected = 2; break;
+    }
+    if (inst.operands.size() != expected) {
+        return error(lineNo, "'" + name() + "' expects " + std::to_string(expected) + " operands, got " +
+                             std::to_string(inst.operands.size()));
+    }
+
+    switch (inst.info().format) {
+        case isa::Format::VOP1:
+        case isa::Format::VOP2:
+        case isa::Format::VOP3:
+        case isa::Format::MLOAD:
+            if (!inst.operands[0].isRegister() || inst.operands[0].kind == OperandKind::PReg) {
+                return error(lineNo, "'" + name() + "' needs a %v, %vd or %s destination");
+            }
+            break;
+        case isa::Format::VCMP:
+            if (inst.operands[0].kind != OperandKind::PReg) {
+                return error(lineNo, "'" + name() + "' needs a %p destination");
+            }
+            break;
+        case isa::Format::SBRANCH:
+            if (inst.operands[0].kind != OperandKind::Symbol) return error(lineNo, "'" + name() + "' needs a label");
+            break;
+        case isa::Format::SCBRANCH:
+            if (inst.operands[0].kind != OperandKind::PReg || inst.operands[1].kind != OperandKind::Symbol) {
+                return error(lineNo, "'" + name() + "' needs a predicate and a label");
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+bool ProgramBuilder::processKernelsLine(std::string_view line, size_t indent, int lineNo) {
+    bool listItem = line.compare(0, 2, "- ") == 0;
+    std::array<std::byte, 1024> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    std::pmr::vector<std::string_view> words(&scratch);
+    splitWords(listItem ? line.substr(2) : line, words);
+
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> fields(&scratch);
+    for (size_t w = 0; w < words.size(); ++w) {
+        if (!isKey(words[w])) return error(lineNo, "Malformed opu.kernels entry '" + std::string(line) + "'");
+        std::string_view key = words[w].substr(0, words[w].size() - 1);
+        // A key followed by another key has no value (".args:").
+        std::string_view value = w + 1 < words.size() && !isKey(words[w + 1]) ? words[++w] : std::string_view();
+        fields.emplace_back(key, value);
+    }
+    if (fields.empty()) return true;
+
+    // Argument list items are indented deeper than the kernel list items.
+    if (listItem && inArgs_ && indent > kernelIndent_) {
+        KernelArg arg;
+        for (const auto& [key, value] : fields) {
+            int64_t number = 0;
+            if (key == ".name") arg.name = value;
+            else if (key == ".address_space") arg.addressSpace = value;
+            else if (key == ".value_kind") arg.valueKind = value;
+            else if ((key == ".offset" || key == ".size") && parseInteger(std::string(value), number)) {
+                (key == ".offset" ? arg.offset : arg.size) = static_cast<uint32_t>(number);
+            } else {
+                return error(lineNo, "Invalid kernel argument field '" + std::string(key) + "'");
+            }
+        }
+        kernelEntries_.back().args.push_back(std::move(arg));
+        return true;
+    }
+
+    inArgs_ = false;
+    if (listItem) {
+        if (fields[0].first != ".name") return error(lineNo, "opu.kernels entry must start with '.name'");
+        KernelEntry entry;
+        entry.name = fields[0].second;
+        entry.line = lineNo;
+        kernelEntries_.push_back(std::move(entry));
+        kernelIndent_ = indent;
+        fields.erase(fields.begin());
+    } else if (kernelEntries_.empty()) {
+        return error(lineNo, "opu.kernels entry before any '.name'");
+    }
+
+    for (const auto& [key, value] : fields) {
+        if (key == ".args") {
+            inArgs_ = true;
+            continue;
+        }
+        int64_t number = 0;
+        if (!parseInteger(std::string(value), number)) {
+            return error(lineNo, "Expected an integer value for '" + std::string(key) + "'");
+        }
+        kernelEntries_.back().metadata[std::string(key)] = number;
+    }
+    return true;
+}
+
+bool ProgramBuilder::processVersionLine(const std::string& line, int lineNo) {
+    int64_t value = 0;
+    if (line.compare(0, 2, "- ") != 0 || !parseInteger(utils::trim(line.substr(2)), value)) {
+        return error(lineNo, "Malformed opu.version entry '" + line + "'");
+    }
+    version_.push_back(static_cast<int>(value));
+    return true;
+}
+
+bool ProgramBuilder::finish(Program& program) {
+    bool ok = true;
+    program.version = version_;
+    for (KernelEntry& entry : kernelEntries_) {
+        Kernel* kernel = program.findKernel(entry.name);
+        if (!kernel) {
+            ok = error(entry.line, "opu.kernels entry for undefined kernel '" + entry.name + "'");
+            continue;
+        }
+        kernel->args = std::move(entry.args);
+        kernel->metadata = std::move(entry.metadata);
+    }
+
+    for (const Kernel& kernel : program.kernels) {
+        for (const Instruction& inst : kernel.instructions) {
+            if (!inst.isBranch()) continue;
+            const Operand& target = inst.operands.back();
+            if (!kernel.labels.count(target.symbol)) {
+                ok = error(inst.line, "Branch to undefined label '" + target.symbol + "' in kernel '" + kernel.name + "'");
+            }
+        }
+    }
+    return ok;
+}
+
+bool ProgramBuilder::error(int lineNo, const std::string& message) {
+    *diagnostics_ << "ProgramBuilder Error: " << sourceName_ << ":" << lineNo << ": " << message << std::endl;
+    return false;
+}
+
+} // namespace opuas
@@ -0,0 +1,65 @@
+// opuas/src/ProgramBuilder.h
+#ifndef PROGRAM_BUILDER_H
+#define PROGRAM_BUILDER_H
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Program.h"
+
+namespace opuas {
+
+// Lowers syntactically valid COASM source (already checked by the coasm_infra
+// parser) into the opuas internal representation: kernels, instructions,
+// labels and the opu.kernels / opu.version metadata.
+//
+// Lowering reads the source text line by line; it does not walk the ANTLR
+// tree, which only gates syntax. Operand forms are kept narrow: a bare "p0"
+// is a predicate only as a conditional branch's first operand.
+class ProgramBuilder {
+public:
+    explicit ProgramBuilder(const std::string& sourceName = "<input>", std::ostream& diagnostics = std::cerr);
+
+    bool build(const std::string& coasmCode, Program& program);
+    // build() in pieces: slices of one source in file order, each with the
+    // line it starts on, then finish().
+    void reset();
+    bool addSource(std::string_view text, int firstLine, Program& program);
+    bool finish(Program& program);
+
+private:
+    enum class Section { Text, Kernels, Version };
+
+    struct KernelEntry {
+        std::string name;
+        std::vector<KernelArg> args;
+        std::map<std::string, int64_t> metadata;
+        int line = 0;
+    };
+
+    bool processLine(std::string_view line, int lineNo, Program& program);
+    bool processDirective(std::string_view line, int lineNo);
+    bool processInstruction(std::string_view text, int lineNo, Kernel& kernel);
+    bool processKernelsLine(std::string_view line, size_t indent, int lineNo);
+    bool processVersionLine(const std::string& line, int lineNo);
+    bool parseOperand(std::string_view text, Operand& operand, int lineNo, bool barePredicate = false);
+    bool parseAddress(std::string_view text, Operand& base, Operand& offset, int lineNo);
+    bool checkOperands(const Instruction& inst, int lineNo);
+    bool error(int lineNo, const std::string& message);
+
+    std::string sourceName_;
+    std::ostream* diagnostics_;
+    Section section_ = Section::Text;
+    std::set<std::string> functions_;    // Symbols declared with .type <name>,@function
+    int currentKernel_ = -1;             // Index into Program::kernels
+    std::vector<KernelEntry> kernelEntries_;
+    std::vector<int> version_;
+    size_t kernelIndent_ = 0;            // Indentation of the current opu.kernels list item
+    bool inArgs_ = false;
+};
+
+} // namespace opuas
+
+#endif // PROGRAM_BUILDER_H
@@ -0,0 +1,17 @@
+// opuas/src/SourceChunk.h
+#ifndef SOURCE_CHUNK_H
+#define SOURCE_CHUNK_H
+
+#include <string>
+
+namespace opuas {
+
+// A slice of whole lines from a source file and the line it starts on.
+struct SourceChunk {
+    std::string text;
+    int firstLine = 1;
+};
+
+} // namespace opuas
+
+#endif // SOURCE_CHUNK_H
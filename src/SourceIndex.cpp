@@ -0,0 +1,253 @@
+// opuas/src/SourceIndex.cpp
+#include "SourceIndex.h"
+#include "utils.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace opuas {
+
+namespace {
+
+// Same comment syntax as ProgramBuilder.
+std::string_view stripComment(std::string_view line) {
+    size_t pos = line.find("//");
+    size_t semi = line.find(';');
+    if (semi != std::string_view::npos && (pos == std::string_view::npos || semi < pos)) pos = semi;
+    return line.substr(0, pos);
+}
+
+std::string_view trim(std::string_view text) {
+    const char* whitespace = " \t\n\r\f\v";
+    size_t start = text.find_first_not_of(whitespace);
+    if (start == std::string_view::npos) return {};
+    return text.substr(start, text.find_last_not_of(whitespace) - start + 1);
+}
+
+} // namespace
+
+SourceIndex::SourceIndex(const std::string& sourceName) : sourceName_(sourceName) {}
+
+bool SourceIndex::scan(std::istream& input) {
+    *this = SourceIndex(sourceName_);
+
+    std::string line;
+    uint64_t offset = 0;
+    int lineNo = 0;
+    while (std::getline(input, line)) {
+        ++lineNo;
+        const uint64_t end = offset + line.size() + (input.eof() ? 0 : 1);
+        processLine(line, offset, end, lineNo);
+        offset = end;
+    }
+    if (input.bad()) return error(lineNo, "read failed");
+    finishScan(offset, lineNo);
+    return ok_;
+}
+
+bool SourceIndex::scan(std::string_view text) {
+    *this = SourceIndex(sourceName_);
+
+    uint64_t offset = 0;
+    int lineNo = 0;
+    while (offset < text.size()) {
+        ++lineNo;
+        size_t newline = text.find('\n', offset);
+        if (newline == std::string_view::npos) newline = text.size();
+        const uint64_t end = std::min<uint64_t>(newline + 1, text.size());
+        processLine(text.substr(offset, newline - offset), offset, end, lineNo);
+        offset = end;
+    }
+    finishScan(offset, lineNo);
+    return ok_;
+}
+
+const std::vector<KernelChunk>& SourceIndex::getChunks() const {
+    return chunks_;
+}
+
+bool SourceIndex::chunkSource(std::istream& input, size_t index, std::vector<SourceChunk>& source) const {
+    source.clear();
+    if (index >= chunks_.size()) return false;
+
+    for (const SourceRange& range : chunkRanges(index)) {
+        SourceChunk chunk;
+        chunk.firstLine = range.firstLine;
+        chunk.text.resize(range.end - range.begin);
+        input.clear();
+        input.seekg(static_cast<std::streamoff>(range.begin));
+        input.read(&chunk.text[0], static_cast<std::streamsize>(chunk.text.size()));
+        if (static_cast<uint64_t>(input.gcount()) != chunk.text.size()) {
+            return error(range.firstLine, "could not read back the source");
+        }
+        source.push_back(std::move(chunk));
+    }
+    return true;
+}
+
+bool SourceIndex::chunkSource(std::string_view text, size_t index, std::vector<SourceChunk>& source) const {
+    source.clear();
+    if (index >= chunks_.size()) return false;
+
+    for (const SourceRange& range : chunkRanges(index)) {
+        if (range.end > text.size()) return false;
+        source.push_back({std::string(text.substr(range.begin, range.end - range.begin)), range.firstLine});
+    }
+    return true;
+}
+
+void SourceIndex::finishScan(uint64_t offset, int lineNo) {
+    if (!textClosed_) closeText(offset, lineNo + 1);
+    if (metadataOpen_) metadata_.back().range.end = offset;
+    metadataOpen_ = false;
+
+    chunkMetadata_.assign(chunks_.size(), {});
+    for (size_t i = 0; i < metadata_.size(); ++i) {
+        if (metadata_[i].kernel.empty()) {
+            sharedMetadata_.push_back(i);
+            continue;
+        }
+        auto owner = kernelChunk_.find(metadata_[i].kernel);
+        chunkMetadata_[owner == kernelChunk_.end() ? 0 : owner->second].push_back(i);
+    }
+}
+
+std::vector<SourceRange> SourceIndex::chunkRanges(size_t index) const {
+    std::vector<size_t> metadata = sharedMetadata_;
+    metadata.insert(metadata.end(), chunkMetadata_[index].begin(), chunkMetadata_[index].end());
+    std::sort(metadata.begin(), metadata.end());
+    std::vector<SourceRange> declarations = chunkDeclarations_[index];
+    std::sort(declarations.begin(), declarations.end(),
+              [](const SourceRange& a, const SourceRange& b) { return a.begin < b.begin; });
+    std::vector<SourceRange> ranges = {prologue_};
+    ranges.insert(ranges.end(), declarations.begin(), declarations.end());
+    ranges.push_back(chunks_[index].code);
+    for (size_t i : metadata) ranges.push_back(metadata_[i].range);
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [](const SourceRange& range) { return range.empty(); }),
+                 ranges.end());
+    return ranges;
+}
+
+void SourceIndex::processLine(std::string_view rawLine, uint64_t begin, uint64_t end, int lineNo) {
+    const std::string_view line = trim(stripComment(rawLine));
+    if (line == "opu.kernels:" || line == "opu.version:") {
+        if (!textClosed_) closeText(begin, lineNo);
+        section_ = line == "opu.kernels:" ? Section::Kernels : Section::Version;
+        inArgs_ = false;
+        openMetadata("", begin, lineNo);
+        return;
+    }
+    if (section_ == Section::Text) {
+        processTextLine(line, begin, end, lineNo);
+    } else if (section_ == Section::Kernels && !line.empty()) {
+        processKernelsLine(line, rawLine.find_first_not_of(" \t"), begin, lineNo);
+    }
+}
+
+void SourceIndex::processTextLine(std::string_view line, uint64_t begin, uint64_t end, int lineNo) {
+    if (line.empty() || line == "-" || line == "---" || line == "...") return;
+
+    if (line[0] == '.') {
+        std::istringstream words{std::string(line)};
+        std::string directive;
+        words >> directive;
+        if (directive != ".global" && directive != ".globl" && directive != ".type") return;
+        if (chunks_.empty() || chunkHasKernel_) startChunk(begin, lineNo);
+        if (directive == ".type") {
+            std::string rest;
+            std::getline(words, rest);
+            std::vector<std::string> parts = utils::split(rest, ',');
+            if (parts.size() == 2 && utils::trim(parts[1]) == "@function") {
+                const std::string name = utils::trim(parts[0]);
+                functions_.insert(name);
+                declarations_.emplace(name, SourceRange{begin, end, lineNo});
+            }
+        }
+        return;
+    }
+
+    if (chunks_.empty()) startChunk(begin, lineNo);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        const std::string label(line.substr(0, colon));
+        if (functions_.count(label)) {
+            if (!kernelChunk_.emplace(label, chunks_.size() - 1).second) {
+                error(lineNo, "Redefinition of kernel '" + label + "'");
+            }
+            chunks_.back().kernels.push_back(label);
+            chunkHasKernel_ = true;
+            const SourceRange& declaration = declarations_[label];
+            if (declaration.begin < chunks_.back().code.begin) chunkDeclarations_.back().push_back(declaration);
+        }
+    }
+    contentEnd_ = end;
+    contentEndLine_ = lineNo + 1;
+}
+
+void SourceIndex::processKernelsLine(std::string_view line, size_t indent, uint64_t begin, int lineNo) {
+    // Argument list items are indented deeper than the kernel list items.
+    const bool listItem = line.compare(0, 2, "- ") == 0;
+    if (listItem && inArgs_ && indent > entryIndent_) return;
+
+    inArgs_ = false;
+    if (listItem) {
+        const std::string_view item = trim(line.substr(2));
+        const size_t keyEnd = std::min(item.find_first_of(" \t"), item.size());
+        if (item.substr(0, keyEnd) == ".name:") {
+            std::string_view name = trim(item.substr(keyEnd));
+            openMetadata(std::string(name.substr(0, name.find_first_of(" \t"))), begin, lineNo);
+            entryIndent_ = indent;
+        }
+    }
+    if (line.find(".args:") != std::string_view::npos) inArgs_ = true;
+}
+
+void SourceIndex::startChunk(uint64_t begin, int lineNo) {
+    if (chunks_.empty()) {
+        prologue_.end = begin;
+    } else {
+        chunks_.back().code.end = begin;
+    }
+    KernelChunk chunk;
+    chunk.code.begin = chunk.code.end = begin;
+    chunk.code.firstLine = lineNo;
+    chunks_.push_back(std::move(chunk));
+    chunkDeclarations_.emplace_back();
+    chunkHasKernel_ = false;
+}
+
+void SourceIndex::closeText(uint64_t begin, int lineNo) {
+    textClosed_ = true;
+    if (chunks_.empty()) startChunk(begin, lineNo);
+
+    // Lines after the last code line (the "-" document marker, trailing
+    // directives) are needed by every chunk.
+    SourceRange& code = chunks_.back().code;
+    if (contentEnd_ > code.begin) {
+        code.end = contentEnd_;
+        openMetadata("", contentEnd_, contentEndLine_);
+    } else {
+        code.end = code.begin;
+        openMetadata("", code.begin, code.firstLine);
+    }
+}
+
+void SourceIndex::openMetadata(const std::string& kernel, uint64_t begin, int lineNo) {
+    // Shared lines continue the open shared range.
+    if (metadataOpen_ && kernel.empty() && metadata_.back().kernel.empty()) return;
+    if (metadataOpen_) metadata_.back().range.end = begin;
+    MetadataRange metadata;
+    metadata.kernel = kernel;
+    metadata.range.begin = begin;
+    metadata.range.firstLine = lineNo;
+    metadata_.push_back(std::move(metadata));
+    metadataOpen_ = true;
+}
+
+bool SourceIndex::error(int lineNo, const std::string& message) const {
+    std::cerr << "SourceIndex Error: " << sourceName_ << ":" << lineNo << ": " << message << std::endl;
+    ok_ = false;
+    return false;
+}
+
+} // namespace opuas
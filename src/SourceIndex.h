@@ -0,0 +1,105 @@
+// opuas/src/SourceIndex.h
+#ifndef SOURCE_INDEX_H
+#define SOURCE_INDEX_H
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SourceChunk.h"
+
+namespace opuas {
+
+// Byte range of whole lines in a source file.
+struct SourceRange {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    int firstLine = 1;
+
+    bool empty() const { return begin == end; }
+};
+
+// A stretch of .text holding one kernel. Declarations far from their code
+// (all .type lines at the top, say) make one chunk cover several kernels.
+struct KernelChunk {
+    SourceRange code;
+    std::vector<std::string> kernels;
+};
+
+// Indexes a COASM file in one pass without keeping its text: where each
+// kernel's code is and where its opu.kernels entry is, which in COASM only
+// follows all of the code. A kernel can then be parsed on its own from
+// chunkSource(), so memory follows the largest kernel rather than the file.
+//
+// A chunk starts at the first .global/.globl/.type directive after the
+// previous chunk's kernel label, so it carries its own declarations. A
+// kernel declared in an earlier chunk (declarations hoisted to the top of
+// the file, say) also gets its .type line.
+class SourceIndex {
+public:
+    explicit SourceIndex(const std::string& sourceName = "<input>");
+
+    bool scan(std::istream& input);
+    // Same index for a source already in memory (a mapped file, say).
+    bool scan(std::string_view text);
+
+    // At least one chunk once scan() succeeded (empty for an empty file).
+    const std::vector<KernelChunk>& getChunks() const;
+    // Everything needed to parse chunk `index` alone, in file order: the
+    // lines before the first chunk, its code, the lines between the code and
+    // opu.kernels, the opu.kernels entries of its kernels and opu.version.
+    // Entries naming no kernel go with chunk 0 so the parser reports them.
+    bool chunkSource(std::istream& input, size_t index, std::vector<SourceChunk>& source) const;
+    // From the text given to scan(); safe to call from several threads, so
+    // it reports nothing itself.
+    bool chunkSource(std::string_view text, size_t index, std::vector<SourceChunk>& source) const;
+
+private:
+    enum class Section { Text, Kernels, Version };
+
+    // Lines after the code: an opu.kernels entry of `kernel`, or lines every
+    // chunk needs (document markers, headers, opu.version) when it is empty.
+    struct MetadataRange {
+        std::string kernel;
+        SourceRange range;
+    };
+
+    void processLine(std::string_view line, uint64_t begin, uint64_t end, int lineNo);
+    void processTextLine(std::string_view line, uint64_t begin, uint64_t end, int lineNo);
+    void processKernelsLine(std::string_view line, size_t indent, uint64_t begin, int lineNo);
+    void finishScan(uint64_t offset, int lineNo);
+    std::vector<SourceRange> chunkRanges(size_t index) const;
+    void startChunk(uint64_t begin, int lineNo);
+    void closeText(uint64_t begin, int lineNo);
+    void openMetadata(const std::string& kernel, uint64_t begin, int lineNo);
+    bool error(int lineNo, const std::string& message) const;
+
+    std::string sourceName_;
+    Section section_ = Section::Text;
+    mutable bool ok_ = true;
+
+    SourceRange prologue_;               // Lines before the first chunk
+    std::vector<KernelChunk> chunks_;
+    bool chunkHasKernel_ = false;
+    bool textClosed_ = false;
+    uint64_t contentEnd_ = 0;            // End of the last code line in .text
+    int contentEndLine_ = 1;
+    std::set<std::string> functions_;    // Declared with .type <name>,@function
+    std::map<std::string, SourceRange> declarations_;   // First .type line of each function
+    std::vector<std::vector<SourceRange>> chunkDeclarations_;   // Per chunk, from earlier chunks
+    std::map<std::string, size_t> kernelChunk_;
+
+    std::vector<MetadataRange> metadata_;
+    std::vector<size_t> sharedMetadata_;               // Indices into metadata_
+    std::vector<std::vector<size_t>> chunkMetadata_;   // Per chunk
+    bool metadataOpen_ = false;
+    bool inArgs_ = false;
+    size_t entryIndent_ = 0;
+};
+
+} // namespace opuas
+
+#endif // SOURCE_INDEX_H
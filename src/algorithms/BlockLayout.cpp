@@ -0,0 +1,251 @@
+// opuas/src/algorithms/BlockLayout.cpp
+#include "BlockLayout.h"
+#include "ControlFlowGraph.h"
+#include "Arena.h"
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+namespace opuas {
+namespace algorithms {
+
+namespace {
+
+constexpr size_t kNone = static_cast<size_t>(-1);
+
+struct Edge {
+    size_t from;
+    size_t to;
+    uint64_t weight;
+    bool fallThrough;   // Falls through in the original layout
+};
+
+// Edge weights from block counts; branch bias splits a conditional block
+// when known, otherwise a successor entered only from this block tells
+// how often that side was taken.
+std::vector<Edge> weighEdges(const std::pmr::vector<BasicBlock>& blocks, const std::vector<Instruction>& insts,
+                             const std::vector<uint64_t>& blockCounts, const LayoutProfile& profile) {
+    std::vector<Edge> edges;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const BasicBlock& block = blocks[b];
+        const uint64_t count = blockCounts[b];
+        const Instruction& last = insts[block.end - 1];
+        if (last.info().format != isa::Format::SCBRANCH || block.succs.size() < 2) {
+            for (size_t succ : block.succs) edges.push_back({b, succ, count, block.fallsThrough && succ == b + 1});
+            continue;
+        }
+
+        const size_t taken = block.succs[0];
+        const size_t fall = block.succs[1];
+        uint64_t takenWeight = 0;
+        auto bias = profile.branchBias.find(block.end - 1);
+        if (bias != profile.branchBias.end() && bias->second.first + bias->second.second > 0) {
+            const double ratio = static_cast<double>(bias->second.first) /
+                                 static_cast<double>(bias->second.first + bias->second.second);
+            takenWeight = static_cast<uint64_t>(count * ratio + 0.5);
+        } else if (blocks[fall].preds.size() == 1) {
+            takenWeight = count - std::min(count, blockCounts[fall]);
+        } else if (blocks[taken].preds.size() == 1) {
+            takenWeight = std::min(count, blockCounts[taken]);
+        } else {
+            takenWeight = count - std::min(count, blockCounts[fall]);
+        }
+        edges.push_back({b, taken, takenWeight, false});
+        edges.push_back({b, fall, count - takenWeight, true});
+    }
+    return edges;
+}
+
+uint64_t takenBranches(const std::vector<Edge>& edges, const std::vector<size_t>& position) {
+    uint64_t taken = 0;
+    for (const Edge& edge : edges) {
+        if (position[edge.to] != position[edge.from] + 1) taken += edge.weight;
+    }
+    return taken;
+}
+
+} // namespace
+
+BlockLayout::BlockLayout(Kernel& kernel) : kernel_(kernel) {}
+
+bool BlockLayout::apply(const LayoutProfile& profile) {
+    stats_ = LayoutStats();
+    const std::vector<Instruction>& insts = kernel_.instructions;
+    if (insts.empty()) return true;
+    for (const auto& [label, index] : kernel_.labels) {
+        if (index >= insts.size()) {
+            std::cerr << "BlockLayout Warning: kernel '" << kernel_.name << "': label '" << label
+                      << "' follows the last instruction; layout skipped.\n";
+            return true;
+        }
+    }
+    if (insts.back().opcode != isa::Opcode::Exit && insts.back().opcode != isa::Opcode::Branch) {
+        std::cerr << "BlockLayout Warning: kernel '" << kernel_.name
+                  << "' can fall off its end; layout skipped.\n";
+        return true;
+    }
+
+    Arena scratch;
+    ControlFlowGraph cfg(kernel_, scratch.resource());
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    const size_t numBlocks = blocks.size();
+
+    // Block count: the highest count seen on its instructions. Blocks the
+    // profile does not cover inherit from their fall-through predecessor.
+    std::vector<uint64_t> blockCounts(numBlocks, 0);
+    for (size_t b = 0; b < numBlocks; ++b) {
+        bool known = false;
+        for (auto it = profile.counts.lower_bound(blocks[b].begin);
+             it != profile.counts.end() && it->first < blocks[b].end; ++it) {
+            blockCounts[b] = std::max(blockCounts[b], it->second);
+            known = true;
+        }
+        if (!known && b > 0 && blocks[b - 1].fallsThrough) blockCounts[b] = blockCounts[b - 1];
+    }
+
+    std::vector<Edge> edges = weighEdges(blocks, insts, blockCounts, profile);
+
+    // 1. Chain blocks along the heaviest edges. The entry block stays first.
+    std::vector<std::vector<size_t>> chains(numBlocks);
+    std::vector<size_t> chainOf(numBlocks);
+    for (size_t b = 0; b < numBlocks; ++b) {
+        chains[b] = {b};
+        chainOf[b] = b;
+    }
+    std::vector<Edge> sorted = edges;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Edge& a, const Edge& b) {
+        return std::make_tuple(a.weight, a.fallThrough) > std::make_tuple(b.weight, b.fallThrough);
+    });
+    for (const Edge& edge : sorted) {
+        if (edge.weight == 0) break;
+        const size_t from = chainOf[edge.from];
+        const size_t to = chainOf[edge.to];
+        if (edge.to == 0 || from == to || chains[from].back() != edge.from || chains[to].front() != edge.to) {
+            continue;
+        }
+        for (size_t b : chains[to]) {
+            chains[from].push_back(b);
+            chainOf[b] = from;
+        }
+        chains[to].clear();
+    }
+
+    // 2. Entry chain first, then chains by their hottest block; never-executed
+    // chains keep their relative order at the end.
+    std::vector<size_t> chainOrder;
+    for (size_t c = 0; c < numBlocks; ++c) {
+        if (!chains[c].empty() && c != chainOf[0]) chainOrder.push_back(c);
+    }
+    auto heat = [&](size_t c) {
+        uint64_t hottest = 0;
+        for (size_t b : chains[c]) hottest = std::max(hottest, blockCounts[b]);
+        return hottest;
+    };
+    std::stable_sort(chainOrder.begin(), chainOrder.end(), [&](size_t a, size_t b) { return heat(a) > heat(b); });
+    chainOrder.insert(chainOrder.begin(), chainOf[0]);
+
+    std::vector<size_t> order;
+    for (size_t c : chainOrder) order.insert(order.end(), chains[c].begin(), chains[c].end());
+    std::vector<size_t> position(numBlocks), identity(numBlocks);
+    for (size_t k = 0; k < numBlocks; ++k) {
+        position[order[k]] = k;
+        identity[k] = k;
+    }
+    stats_.takenBefore = takenBranches(edges, identity);
+    stats_.takenAfter = takenBranches(edges, position);
+
+    // 3. Emit blocks in the new order, fixing up their terminators.
+    std::multimap<size_t, std::string> labelsAt = kernel_.labelsByIndex();
+    std::vector<std::string> blockLabel(numBlocks);
+    for (size_t b = 0; b < numBlocks; ++b) blockLabel[b] = blocks[b].label;
+    auto labelFor = [&](size_t b) {
+        if (blockLabel[b].empty()) {
+            std::string name = "BB_layout_" + std::to_string(b);
+            while (kernel_.labels.count(name)) name += "_";
+            blockLabel[b] = name;
+        }
+        return blockLabel[b];
+    };
+    auto jumpTo = [&](size_t b, int line) {
+        Instruction jump;
+        jump.opcode = isa::Opcode::Branch;
+        Operand target;
+        target.kind = OperandKind::Symbol;
+        target.symbol = labelFor(b);
+        jump.operands.push_back(target);
+        jump.line = line;
+        return jump;
+    };
+
+    LayoutStats counts;
+    std::vector<Instruction> newInsts;
+    std::vector<size_t> newStart(numBlocks);
+    for (size_t k = 0; k < numBlocks; ++k) {
+        const size_t b = order[k];
+        const BasicBlock& block = blocks[b];
+        const size_t next = k + 1 < numBlocks ? order[k + 1] : kNone;
+        if (b != k) ++counts.blocksMoved;
+        newStart[b] = newInsts.size();
+        newInsts.insert(newInsts.end(), insts.begin() + block.begin, insts.begin() + block.end - 1);
+
+        Instruction last = insts[block.end - 1];
+        const isa::Format format = last.info().format;
+        if (last.opcode == isa::Opcode::Branch && !block.succs.empty()) {
+            if (block.succs[0] == next) {
+                ++counts.branchesRemoved;
+                continue;
+            }
+            newInsts.push_back(last);
+        } else if (format == isa::Format::SCBRANCH && block.succs.size() == 2) {
+            const size_t taken = block.succs[0];
+            const size_t fall = block.succs[1];
+            if (fall == next) {
+                newInsts.push_back(last);
+            } else if (taken == next) {
+                last.opcode = last.opcode == isa::Opcode::BranchTccnz ? isa::Opcode::BranchTccz
+                                                                        : isa::Opcode::BranchTccnz;
+                last.operands[1].symbol = labelFor(fall);
+                newInsts.push_back(last);
+                ++counts.branchesFlipped;
+            } else {
+                newInsts.push_back(last);
+                newInsts.push_back(jumpTo(fall, last.line));
+                ++counts.branchesAdded;
+            }
+        } else {
+            newInsts.push_back(last);
+            if (block.fallsThrough && next != b + 1) {
+                newInsts.push_back(jumpTo(b + 1, last.line));
+                ++counts.branchesAdded;
+            }
+        }
+    }
+
+    bool improves = stats_.takenAfter < stats_.takenBefore ||
+                    (stats_.takenAfter == stats_.takenBefore && counts.blocksMoved > 0 &&
+                     counts.branchesAdded <= counts.branchesRemoved);
+    if (!improves) return true;
+
+    std::map<std::string, size_t> newLabels;
+    for (size_t b = 0; b < numBlocks; ++b) {
+        auto range = labelsAt.equal_range(blocks[b].begin);
+        for (auto it = range.first; it != range.second; ++it) newLabels[it->second] = newStart[b];
+        if (!blockLabel[b].empty()) newLabels[blockLabel[b]] = newStart[b];
+    }
+
+    counts.applied = true;
+    counts.takenBefore = stats_.takenBefore;
+    counts.takenAfter = stats_.takenAfter;
+    stats_ = counts;
+    kernel_.instructions = std::move(newInsts);
+    kernel_.labels = std::move(newLabels);
+    return true;
+}
+
+const LayoutStats& BlockLayout::getStats() const {
+    return stats_;
+}
+
+} // namespace algorithms
+} // namespace opuas
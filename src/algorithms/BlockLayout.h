@@ -0,0 +1,52 @@
+// opuas/src/algorithms/BlockLayout.h
+#ifndef BLOCK_LAYOUT_H
+#define BLOCK_LAYOUT_H
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include "Program.h"
+
+namespace opuas {
+namespace algorithms {
+
+// Execution counts for one kernel, keyed by instruction index. Instructions
+// without an entry are unknown rather than cold.
+struct LayoutProfile {
+    std::map<size_t, uint64_t> counts;
+    // Conditional branch index -> (taken, not taken) weight, e.g. lane counts.
+    std::map<size_t, std::pair<uint64_t, uint64_t>> branchBias;
+};
+
+struct LayoutStats {
+    bool applied = false;
+    int blocksMoved = 0;
+    int branchesFlipped = 0;
+    int branchesAdded = 0;
+    int branchesRemoved = 0;
+    uint64_t takenBefore = 0;   // Estimated dynamic taken branches
+    uint64_t takenAfter = 0;
+};
+
+// Profile-guided basic block placement (bottom-up chain merging). Blocks
+// joined by the heaviest edges are chained so those edges fall through;
+// chains are then placed by hotness with never-executed blocks last.
+// Branches are flipped or added to keep the control flow, so the kernel
+// must be relaid out before labels are resolved and stalls are set.
+class BlockLayout {
+public:
+    explicit BlockLayout(Kernel& kernel);
+
+    // Rewrites the kernel when the profile predicts fewer taken branches.
+    bool apply(const LayoutProfile& profile);
+    const LayoutStats& getStats() const;
+
+private:
+    Kernel& kernel_;
+    LayoutStats stats_;
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // BLOCK_LAYOUT_H
@@ -0,0 +1,180 @@
+// opuas/src/algorithms/ControlFlowGraph.cpp
+#include "ControlFlowGraph.h"
+#include <algorithm>
+#include <utility>
+
+namespace opuas {
+namespace algorithms {
+
+ControlFlowGraph::ControlFlowGraph(const Kernel& kernel, std::pmr::memory_resource* resource)
+    : blocks_(resource), blockOfInstruction_(resource), idom_(resource), rpoNumber_(resource) {
+    const std::vector<Instruction>& insts = kernel.instructions;
+    if (insts.empty()) return;
+
+    // Leaders, and the first label (by name) on each instruction.
+    std::pmr::vector<char> leader(insts.size(), 0, resource);
+    std::pmr::vector<const std::string*> labelAt(insts.size(), nullptr, resource);
+    leader[0] = 1;
+    for (const auto& [label, index] : kernel.labels) {
+        if (index >= insts.size()) continue;
+        leader[index] = 1;
+        if (!labelAt[index]) labelAt[index] = &label;
+    }
+    for (size_t i = 0; i + 1 < insts.size(); ++i) {
+        if (insts[i].isTerminator()) leader[i + 1] = 1;
+    }
+
+    blockOfInstruction_.assign(insts.size(), 0);
+    for (size_t begin = 0; begin < insts.size();) {
+        size_t end = begin + 1;
+        while (end < insts.size() && !leader[end]) ++end;
+        BasicBlock& block = blocks_.emplace_back();
+        block.begin = begin;
+        block.end = end;
+        if (labelAt[begin]) block.label = *labelAt[begin];
+        for (size_t i = begin; i < end; ++i) blockOfInstruction_[i] = blocks_.size() - 1;
+        begin = end;
+    }
+
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        BasicBlock& block = blocks_[b];
+        const Instruction& last = insts[block.end - 1];
+        if (last.isBranch()) {
+            auto target = kernel.labels.find(last.operands.back().symbol);
+            if (target != kernel.labels.end() && target->second < insts.size()) {
+                block.succs.push_back(blockOfInstruction_[target->second]);
+            }
+        }
+        block.fallsThrough = last.opcode != isa::Opcode::Exit && last.opcode != isa::Opcode::Branch &&
+                             b + 1 < blocks_.size();
+        if (block.fallsThrough) block.succs.push_back(b + 1);
+    }
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        for (size_t succ : blocks_[b].succs) blocks_[succ].preds.push_back(b);
+    }
+    computeDominators();
+}
+
+// Cooper, Harvey and Kennedy's iterative algorithm: process blocks in reverse
+// postorder and intersect the dominator chains of the processed predecessors
+// until nothing changes.
+void ControlFlowGraph::computeDominators() {
+    const size_t n = blocks_.size();
+    idom_.assign(n, kNoBlock);
+    rpoNumber_.assign(n, kNoBlock);
+    if (n == 0) return;
+
+    // Postorder by an explicit DFS from the entry.
+    std::vector<size_t> order;
+    std::vector<char> visited(n, 0);
+    std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+    visited[0] = 1;
+    while (!stack.empty()) {
+        auto& [b, next] = stack.back();
+        if (next < blocks_[b].succs.size()) {
+            const size_t succ = blocks_[b].succs[next++];
+            if (!visited[succ]) {
+                visited[succ] = 1;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            order.push_back(b);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) rpoNumber_[order[i]] = i;
+
+    auto intersect = [&](size_t a, size_t b) {
+        while (a != b) {
+            while (rpoNumber_[a] > rpoNumber_[b]) a = idom_[a];
+            while (rpoNumber_[b] > rpoNumber_[a]) b = idom_[b];
+        }
+        return a;
+    };
+    idom_[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            const size_t b = order[i];
+            size_t dom = kNoBlock;
+            for (size_t pred : blocks_[b].preds) {
+                if (idom_[pred] == kNoBlock) continue;
+                dom = dom == kNoBlock ? pred : intersect(pred, dom);
+            }
+            if (idom_[b] != dom) {
+                idom_[b] = dom;
+                changed = true;
+            }
+        }
+    }
+}
+
+const std::pmr::vector<BasicBlock>& ControlFlowGraph::getBlocks() const {
+    return blocks_;
+}
+
+size_t ControlFlowGraph::blockOf(size_t instructionIndex) const {
+    return blockOfInstruction_[instructionIndex];
+}
+
+bool ControlFlowGraph::dominates(size_t dominator, size_t block) const {
+    if (idom_[dominator] == kNoBlock || idom_[block] == kNoBlock) return false;
+    // Walk up the dominator tree; positions only decrease on the way to the entry.
+    while (rpoNumber_[block] > rpoNumber_[dominator]) block = idom_[block];
+    return block == dominator;
+}
+
+bool ControlFlowGraph::isLoopHeader(size_t blockIndex) const {
+    for (size_t pred : blocks_[blockIndex].preds) {
+        if (dominates(blockIndex, pred)) return true;
+    }
+    return false;
+}
+
+std::vector<Loop> ControlFlowGraph::findLoops() const {
+    std::vector<Loop> loops;
+    for (size_t header = 0; header < blocks_.size(); ++header) {
+        Loop loop;
+        loop.header = header;
+        for (size_t pred : blocks_[header].preds) {
+            if (dominates(header, pred)) loop.latches.push_back(pred);
+        }
+        if (loop.latches.empty()) continue;
+
+        // Walk predecessors back from the latches; the header stops the walk.
+        // The header dominates every latch, so the walk stays inside the
+        // loop except through unreachable blocks, which are left out.
+        std::vector<char> inLoop(blocks_.size(), 0);
+        inLoop[header] = 1;
+        std::vector<size_t> work = loop.latches;
+        while (!work.empty()) {
+            size_t b = work.back();
+            work.pop_back();
+            if (inLoop[b] || idom_[b] == kNoBlock) continue;
+            inLoop[b] = 1;
+            for (size_t pred : blocks_[b].preds) work.push_back(pred);
+        }
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            if (inLoop[b]) loop.blocks.push_back(b);
+        }
+        std::swap(*std::find(loop.blocks.begin(), loop.blocks.end(), header), loop.blocks.front());
+        std::sort(loop.blocks.begin() + 1, loop.blocks.end());
+        loops.push_back(std::move(loop));
+    }
+
+    for (Loop& loop : loops) {
+        for (const Loop& outer : loops) {
+            if (&outer != &loop && outer.blocks.size() > loop.blocks.size() &&
+                std::find(outer.blocks.begin(), outer.blocks.end(), loop.header) != outer.blocks.end()) {
+                loop.depth++;
+            }
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(),
+                     [](const Loop& a, const Loop& b) { return a.header < b.header; });
+    return loops;
+}
+
+} // namespace algorithms
+} // namespace opuas
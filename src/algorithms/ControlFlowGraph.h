@@ -0,0 +1,83 @@
+// opuas/src/algorithms/ControlFlowGraph.h
+#ifndef CONTROL_FLOW_GRAPH_H
+#define CONTROL_FLOW_GRAPH_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "Program.h"
+
+namespace opuas {
+namespace algorithms {
+
+struct BasicBlock {
+    // Allocator-aware, so the edge lists share the graph's memory resource.
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    BasicBlock() = default;
+    explicit BasicBlock(const allocator_type& alloc) : succs(alloc), preds(alloc) {}
+    BasicBlock(const BasicBlock& other, const allocator_type& alloc)
+        : begin(other.begin), end(other.end), label(other.label), succs(other.succs, alloc),
+          preds(other.preds, alloc), fallsThrough(other.fallsThrough) {}
+    BasicBlock(BasicBlock&& other, const allocator_type& alloc)
+        : begin(other.begin), end(other.end), label(std::move(other.label)), succs(std::move(other.succs), alloc),
+          preds(std::move(other.preds), alloc), fallsThrough(other.fallsThrough) {}
+    BasicBlock(const BasicBlock&) = default;
+    BasicBlock(BasicBlock&&) = default;
+    BasicBlock& operator=(const BasicBlock&) = default;
+    BasicBlock& operator=(BasicBlock&&) = default;
+
+    size_t begin = 0;                  // First instruction index
+    size_t end = 0;                    // One past the last instruction index
+    std::string label;                 // First label on the block, if any
+    std::pmr::vector<size_t> succs;    // Successor block indices (taken target first)
+    std::pmr::vector<size_t> preds;
+    bool fallsThrough = false;         // Reaches the next block in layout order
+};
+
+// The natural loop of the back edges to one header (edges whose target
+// dominates their source): the header plus every block that reaches one of
+// those edges without passing through the header.
+struct Loop {
+    size_t header = 0;
+    std::vector<size_t> blocks;     // Block indices in layout order, header first
+    std::vector<size_t> latches;    // Sources of the back edges
+    int depth = 1;                  // 1 for an outermost loop
+};
+
+// Basic blocks of one kernel in layout order. Leaders are the kernel entry,
+// every labelled instruction and every instruction following a terminator.
+// Block 0 is the entry; dominators are computed when the graph is built.
+class ControlFlowGraph {
+public:
+    // Blocks and edges are allocated from `resource`, normally a pass's
+    // scratch Arena.
+    explicit ControlFlowGraph(const Kernel& kernel,
+                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    const std::pmr::vector<BasicBlock>& getBlocks() const;
+    size_t blockOf(size_t instructionIndex) const;
+    // True when every path from the entry to `block` passes through
+    // `dominator`. Unreachable blocks are dominated by nothing.
+    bool dominates(size_t dominator, size_t block) const;
+    // True for targets of a back edge (a predecessor the block dominates).
+    bool isLoopHeader(size_t blockIndex) const;
+    // Natural loops ordered by header block index; `depth` counts the loops
+    // containing each one.
+    std::vector<Loop> findLoops() const;
+
+private:
+    std::pmr::vector<BasicBlock> blocks_;
+    std::pmr::vector<size_t> blockOfInstruction_;
+    std::pmr::vector<size_t> idom_;            // Immediate dominator; kNoBlock if unreachable
+    std::pmr::vector<size_t> rpoNumber_;       // Reverse postorder position from the entry
+
+    static constexpr size_t kNoBlock = static_cast<size_t>(-1);
+    void computeDominators();
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // CONTROL_FLOW_GRAPH_H
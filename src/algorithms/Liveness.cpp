@@ -0,0 +1,169 @@
+// opuas/src/algorithms/Liveness.cpp
+#include "Liveness.h"
+#include <algorithm>
+
+namespace opuas {
+namespace algorithms {
+
+// --- RegisterSet ---
+
+void RegisterSet::add(const Operand& operand) {
+    switch (operand.kind) {
+        case OperandKind::VReg:   v.set(operand.reg); break;
+        case OperandKind::VReg64: v.set(operand.reg); v.set(operand.reg + 1); break;
+        case OperandKind::SReg:   s.set(operand.reg); break;
+        case OperandKind::PReg:   p.set(operand.reg); break;
+        default: break;
+    }
+}
+
+bool RegisterSet::intersects(const RegisterSet& other) const {
+    return (v & other.v).any() || (s & other.s).any() || (p & other.p).any();
+}
+
+bool RegisterSet::intersects(const Operand& operand) const {
+    RegisterSet single;
+    single.add(operand);
+    return intersects(single);
+}
+
+RegisterSet& RegisterSet::operator|=(const RegisterSet& other) {
+    v |= other.v;
+    s |= other.s;
+    p |= other.p;
+    return *this;
+}
+
+RegisterSet& RegisterSet::operator-=(const RegisterSet& other) {
+    v &= ~other.v;
+    s &= ~other.s;
+    p &= ~other.p;
+    return *this;
+}
+
+void collectDefsUses(const Instruction& inst, RegisterSet& defs, RegisterSet& uses) {
+    size_t firstSource = 0;
+    switch (inst.info().format) {
+        case isa::Format::VOP1:
+        case isa::Format::VOP2:
+        case isa::Format::VOP3:
+        case isa::Format::VCMP:
+        case isa::Format::MLOAD:
+            defs.add(inst.operands[0]);
+            firstSource = 1;
+            break;
+        default:
+            break;
+    }
+    for (size_t i = firstSource; i < inst.operands.size(); ++i) {
+        uses.add(inst.operands[i]);
+    }
+}
+
+// --- LivenessAnalysis ---
+
+LivenessAnalysis::LivenessAnalysis(const Kernel& kernel, const ControlFlowGraph& cfg,
+                                   std::pmr::memory_resource* resource)
+    : kernel_(kernel), liveIn_(resource), liveOut_(resource), liveBefore_(resource), liveAfter_(resource) {
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    const std::vector<Instruction>& insts = kernel.instructions;
+
+    // Per-block upward-exposed uses and definitions.
+    std::pmr::vector<RegisterSet> blockUses(blocks.size(), resource), blockDefs(blocks.size(), resource);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            RegisterSet defs, uses;
+            collectDefsUses(insts[i], defs, uses);
+            uses -= blockDefs[b];
+            blockUses[b] |= uses;
+            blockDefs[b] |= defs;
+        }
+    }
+
+    liveIn_.assign(blocks.size(), RegisterSet());
+    liveOut_.assign(blocks.size(), RegisterSet());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks.size(); b-- > 0;) {
+            RegisterSet out;
+            for (size_t succ : blocks[b].succs) out |= liveIn_[succ];
+            RegisterSet in = out;
+            in -= blockDefs[b];
+            in |= blockUses[b];
+            if (in != liveIn_[b] || out != liveOut_[b]) {
+                liveIn_[b] = in;
+                liveOut_[b] = out;
+                changed = true;
+            }
+        }
+    }
+
+    liveBefore_.assign(insts.size(), RegisterSet());
+    liveAfter_.assign(insts.size(), RegisterSet());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        RegisterSet live = liveOut_[b];
+        for (size_t i = blocks[b].end; i-- > blocks[b].begin;) {
+            RegisterSet defs, uses;
+            collectDefsUses(insts[i], defs, uses);
+            liveAfter_[i] = live;
+            liveAfter_[i] |= defs;
+            live -= defs;
+            live |= uses;
+            liveBefore_[i] = live;
+        }
+    }
+}
+
+const RegisterSet& LivenessAnalysis::liveIn(size_t blockIndex) const {
+    return liveIn_[blockIndex];
+}
+
+const RegisterSet& LivenessAnalysis::liveOut(size_t blockIndex) const {
+    return liveOut_[blockIndex];
+}
+
+const std::pmr::vector<RegisterSet>& LivenessAnalysis::getLiveBefore() const {
+    return liveBefore_;
+}
+
+RegisterPressure LivenessAnalysis::computePressure() const {
+    RegisterPressure pressure;
+    RegisterSet referenced;
+    std::bitset<64> pairs; // Even units accessed as %vd
+    for (const Instruction& inst : kernel_.instructions) {
+        for (const Operand& operand : inst.operands) {
+            referenced.add(operand);
+            if (operand.kind == OperandKind::VReg64) pairs.set(operand.reg);
+        }
+    }
+
+    auto highest = [](const std::bitset<64>& bits) {
+        for (int i = 63; i >= 0; --i) {
+            if (bits.test(i)) return i + 1;
+        }
+        return 0;
+    };
+    pressure.vregsUsed = highest(referenced.v);
+    pressure.sregsUsed = highest(referenced.s);
+    pressure.pregsUsed = highest(referenced.p);
+
+    for (size_t i = 0; i < liveBefore_.size(); ++i) {
+        // The point right after each instruction counts as well, so that a
+        // definition that is never read still occupies its register.
+        for (const RegisterSet* point : {&liveBefore_[i], &liveAfter_[i]}) {
+            int livePairs = 0;
+            for (int r = 0; r < 64; r += 2) {
+                if (pairs.test(r) && point->v.test(r) && point->v.test(r + 1)) livePairs++;
+            }
+            pressure.peakV = std::max(pressure.peakV, static_cast<int>(point->v.count()));
+            pressure.peakVd = std::max(pressure.peakVd, livePairs);
+            pressure.peakS = std::max(pressure.peakS, static_cast<int>(point->s.count()));
+            pressure.peakP = std::max(pressure.peakP, static_cast<int>(point->p.count()));
+        }
+    }
+    return pressure;
+}
+
+} // namespace algorithms
+} // namespace opuas
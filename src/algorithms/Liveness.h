@@ -0,0 +1,68 @@
+// opuas/src/algorithms/Liveness.h
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <bitset>
+#include <memory_resource>
+#include <vector>
+#include "Program.h"
+#include "ControlFlowGraph.h"
+
+namespace opuas {
+namespace algorithms {
+
+// Register units of one kernel. %vdN occupies the two units %vN and %vN+1.
+struct RegisterSet {
+    std::bitset<64> v;
+    std::bitset<64> s;
+    std::bitset<64> p;
+
+    void add(const Operand& operand);
+    bool intersects(const RegisterSet& other) const;
+    bool intersects(const Operand& operand) const;
+    bool any() const { return v.any() || s.any() || p.any(); }
+    size_t count() const { return v.count() + s.count() + p.count(); }
+
+    RegisterSet& operator|=(const RegisterSet& other);
+    RegisterSet& operator-=(const RegisterSet& other);
+    bool operator==(const RegisterSet& other) const { return v == other.v && s == other.s && p == other.p; }
+    bool operator!=(const RegisterSet& other) const { return !(*this == other); }
+};
+
+// Registers written and read by one instruction.
+void collectDefsUses(const Instruction& inst, RegisterSet& defs, RegisterSet& uses);
+
+struct RegisterPressure {
+    int peakV = 0;      // Live 32-bit %v units, including both halves of %vd
+    int peakVd = 0;     // Live register pairs that are accessed as %vd
+    int peakS = 0;
+    int peakP = 0;
+    int vregsUsed = 0;  // Highest %v unit referenced + 1 (allocation footprint)
+    int sregsUsed = 0;
+    int pregsUsed = 0;
+};
+
+// Backward live-variable analysis over the CFG of one kernel.
+class LivenessAnalysis {
+public:
+    LivenessAnalysis(const Kernel& kernel, const ControlFlowGraph& cfg,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    const RegisterSet& liveIn(size_t blockIndex) const;
+    const RegisterSet& liveOut(size_t blockIndex) const;
+    // Registers live immediately before each instruction.
+    const std::pmr::vector<RegisterSet>& getLiveBefore() const;
+    RegisterPressure computePressure() const;
+
+private:
+    const Kernel& kernel_;
+    std::pmr::vector<RegisterSet> liveIn_;
+    std::pmr::vector<RegisterSet> liveOut_;
+    std::pmr::vector<RegisterSet> liveBefore_;
+    std::pmr::vector<RegisterSet> liveAfter_;   // Live-out of each instruction plus its definitions
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // LIVENESS_H
@@ -0,0 +1,286 @@
+// opuas/src/algorithms/PerfModel.cpp
+#include "PerfModel.h"
+#include "ControlFlowGraph.h"
+#include "Arena.h"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace opuas {
+namespace algorithms {
+
+namespace {
+
+int roundUp(int value, int granule) {
+    return ((value + granule - 1) / granule) * granule;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string jsonMap(const std::map<std::string, int>& values) {
+    std::ostringstream out;
+    out << "{";
+    bool first = true;
+    for (const auto& [key, value] : values) {
+        out << (first ? "" : ", ") << jsonString(key) << ": " << value;
+        first = false;
+    }
+    out << "}";
+    return out.str();
+}
+
+// Longest dependency chain through one block: an instruction starts when the
+// last writers of every register it touches have produced their results.
+int criticalPathOf(const std::vector<Instruction>& insts, size_t begin, size_t end) {
+    std::array<int, 64> readyV{}, readyS{}, readyP{};
+    int critical = 0;
+    for (size_t i = begin; i < end; ++i) {
+        RegisterSet defs, uses;
+        collectDefsUses(insts[i], defs, uses);
+        RegisterSet touched = defs;
+        touched |= uses;
+        int start = 0;
+        for (int r = 0; r < 64; ++r) {
+            if (touched.v.test(r)) start = std::max(start, readyV[r]);
+            if (touched.s.test(r)) start = std::max(start, readyS[r]);
+            if (touched.p.test(r)) start = std::max(start, readyP[r]);
+        }
+        int finish = start + isa::latencyCycles(isa::latencyClassOf(insts[i].opcode, insts[i].modifier));
+        for (int r = 0; r < 64; ++r) {
+            if (defs.v.test(r)) readyV[r] = finish;
+            if (defs.s.test(r)) readyS[r] = finish;
+            if (defs.p.test(r)) readyP[r] = finish;
+        }
+        critical = std::max(critical, finish);
+    }
+    return critical;
+}
+
+} // namespace
+
+KernelPerf PerfModel::analyze(const Kernel& kernel) const {
+    KernelPerf perf;
+    perf.name = kernel.name;
+    perf.instructions = static_cast<int>(kernel.instructions.size());
+    perf.sharedMemSize = kernel.getMetadata(".shared_memsize");
+    perf.privateMemSize = kernel.getMetadata(".private_memsize");
+
+    for (const Instruction& inst : kernel.instructions) {
+        perf.classMix[isa::latencyClassName(isa::latencyClassOf(inst.opcode, inst.modifier))]++;
+        perf.opcodeMix[inst.info().mnemonic]++;
+        perf.totalStalls += inst.stall;
+        perf.waits += inst.wait ? 1 : 0;
+    }
+
+    Arena scratch;
+    ControlFlowGraph cfg(kernel, scratch.resource());
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        BlockPerf blockPerf;
+        blockPerf.label = blocks[b].label;
+        blockPerf.begin = blocks[b].begin;
+        blockPerf.end = blocks[b].end;
+        blockPerf.loopHeader = cfg.isLoopHeader(b);
+        blockPerf.criticalPath = criticalPathOf(kernel.instructions, blocks[b].begin, blocks[b].end);
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            blockPerf.stalls += kernel.instructions[i].stall;
+        }
+        blockPerf.issueCycles = static_cast<int>(blocks[b].end - blocks[b].begin) + blockPerf.stalls;
+        perf.blocks.push_back(blockPerf);
+    }
+
+    LivenessAnalysis liveness(kernel, cfg, scratch.resource());
+    perf.registers = liveness.computePressure();
+    perf.occupancy = estimateOccupancy(kernel, perf.registers);
+    perf.throughput = estimateThroughput(kernel, cfg, perf.occupancy);
+    perf.registerLimit = static_cast<int>(
+        (static_cast<uint32_t>(kernel.getMetadata(".kernel_ctrl")) & isa::kKernelCtrlRegLimitMask) >>
+        isa::kKernelCtrlRegLimitShift);
+    return perf;
+}
+
+OccupancyEstimate PerfModel::estimateOccupancy(const Kernel& kernel, const RegisterPressure& registers) const {
+    const isa::TargetInfo& target = isa::getTargetInfo();
+    OccupancyEstimate estimate;
+
+    int64_t workgroupSize = kernel.getMetadata(".max_flat_workgroup_size", target.defaultWorkgroupSize);
+    int wavesPerGroup = static_cast<int>((std::max<int64_t>(workgroupSize, 1) + target.waveSize - 1) / target.waveSize);
+    int maxWaves = target.simdsPerCU * target.maxWavesPerSimd;
+
+    int vregs = roundUp(std::max(registers.vregsUsed, 1), target.vregGranule);
+    estimate.limits["vregs"] = target.simdsPerCU * std::min(target.maxWavesPerSimd, target.vregsPerSimd / vregs);
+    int sregs = roundUp(std::max(registers.sregsUsed, 1), target.sregGranule);
+    estimate.limits["sregs"] = target.simdsPerCU * std::min(target.maxWavesPerSimd, target.sregsPerSimd / sregs);
+    estimate.limits["pregs"] = registers.pregsUsed <= target.pregsPerWave ? maxWaves : 0;
+
+    int64_t shared = kernel.getMetadata(".shared_memsize");
+    estimate.limits["shared_memory"] = shared > 0
+        ? static_cast<int>(std::min<int64_t>(target.sharedMemPerCU / shared, INT_MAX / wavesPerGroup)) * wavesPerGroup
+        : maxWaves;
+    int64_t privateBytes = kernel.getMetadata(".private_memsize") * target.waveSize;
+    estimate.limits["private_memory"] = privateBytes > 0
+        ? static_cast<int>(std::min<int64_t>(target.scratchPerCU / privateBytes, maxWaves))
+        : maxWaves;
+    estimate.limits["workgroups"] = target.maxWorkgroupsPerCU * wavesPerGroup;
+    estimate.limits["hardware"] = maxWaves;
+
+    estimate.wavesPerCU = INT_MAX;
+    for (const auto& [resource, waves] : estimate.limits) {
+        if (waves < estimate.wavesPerCU) {
+            estimate.wavesPerCU = waves;
+            estimate.limiter = resource;
+        }
+    }
+    // Waves are resident in whole workgroups.
+    estimate.wavesPerCU = (estimate.wavesPerCU / wavesPerGroup) * wavesPerGroup;
+    return estimate;
+}
+
+ThroughputEstimate PerfModel::estimateThroughput(const Kernel& kernel, const ControlFlowGraph& cfg,
+                                                 const OccupancyEstimate& occupancy) const {
+    const isa::TargetInfo& target = isa::getTargetInfo();
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    std::vector<int> depth(blocks.size(), 0);
+    for (const Loop& loop : cfg.findLoops()) {
+        for (size_t b : loop.blocks) depth[b] = std::max(depth[b], loop.depth);
+    }
+
+    ThroughputEstimate estimate;
+    double stallCycles = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const double weight = std::pow(8.0, std::min(depth[b], 4));
+        // A wait exposes what is left of the latest memory latency in the
+        // block; with nothing in flight here, assume a whole global access.
+        int pending = isa::latencyCycles(isa::LatencyClass::Global);
+        int sinceMemory = 0;
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            const Instruction& inst = kernel.instructions[i];
+            if (inst.wait) stallCycles += weight * std::max(pending - sinceMemory, 0);
+            estimate.issueCycles += weight;
+            stallCycles += weight * inst.stall;
+            sinceMemory += 1 + inst.stall;
+            const isa::LatencyClass latencyClass = isa::latencyClassOf(inst.opcode, inst.modifier);
+            if (isa::isVariableLatency(latencyClass)) {
+                pending = isa::latencyCycles(latencyClass);
+                sinceMemory = 0;
+            }
+        }
+    }
+    estimate.latencyCycles = estimate.issueCycles + stallCycles;
+
+    // Every resident wave shares its SIMD's issue slot.
+    const double wavesPerSimd = static_cast<double>(occupancy.wavesPerCU) / target.simdsPerCU;
+    const double cycles = std::max(wavesPerSimd * estimate.issueCycles, estimate.latencyCycles);
+    estimate.issueBound = wavesPerSimd * estimate.issueCycles >= estimate.latencyCycles;
+    if (cycles > 0) estimate.wavesPerKcycle = 1000.0 * occupancy.wavesPerCU / cycles;
+    return estimate;
+}
+
+std::string PerfModel::toText(const std::vector<KernelPerf>& kernels) {
+    std::ostringstream out;
+    for (const KernelPerf& perf : kernels) {
+        out << "Kernel " << perf.name << "\n";
+        out << "  instructions: " << perf.instructions << " (";
+        bool first = true;
+        for (const auto& [cls, count] : perf.classMix) {
+            out << (first ? "" : ", ") << cls << " " << count;
+            first = false;
+        }
+        out << ")\n  opcodes:";
+        for (const auto& [mnemonic, count] : perf.opcodeMix) out << " " << mnemonic << "=" << count;
+        out << "\n  stalls: " << perf.totalStalls << " cycles inserted, " << perf.waits << " scoreboard waits\n";
+        out << "  registers: %v " << perf.registers.vregsUsed << " used (peak live " << perf.registers.peakV
+            << "), %vd peak live " << perf.registers.peakVd << ", %s " << perf.registers.sregsUsed
+            << " used (peak live " << perf.registers.peakS << "), %p " << perf.registers.pregsUsed
+            << " used (peak live " << perf.registers.peakP << ")\n";
+        out << "  memory: shared " << perf.sharedMemSize << " bytes, private " << perf.privateMemSize << " bytes\n";
+        if (perf.registerLimit) out << "  register limit: %v " << perf.registerLimit << "\n";
+        out << "  occupancy: " << perf.occupancy.wavesPerCU << " waves/CU (limited by " << perf.occupancy.limiter << ")\n";
+        out << "  throughput: " << std::fixed << std::setprecision(3) << perf.throughput.wavesPerKcycle
+            << " waves/CU per 1000 cycles (" << (perf.throughput.issueBound ? "issue bound" : "latency bound")
+            << ", " << std::setprecision(0) << perf.throughput.issueCycles << " issue and "
+            << perf.throughput.latencyCycles << " latency cycles per wave)\n" << std::defaultfloat
+            << std::setprecision(6);
+        out << "  blocks:\n";
+        for (const BlockPerf& block : perf.blocks) {
+            out << "    " << std::left << std::setw(16) << (!block.label.empty() ? block.label : block.begin == 0 ? "<entry>" : "<fallthrough>")
+                << std::right << " [" << block.begin << ", " << block.end << ")"
+                << " critical path " << block.criticalPath
+                << ", issue " << block.issueCycles
+                << ", stalls " << block.stalls
+                << (block.loopHeader ? ", loop header" : "") << "\n";
+        }
+    }
+    return out.str();
+}
+
+std::string PerfModel::toJson(const std::vector<KernelPerf>& kernels) {
+    std::ostringstream out;
+    out << "{\n  \"kernels\": [";
+    for (size_t k = 0; k < kernels.size(); ++k) {
+        const KernelPerf& perf = kernels[k];
+        out << (k ? "," : "") << "\n    {\n";
+        out << "      \"name\": " << jsonString(perf.name) << ",\n";
+        out << "      \"instructions\": " << perf.instructions << ",\n";
+        out << "      \"class_mix\": " << jsonMap(perf.classMix) << ",\n";
+        out << "      \"opcode_mix\": " << jsonMap(perf.opcodeMix) << ",\n";
+        out << "      \"stalls\": " << perf.totalStalls << ",\n";
+        out << "      \"waits\": " << perf.waits << ",\n";
+        out << "      \"registers\": {\"v_used\": " << perf.registers.vregsUsed
+            << ", \"v_peak\": " << perf.registers.peakV
+            << ", \"vd_peak\": " << perf.registers.peakVd
+            << ", \"s_used\": " << perf.registers.sregsUsed
+            << ", \"s_peak\": " << perf.registers.peakS
+            << ", \"p_used\": " << perf.registers.pregsUsed
+            << ", \"p_peak\": " << perf.registers.peakP << "},\n";
+        out << "      \"shared_memsize\": " << perf.sharedMemSize << ",\n";
+        out << "      \"private_memsize\": " << perf.privateMemSize << ",\n";
+        out << "      \"occupancy\": {\"waves_per_cu\": " << perf.occupancy.wavesPerCU
+            << ", \"limiter\": " << jsonString(perf.occupancy.limiter)
+            << ", \"limits\": " << jsonMap(perf.occupancy.limits) << "},\n";
+        out << "      \"register_limit\": " << perf.registerLimit << ",\n";
+        out << "      \"throughput\": {\"waves_per_kcycle\": " << perf.throughput.wavesPerKcycle
+            << ", \"issue_cycles\": " << perf.throughput.issueCycles
+            << ", \"latency_cycles\": " << perf.throughput.latencyCycles
+            << ", \"issue_bound\": " << (perf.throughput.issueBound ? "true" : "false") << "},\n";
+        out << "      \"blocks\": [";
+        for (size_t b = 0; b < perf.blocks.size(); ++b) {
+            const BlockPerf& block = perf.blocks[b];
+            out << (b ? "," : "") << "\n        {\"label\": " << jsonString(block.label)
+                << ", \"begin\": " << block.begin << ", \"end\": " << block.end
+                << ", \"critical_path\": " << block.criticalPath
+                << ", \"issue_cycles\": " << block.issueCycles
+                << ", \"stalls\": " << block.stalls
+                << ", \"loop_header\": " << (block.loopHeader ? "true" : "false") << "}";
+        }
+        out << (perf.blocks.empty() ? "" : "\n      ") << "]\n    }";
+    }
+    out << (kernels.empty() ? "" : "\n  ") << "]\n}\n";
+    return out.str();
+}
+
+} // namespace algorithms
+} // namespace opuas
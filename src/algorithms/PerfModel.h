@@ -0,0 +1,72 @@
+// opuas/src/algorithms/PerfModel.h
+#ifndef PERF_MODEL_H
+#define PERF_MODEL_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Program.h"
+#include "Liveness.h"
+
+namespace opuas {
+namespace algorithms {
+
+struct BlockPerf {
+    std::string label;
+    size_t begin = 0;
+    size_t end = 0;
+    int criticalPath = 0;   // Longest dependency chain in cycles, using the latency tables
+    int issueCycles = 0;    // Instructions plus inserted stalls
+    int stalls = 0;
+    bool loopHeader = false;
+};
+
+struct OccupancyEstimate {
+    int wavesPerCU = 0;
+    std::string limiter;                 // Resource that bounds wavesPerCU
+    std::map<std::string, int> limits;   // Waves per CU allowed by each resource
+};
+
+// Waves one CU completes per 1000 cycles. Each SIMD issues one instruction
+// per cycle; a wave's stalls and memory waits are hidden while other
+// resident waves have work. Blocks count 8x per enclosing loop.
+struct ThroughputEstimate {
+    double issueCycles = 0;      // Per wave
+    double latencyCycles = 0;    // Per wave: issue plus stalls and exposed memory latency
+    double wavesPerKcycle = 0;
+    bool issueBound = false;     // Enough waves to hide all latency
+};
+
+struct KernelPerf {
+    std::string name;
+    int instructions = 0;
+    std::map<std::string, int> classMix;    // Latency class -> count
+    std::map<std::string, int> opcodeMix;   // Mnemonic -> count
+    std::vector<BlockPerf> blocks;
+    int totalStalls = 0;
+    int waits = 0;
+    RegisterPressure registers;
+    int64_t sharedMemSize = 0;
+    int64_t privateMemSize = 0;
+    OccupancyEstimate occupancy;
+    ThroughputEstimate throughput;
+    int registerLimit = 0;  // %v limit the kernel was allocated for (.kernel_ctrl); 0 if none
+};
+
+// Static per-kernel performance model. Expects stalls to be set already
+// (StallSetter), so the report reflects the code that would be emitted.
+class PerfModel {
+public:
+    KernelPerf analyze(const Kernel& kernel) const;
+    OccupancyEstimate estimateOccupancy(const Kernel& kernel, const RegisterPressure& registers) const;
+    ThroughputEstimate estimateThroughput(const Kernel& kernel, const ControlFlowGraph& cfg,
+                                          const OccupancyEstimate& occupancy) const;
+
+    static std::string toText(const std::vector<KernelPerf>& kernels);
+    static std::string toJson(const std::vector<KernelPerf>& kernels);
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // PERF_MODEL_H
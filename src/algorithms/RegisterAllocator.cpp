@@ -1,102 +1,617 @@
 // opuas/src/algorithms/RegisterAllocator.cpp
 #include "RegisterAllocator.h"
-#include <iostream>
-#include <unordered_map>
-#include <unordered_set>
+#include "ControlFlowGraph.h"
+#include "Liveness.h"
+#include "Arena.h"
+#include "OpuEncoding.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
 #include <vector>
-#include <string>
-#include <algorithm> // For std::find_if
 
 namespace opuas {
 namespace algorithms {
 
-RegisterAllocator::RegisterAllocator(/* Parser* parser, CodeGenerator* codeGen */) {
-    // Initialize with some free physical registers
-    // This is highly simplified. A real allocator needs liveness analysis etc.
-    for (int i = 0; i < 32; ++i) { // Assume 32 general-purpose %v registers
-        freeVRegisters_.insert(i);
+namespace {
+
+// Spill rounds before giving up; spill code itself is never spilled again.
+constexpr int kMaxRounds = 8;
+
+// Bit set over value halves. While allocating, a %v operand names a value
+// instead of a register: %v(2 * value + half), %vd(2 * value).
+class SlotSet {
+public:
+    explicit SlotSet(size_t bits = 0) : words_((bits + 63) / 64, 0) {}
+
+    void set(size_t bit) { words_[bit / 64] |= uint64_t(1) << (bit % 64); }
+    void reset(size_t bit) { words_[bit / 64] &= ~(uint64_t(1) << (bit % 64)); }
+    bool test(size_t bit) const { return (words_[bit / 64] >> (bit % 64)) & 1; }
+
+    SlotSet& operator|=(const SlotSet& other) {
+        for (size_t w = 0; w < words_.size(); ++w) words_[w] |= other.words_[w];
+        return *this;
     }
-    // Assume 16 predicate registers %p
-    for (int i = 0; i < 16; ++i) {
-        freePRegisters_.insert(i);
+    SlotSet& operator-=(const SlotSet& other) {
+        for (size_t w = 0; w < words_.size(); ++w) words_[w] &= ~other.words_[w];
+        return *this;
     }
-    // Assume 8 double-word registers %vd (occupying pairs of %v)
-    for (int i = 0; i < 8; i+=2) { // Even indices for %vd
-        freeVdRegisters_.insert(i);
+    bool operator==(const SlotSet& other) const { return words_ == other.words_; }
+    bool operator!=(const SlotSet& other) const { return words_ != other.words_; }
+
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t w = 0; w < words_.size(); ++w) {
+            for (uint64_t bits = words_[w]; bits; bits &= bits - 1) {
+                int bit = 0;
+                while (!((bits >> bit) & 1)) ++bit;
+                f(w * 64 + bit);
+            }
+        }
     }
+
+private:
+    std::vector<uint64_t> words_;
+};
+
+struct Value {
+    int size = 1;               // %v units: 2 for values accessed as %vd
+    bool spillable = true;      // False for spill code temporaries
+    double cost = 0;            // Accesses weighted by loop depth
+};
+
+bool isVectorRegister(const Operand& operand) {
+    return operand.kind == OperandKind::VReg || operand.kind == OperandKind::VReg64;
 }
 
-bool RegisterAllocator::allocate(const std::vector<std::string>& ptxVirtualRegs) {
-    std::cout << "RegisterAllocator Info: Starting register allocation (placeholder)...\n";
+size_t firstSource(const Instruction& inst) {
+    return isa::formatHasDestination(inst.info().format) ? 1 : 0;
+}
 
-    // --- Placeholder Allocation Logic ---
-    // A real allocator would analyze liveness, interference graphs, etc.
-    // This just assigns the first available physical reg to each PTX virtual reg.
+bool sameOperand(const Operand& a, const Operand& b) {
+    return a.kind == b.kind && a.reg == b.reg && a.imm == b.imm && a.symbol == b.symbol;
+}
 
-    allocationMap_.clear();
+Operand registerOperand(OperandKind kind, int reg) {
+    Operand operand;
+    operand.kind = kind;
+    operand.reg = reg;
+    return operand;
+}
 
-    for (const std::string& ptxReg : ptxVirtualRegs) {
-        if (ptxReg.empty() || ptxReg[0] != '%') continue;
+Operand immOperand(int64_t value) {
+    Operand operand;
+    operand.kind = OperandKind::Imm;
+    operand.imm = value;
+    return operand;
+}
 
-        std::string coasmReg;
-        if (ptxReg[1] == 'r' || ptxReg[1] == 'f') {
-            // Map to %v
-            if (!freeVRegisters_.empty()) {
-                int physReg = *freeVRegisters_.begin();
-                freeVRegisters_.erase(freeVRegisters_.begin());
-                coasmReg = "%v" + std::to_string(physReg);
-            } else {
-                std::cerr << "RegisterAllocator Error: Out of free %v registers for " << ptxReg << std::endl;
+// ld.local / st.local of one spill slot: [frame + offset].
+Instruction spillAccess(isa::Opcode opcode, const Operand& reg, const Operand& frame, uint32_t offset, int line) {
+    Instruction inst;
+    inst.opcode = opcode;
+    inst.type = reg.kind == OperandKind::VReg64 ? isa::DataType::B64 : isa::DataType::B32;
+    inst.modifier = isa::SpaceLocal;
+    inst.line = line;
+    if (opcode == isa::Opcode::Ld) {
+        inst.operands = {reg, frame, immOperand(offset)};
+    } else {
+        inst.operands = {frame, immOperand(offset), reg};
+    }
+    return inst;
+}
+
+// Slots (value halves) an instruction writes and reads, in value form.
+void collectSlots(const Instruction& inst, std::vector<int>& defs, std::vector<int>& uses) {
+    defs.clear();
+    uses.clear();
+    const size_t first = firstSource(inst);
+    for (size_t o = 0; o < inst.operands.size(); ++o) {
+        const Operand& operand = inst.operands[o];
+        if (!isVectorRegister(operand)) continue;
+        std::vector<int>& slots = o < first ? defs : uses;
+        slots.push_back(operand.reg);
+        if (operand.kind == OperandKind::VReg64) slots.push_back(operand.reg + 1);
+    }
+}
+
+// Highest register unit of `kind` referenced + 1; %vd counts for %v.
+int highestRegister(const Kernel& kernel, OperandKind kind) {
+    int highest = 0;
+    for (const Instruction& inst : kernel.instructions) {
+        for (const Operand& operand : inst.operands) {
+            if (operand.kind == kind) highest = std::max(highest, operand.reg + 1);
+            if (kind == OperandKind::VReg && operand.kind == OperandKind::VReg64) {
+                highest = std::max(highest, operand.reg + 2);
+            }
+        }
+    }
+    return highest;
+}
+
+class UnionFind {
+public:
+    int add() {
+        parent_.push_back(static_cast<int>(parent_.size()));
+        return parent_.back();
+    }
+    int find(int x) {
+        while (parent_[x] != x) x = parent_[x] = parent_[parent_[x]];
+        return x;
+    }
+    bool unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        parent_[std::max(a, b)] = std::min(a, b);
+        return true;
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+// Split the physical %v registers of `kernel` into values and rewrite
+// `work` (a copy of it) to value form. Every use joins the definitions
+// reaching it; the two registers of a %vd access join into one pair value.
+bool buildValues(const Kernel& kernel, Kernel& work, std::vector<Value>& values, std::string& error) {
+    Arena scratch;
+    ControlFlowGraph cfg(kernel, scratch.resource());
+    LivenessAnalysis liveness(kernel, cfg, scratch.resource());
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    const std::vector<Instruction>& insts = kernel.instructions;
+
+    // One point per register unit of every %v operand, plus one per register
+    // live into a block.
+    UnionFind points;
+    std::vector<size_t> pointBase(insts.size() + 1, 0);
+    for (size_t i = 0; i < insts.size(); ++i) {
+        pointBase[i + 1] = pointBase[i] + 2 * insts[i].operands.size();
+    }
+    for (size_t p = 0; p < pointBase.back(); ++p) points.add();
+    auto point = [&](size_t i, size_t o, int half) { return static_cast<int>(pointBase[i] + 2 * o + half); };
+    std::map<std::pair<size_t, int>, int> entryPoints;
+    auto entry = [&](size_t b, int unit) {
+        auto found = entryPoints.find({b, unit});
+        if (found != entryPoints.end()) return found->second;
+        return entryPoints[{b, unit}] = points.add();
+    };
+
+    std::vector<std::pair<int, int>> pairs;  // (low, high) points of each %vd access
+    std::vector<std::array<int, 64>> exits(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        std::array<int, 64> current;
+        current.fill(-1);
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            const Instruction& inst = insts[i];
+            const size_t first = firstSource(inst);
+            for (size_t o = 0; o < inst.operands.size(); ++o) {
+                const Operand& operand = inst.operands[o];
+                if (!isVectorRegister(operand)) continue;
+                const int units = operand.kind == OperandKind::VReg64 ? 2 : 1;
+                if (operand.reg < 0 || operand.reg + units > isa::kMaxVRegs ||
+                    (units == 2 && operand.reg % 2 != 0)) {
+                    error = "register " + formatOperand(operand) + " cannot be renumbered";
+                    return false;
+                }
+                if (units == 2) pairs.push_back({point(i, o, 0), point(i, o, 1)});
+                if (o < first) continue;
+                for (int half = 0; half < units; ++half) {
+                    const int unit = operand.reg + half;
+                    points.unite(point(i, o, half), current[unit] >= 0 ? current[unit] : entry(b, unit));
+                }
+            }
+            if (first == 1 && isVectorRegister(inst.operands[0])) {
+                const Operand& dst = inst.operands[0];
+                const int units = dst.kind == OperandKind::VReg64 ? 2 : 1;
+                for (int half = 0; half < units; ++half) current[dst.reg + half] = point(i, 0, half);
+            }
+        }
+        exits[b] = current;
+    }
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (int unit = 0; unit < isa::kMaxVRegs; ++unit) {
+            if (!liveness.liveIn(b).v.test(unit)) continue;
+            const int in = entry(b, unit);
+            for (size_t pred : blocks[b].preds) {
+                if (!liveness.liveOut(pred).v.test(unit)) continue;
+                points.unite(in, exits[pred][unit] >= 0 ? exits[pred][unit] : entry(pred, unit));
+            }
+        }
+    }
+
+    // A register half of one %vd value has exactly one partner.
+    std::map<int, int> highOf, lowOf;
+    for (bool changed = true; changed;) {
+        changed = false;
+        highOf.clear();
+        lowOf.clear();
+        for (const auto& [lowPoint, highPoint] : pairs) {
+            const int low = points.find(lowPoint), high = points.find(highPoint);
+            auto h = highOf.emplace(low, high);
+            if (!h.second && points.unite(h.first->second, high)) changed = true;
+            auto l = lowOf.emplace(high, low);
+            if (!l.second && points.unite(l.first->second, low)) changed = true;
+        }
+    }
+
+    // Number values in order of first appearance.
+    std::map<int, int> valueOf;   // Root point -> 2 * value + half
+    for (size_t i = 0; i < insts.size(); ++i) {
+        Instruction& inst = work.instructions[i];
+        for (size_t o = 0; o < inst.operands.size(); ++o) {
+            Operand& operand = inst.operands[o];
+            if (!isVectorRegister(operand)) continue;
+            const int root = points.find(point(i, o, 0));
+            if (!valueOf.count(root)) {
+                const int value = static_cast<int>(values.size());
+                auto high = highOf.find(root);
+                auto low = lowOf.find(root);
+                values.emplace_back();
+                if (high != highOf.end()) {
+                    values.back().size = 2;
+                    valueOf[root] = 2 * value;
+                    valueOf[points.find(high->second)] = 2 * value + 1;
+                } else if (low != lowOf.end()) {
+                    values.back().size = 2;
+                    valueOf[points.find(low->second)] = 2 * value;
+                    valueOf[root] = 2 * value + 1;
+                } else {
+                    valueOf[root] = 2 * value;
+                }
+            }
+            operand.reg = valueOf[root];
+        }
+    }
+    return true;
+}
+
+// Interference graph of the values in `work`, from slot liveness. A value
+// interferes with everything live where it is defined; values live at the
+// kernel entry interfere with each other. Also accumulates spill costs.
+std::vector<std::vector<int>> buildInterference(const Kernel& work, std::vector<Value>& values) {
+    Arena scratch;
+    ControlFlowGraph cfg(work, scratch.resource());
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    const size_t slots = 2 * values.size();
+
+    std::vector<int> depth(blocks.size(), 0);
+    for (const Loop& loop : cfg.findLoops()) {
+        for (size_t b : loop.blocks) depth[b] = std::max(depth[b], loop.depth);
+    }
+
+    std::vector<int> defs, uses;
+    std::vector<SlotSet> blockUses(blocks.size(), SlotSet(slots)), blockDefs(blocks.size(), SlotSet(slots));
+    for (Value& value : values) value.cost = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const double weight = std::pow(8.0, std::min(depth[b], 4));
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            collectSlots(work.instructions[i], defs, uses);
+            for (int slot : uses) {
+                if (!blockDefs[b].test(slot)) blockUses[b].set(slot);
+                values[slot / 2].cost += weight;
+            }
+            for (int slot : defs) {
+                blockDefs[b].set(slot);
+                values[slot / 2].cost += weight;
+            }
+        }
+    }
+
+    std::vector<SlotSet> liveIn(blocks.size(), SlotSet(slots)), liveOut(blocks.size(), SlotSet(slots));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t b = blocks.size(); b-- > 0;) {
+            SlotSet out(slots);
+            for (size_t succ : blocks[b].succs) out |= liveIn[succ];
+            SlotSet in = out;
+            in -= blockDefs[b];
+            in |= blockUses[b];
+            if (in != liveIn[b] || out != liveOut[b]) {
+                liveIn[b] = std::move(in);
+                liveOut[b] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<SlotSet> matrix(values.size(), SlotSet(values.size()));
+    auto interfere = [&](size_t a, size_t b) {
+        if (a == b) return;
+        matrix[a].set(b);
+        matrix[b].set(a);
+    };
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        SlotSet live = liveOut[b];
+        for (size_t i = blocks[b].end; i-- > blocks[b].begin;) {
+            collectSlots(work.instructions[i], defs, uses);
+            for (int def : defs) {
+                live.forEach([&](size_t slot) { interfere(def / 2, slot / 2); });
+                for (int other : defs) interfere(def / 2, other / 2);
+            }
+            for (int def : defs) live.reset(def);
+            for (int use : uses) live.set(use);
+        }
+        if (b == 0) {
+            std::vector<size_t> atEntry;
+            live.forEach([&](size_t slot) { atEntry.push_back(slot / 2); });
+            for (size_t x : atEntry) {
+                for (size_t y : atEntry) interfere(x, y);
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> neighbors(values.size());
+    for (size_t v = 0; v < values.size(); ++v) {
+        matrix[v].forEach([&](size_t other) { neighbors[v].push_back(static_cast<int>(other)); });
+    }
+    return neighbors;
+}
+
+// Optimistic graph colouring onto units [0, maxRegs); pairs start on even
+// units. Returns the values left without a colour.
+std::vector<int> colorValues(const std::vector<Value>& values, const std::vector<std::vector<int>>& neighbors,
+                             int maxRegs, std::vector<int>& colors) {
+    const size_t count = values.size();
+    // Units a neighbour can take away from a value's choices: a single
+    // register blocks a whole aligned pair.
+    auto blocked = [&](size_t v, size_t other) { return values[v].size == 2 ? 2 : values[other].size; };
+    std::vector<int> load(count, 0);
+    for (size_t v = 0; v < count; ++v) {
+        for (int other : neighbors[v]) load[v] += blocked(v, other);
+    }
+
+    std::vector<char> removed(count, 0);
+    std::vector<int> stack;
+    for (size_t step = 0; step < count; ++step) {
+        int pick = -1;
+        for (size_t v = 0; v < count && pick < 0; ++v) {
+            if (!removed[v] && load[v] + values[v].size <= maxRegs) pick = static_cast<int>(v);
+        }
+        if (pick < 0) {
+            // Nothing is certain to fit: set aside the cheapest value per
+            // neighbour, spill code last.
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t v = 0; v < count; ++v) {
+                if (removed[v]) continue;
+                const double cost = values[v].spillable ? values[v].cost / (neighbors[v].size() + 1)
+                                                        : std::numeric_limits<double>::max();
+                if (pick < 0 || cost < best) {
+                    best = cost;
+                    pick = static_cast<int>(v);
+                }
+            }
+        }
+        removed[pick] = 1;
+        stack.push_back(pick);
+        for (int other : neighbors[pick]) load[other] -= blocked(other, pick);
+    }
+
+    colors.assign(count, -1);
+    std::vector<int> uncolored;
+    while (!stack.empty()) {
+        const int v = stack.back();
+        stack.pop_back();
+        std::bitset<isa::kMaxVRegs> used;
+        for (int other : neighbors[v]) {
+            if (colors[other] < 0) continue;
+            for (int unit = 0; unit < values[other].size; ++unit) used.set(colors[other] + unit);
+        }
+        const int size = values[v].size;
+        for (int unit = 0; unit + size <= maxRegs; unit += size) {
+            if (!used.test(unit) && (size == 1 || !used.test(unit + 1))) {
+                colors[v] = unit;
+                break;
+            }
+        }
+        if (colors[v] < 0) uncolored.push_back(v);
+    }
+    std::sort(uncolored.begin(), uncolored.end());
+    return uncolored;
+}
+
+// For each value, the move that defines it if every definition is the same
+// move of a constant, special register or symbol; null otherwise.
+std::vector<const Instruction*> rematerializableDefs(const Kernel& work, const std::vector<Value>& values) {
+    std::vector<const Instruction*> defs(values.size(), nullptr);
+    std::vector<char> eligible(values.size(), 1);
+    for (const Instruction& inst : work.instructions) {
+        if (firstSource(inst) == 0 || !isVectorRegister(inst.operands[0])) continue;
+        const Operand& dst = inst.operands[0];
+        const int value = dst.reg / 2;
+        if (!eligible[value]) continue;
+        const bool whole = dst.kind == OperandKind::VReg64 || values[value].size == 1;
+        const Operand& source = inst.operands.back();
+        const Instruction* def = defs[value];
+        if (inst.opcode != isa::Opcode::Mov || !whole ||
+            (source.kind != OperandKind::Imm && source.kind != OperandKind::Special &&
+             source.kind != OperandKind::Symbol) ||
+            (def && (def->type != inst.type || def->modifier != inst.modifier ||
+                     def->operands[0].kind != dst.kind || !sameOperand(def->operands[1], source)))) {
+            eligible[value] = 0;
+            defs[value] = nullptr;
+            continue;
+        }
+        defs[value] = &inst;
+    }
+    return defs;
+}
+
+} // namespace
+
+RegisterAllocator::RegisterAllocator(Kernel& kernel) : kernel_(kernel) {}
+
+bool RegisterAllocator::allocate(int maxRegs) {
+    result_ = AllocationResult();
+    error_.clear();
+    result_.registersBefore = highestRegister(kernel_, OperandKind::VReg);
+    result_.registersAfter = result_.registersBefore;
+    if (maxRegs < 1 || maxRegs > isa::kMaxVRegs) {
+        error_ = "register limit " + std::to_string(maxRegs) + " is outside 1.." + std::to_string(isa::kMaxVRegs);
+        return false;
+    }
+    if (result_.registersBefore <= maxRegs) return true;
+
+    Kernel work;
+    work.name = kernel_.name;
+    work.instructions = kernel_.instructions;
+    work.labels = kernel_.labels;
+    std::vector<Value> values;
+    if (!buildValues(kernel_, work, values, error_)) return false;
+    result_.values = static_cast<int>(values.size());
+
+    // Spill slots go after the private memory the kernel already uses. An
+    // address base must be a register, so the first free %s holds 0.
+    const int64_t frameBase =
+        (std::max(kernel_.getMetadata(".private_memsize"), kernel_.getMetadata(".local_framesize")) + 7) / 8 * 8;
+    uint32_t frameSize = 0;
+    const Operand frame = registerOperand(OperandKind::SReg, highestRegister(kernel_, OperandKind::SReg));
+
+    std::vector<int> colors;
+    for (int round = 0;; ++round) {
+        std::vector<std::vector<int>> neighbors = buildInterference(work, values);
+        const std::vector<const Instruction*> rematDefs = rematerializableDefs(work, values);
+        // Recomputing is an ALU move; a reload is a memory round trip.
+        for (size_t v = 0; v < values.size(); ++v) {
+            if (rematDefs[v]) values[v].cost *= 0.25;
+        }
+        std::vector<int> uncolored = colorValues(values, neighbors, maxRegs, colors);
+        if (uncolored.empty()) break;
+        for (int value : uncolored) {
+            if (!values[value].spillable || round + 1 >= kMaxRounds) {
+                error_ = "does not fit in " + std::to_string(maxRegs) + " %v registers";
                 return false;
             }
-        } else if (ptxReg[1] == 'r' && ptxReg[2] == 'd') { // %rd
-             // Map to %vd
-             // Find an even-numbered free %vd reg
-             auto it = std::find_if(freeVdRegisters_.begin(), freeVdRegisters_.end(),
-                                    [](int r) { return r % 2 == 0; });
-             if (it != freeVdRegisters_.end()) {
-                 int physReg = *it;
-                 freeVdRegisters_.erase(it);
-                 // Mark the pair of %v registers as used
-                 freeVRegisters_.erase(physReg);
-                 freeVRegisters_.erase(physReg + 1);
-                 coasmReg = "%vd" + std::to_string(physReg);
-             } else {
-                 std::cerr << "RegisterAllocator Error: Out of free %vd registers for " << ptxReg << std::endl;
-                 return false;
-             }
-        } else if (ptxReg[1] == 'p') {
-             // Map to %p
-             if (!freePRegisters_.empty()) {
-                 int physReg = *freePRegisters_.begin();
-                 freePRegisters_.erase(freePRegisters_.begin());
-                 coasmReg = "%p" + std::to_string(physReg);
-             } else {
-                 std::cerr << "RegisterAllocator Error: Out of free %p registers for " << ptxReg << std::endl;
-                 return false;
-             }
-        } else {
-            // Handle other register types (%tid.x, %ctaid.y, etc.) or pass through
-            coasmReg = ptxReg; // For special regs, keep as is or map symbolically
-            std::cout << "RegisterAllocator Info: Passing through special register " << ptxReg << std::endl;
-        }
-
-        if (!coasmReg.empty()) {
-            allocationMap_[ptxReg] = coasmReg;
-            std::cout << "  Allocated " << coasmReg << " for " << ptxReg << std::endl;
-        }
-    }
-
-    std::cout << "RegisterAllocator Info: Register allocation completed (placeholder logic).\n";
+        }
+
+        // Rewrite every access to an uncoloured value: rematerialise or
+        // reload it into a fresh temporary before each use, and store each
+        // definition's temporary after it.
+        std::map<int, const Instruction*> remat;
+        std::map<int, uint32_t> slot;
+        for (int value : uncolored) {
+            if (const Instruction* def = rematDefs[value]) {
+                remat[value] = def;
+                result_.rematerialized++;
+            } else {
+                if (frame.reg >= 64) {
+                    error_ = "needs spill slots, but every %s register is in use";
+                    return false;
+                }
+                if (values[value].size == 2) frameSize = (frameSize + 7) / 8 * 8;
+                slot[value] = static_cast<uint32_t>(frameBase + frameSize);
+                frameSize += 4 * values[value].size;
+                result_.spilled++;
+            }
+        }
+        auto newTemp = [&](int size) {
+            values.push_back(Value{size, false, 0});
+            return static_cast<int>(values.size()) - 1;
+        };
+
+        std::vector<Instruction> rewritten;
+        std::vector<size_t> newIndex(work.instructions.size() + 1);
+        for (size_t i = 0; i < work.instructions.size(); ++i) {
+            newIndex[i] = rewritten.size();
+            Instruction inst = work.instructions[i];
+            const size_t first = firstSource(inst);
+            if (first == 1 && isVectorRegister(inst.operands[0]) && remat.count(inst.operands[0].reg / 2)) {
+                continue; // Recomputed at every use instead
+            }
+            std::vector<Instruction> before, after;
+            std::map<std::pair<int, int>, int> reloaded;   // (value, half or 2 for %vd) -> temporary
+            for (size_t o = first; o < inst.operands.size(); ++o) {
+                Operand& operand = inst.operands[o];
+                if (!isVectorRegister(operand)) continue;
+                const int value = operand.reg / 2, half = operand.reg % 2;
+                auto rematDef = remat.find(value);
+                auto spillSlot = slot.find(value);
+                if (rematDef == remat.end() && spillSlot == slot.end()) continue;
+                const bool pair = operand.kind == OperandKind::VReg64;
+                // A rematerialised value is always recomputed whole.
+                const std::pair<int, int> key{value, rematDef != remat.end() ? 2 : pair ? 2 : half};
+                auto temp = reloaded.find(key);
+                if (temp == reloaded.end()) {
+                    if (rematDef != remat.end()) {
+                        const int t = newTemp(values[value].size);
+                        Instruction move = *rematDef->second;
+                        move.operands[0].reg = 2 * t;
+                        move.line = inst.line;
+                        before.push_back(move);
+                        temp = reloaded.emplace(key, t).first;
+                    } else {
+                        const int t = newTemp(pair ? 2 : 1);
+                        before.push_back(spillAccess(isa::Opcode::Ld, registerOperand(operand.kind, 2 * t), frame,
+                                                     spillSlot->second + (pair ? 0 : 4 * half), inst.line));
+                        temp = reloaded.emplace(key, t).first;
+                    }
+                    result_.spillLoads++;
+                }
+                operand.reg = 2 * temp->second + (rematDef != remat.end() && !pair ? half : 0);
+            }
+            if (first == 1 && isVectorRegister(inst.operands[0])) {
+                Operand& dst = inst.operands[0];
+                auto spillSlot = slot.find(dst.reg / 2);
+                if (spillSlot != slot.end()) {
+                    const bool pair = dst.kind == OperandKind::VReg64;
+                    const int half = dst.reg % 2;
+                    dst.reg = 2 * newTemp(pair ? 2 : 1);
+                    after.push_back(spillAccess(isa::Opcode::St, dst, frame, spillSlot->second + (pair ? 0 : 4 * half),
+                                                inst.line));
+                    result_.spillStores++;
+                }
+            }
+            for (Instruction& added : before) rewritten.push_back(std::move(added));
+            rewritten.push_back(std::move(inst));
+            for (Instruction& added : after) rewritten.push_back(std::move(added));
+        }
+        newIndex.back() = rewritten.size();
+        for (auto& [label, index] : work.labels) index = newIndex[index];
+        work.instructions = std::move(rewritten);
+    }
+
+    // Commit: values take their colours, instructions move into the kernel's arena.
+    std::pmr::memory_resource* resource = kernel_.arena ? kernel_.arena->resource() : std::pmr::get_default_resource();
+    std::vector<Instruction> instructions;
+    instructions.reserve(work.instructions.size() + 1);
+    if (frameSize > 0) {
+        instructions.emplace_back(resource);
+        Instruction& init = instructions.back();
+        init.opcode = isa::Opcode::Mov;
+        init.type = isa::DataType::U32;
+        init.operands.push_back(frame);
+        init.operands.push_back(immOperand(0));
+        init.line = kernel_.line;
+        for (auto& [label, index] : work.labels) ++index;
+    }
+    for (const Instruction& inst : work.instructions) {
+        instructions.emplace_back(resource);
+        instructions.back() = inst;
+        for (Operand& operand : instructions.back().operands) {
+            if (operand.kind == OperandKind::VReg) operand.reg = colors[operand.reg / 2] + operand.reg % 2;
+            if (operand.kind == OperandKind::VReg64) operand.reg = colors[operand.reg / 2];
+        }
+    }
+    kernel_.instructions = std::move(instructions);
+    kernel_.labels = std::move(work.labels);
+    if (frameSize > 0) {
+        result_.spillBytes = frameSize;
+        kernel_.metadata[".private_memsize"] = frameBase + frameSize;
+    }
+    result_.registersAfter = highestRegister(kernel_, OperandKind::VReg);
     return true;
-    // --- End of Placeholder Logic ---
 }
 
-const std::unordered_map<std::string, std::string>& RegisterAllocator::getAllocationMap() const {
-    return allocationMap_;
+const AllocationResult& RegisterAllocator::getResult() const {
+    return result_;
 }
 
-// Methods to deallocate/free registers would also be needed in a full implementation.
+const std::string& RegisterAllocator::getError() const {
+    return error_;
+}
 
 } // namespace algorithms
 } // namespace opuas
@@ -0,0 +1,54 @@
+// opuas/src/algorithms/RegisterAllocator.h
+#ifndef REGISTER_ALLOCATOR_H
+#define REGISTER_ALLOCATOR_H
+
+#include <cstdint>
+#include <string>
+#include "Program.h"
+
+namespace opuas {
+namespace algorithms {
+
+struct AllocationResult {
+    int registersBefore = 0;    // %v units referenced (highest + 1)
+    int registersAfter = 0;
+    int values = 0;             // Live ranges found in the %v registers
+    int spilled = 0;            // Values kept in private memory
+    int rematerialized = 0;     // Values recomputed at each use instead
+    int spillLoads = 0;         // Instructions added, including rematerialised moves
+    int spillStores = 0;
+    uint32_t spillBytes = 0;    // Private memory per thread added for spill slots
+};
+
+// Renumbers the %v registers of a kernel so that they fit in a budget.
+//
+// The code arrives with registers already assigned, so every register is
+// first split into values: a definition together with the uses it reaches.
+// Values are coloured onto the budget using their interference graph (%vd
+// values take aligned pairs). Values that do not fit are rematerialised
+// when every definition moves the same constant, special register or
+// symbol into them, and spilled to private memory after .private_memsize
+// otherwise, cheapest first by use count weighted by loop depth. %s and %p
+// registers are left as written.
+//
+// Stalls are not touched; run StallSetter afterwards.
+class RegisterAllocator {
+public:
+    explicit RegisterAllocator(Kernel& kernel);
+
+    // Fit the kernel into `maxRegs` %v units. A kernel that already fits is
+    // left as written. On failure the kernel is unchanged.
+    bool allocate(int maxRegs);
+    const AllocationResult& getResult() const;
+    const std::string& getError() const;
+
+private:
+    Kernel& kernel_;
+    AllocationResult result_;
+    std::string error_;
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // REGISTER_ALLOCATOR_H
@@ -1,42 +1,161 @@
 // opuas/src/algorithms/StallSetter.cpp
 #include "StallSetter.h"
+#include "Arena.h"
+#include "ControlFlowGraph.h"
+#include "Liveness.h"
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <vector>
 
 namespace opuas {
 namespace algorithms {
 
-StallSetter::StallSetter(/* Parser* parser, CodeGenerator* codeGen */) {
-    // Initialization logic if needed
-}
+namespace {
+
+// Cycle at which each register unit's pending fixed-latency result is ready.
+struct ReadyTimes {
+    std::array<int, 64> v{};
+    std::array<int, 64> s{};
+    std::array<int, 64> p{};
+
+    int latest(const RegisterSet& regs) const {
+        int latest = 0;
+        for (int r = 0; r < 64; ++r) {
+            if (regs.v.test(r)) latest = std::max(latest, v[r]);
+            if (regs.s.test(r)) latest = std::max(latest, s[r]);
+            if (regs.p.test(r)) latest = std::max(latest, p[r]);
+        }
+        return latest;
+    }
+
+    void set(const RegisterSet& regs, int cycle) {
+        for (int r = 0; r < 64; ++r) {
+            if (regs.v.test(r)) v[r] = cycle;
+            if (regs.s.test(r)) s[r] = cycle;
+            if (regs.p.test(r)) p[r] = cycle;
+        }
+    }
+
+    int max() const {
+        int latest = 0;
+        for (int r = 0; r < 64; ++r) latest = std::max({latest, v[r], s[r], p[r]});
+        return latest;
+    }
+};
+
+} // namespace
+
+StallSetter::StallSetter(Kernel& kernel) : kernel_(kernel) {}
 
 bool StallSetter::analyzeAndSet() {
-    std::cout << "StallSetter Info: Analyzing dependencies and setting stalls (placeholder)...\n";
-
-    // --- Placeholder Dependency Analysis & Stall Setting ---
-    // A real implementation would:
-    // 1. Parse the generated COASM code or internal IR.
-    // 2. Build a Control Flow Graph (CFG).
-    // 3. Perform dataflow analysis (Live Variable Analysis) to find defs/uses.
-    // 4. Identify RAW, WAR, WAW dependencies between instructions in the CFG.
-    // 5. Calculate the minimum number of stalls needed to resolve hazards.
-    // 6. Store stall information (e.g., in a vector indexed by instruction).
-
-    // For now, simulate setting some stalls.
-    // Assume we have N instructions and set stalls for some.
-    int numInstructions = 10; // Placeholder
-    stalls_.assign(numInstructions, 0); // Initialize all to 0
-    if (numInstructions > 3) stalls_[3] = 2; // Set stall of 2 for instruction 3
-    if (numInstructions > 7) stalls_[7] = 1; // Set stall of 1 for instruction 7
-
-    std::cout << "StallSetter Info: Dependency analysis and stall setting completed (placeholder logic).\n";
+    for (Instruction& inst : kernel_.instructions) {
+        inst.stall = 0;
+        inst.wait = false;
+    }
+    // The graph and dataflow sets only live for this call.
+    Arena scratch;
+    ControlFlowGraph cfg(kernel_, scratch.resource());
+    setWaitBits(cfg, scratch.resource());
+    setStalls(cfg);
+
+    stalls_.clear();
+    for (const Instruction& inst : kernel_.instructions) stalls_.push_back(inst.stall);
     return true;
-    // --- End of Placeholder Logic ---
+}
+
+// Forward dataflow over the CFG: a register is pending while a memory load to
+// it may still be in flight. An instruction reading or overwriting a pending
+// register waits for all outstanding memory operations, which clears the set.
+void StallSetter::setWaitBits(const ControlFlowGraph& cfg, std::pmr::memory_resource* scratch) {
+    const std::pmr::vector<BasicBlock>& blocks = cfg.getBlocks();
+    std::vector<Instruction>& insts = kernel_.instructions;
+
+    auto transfer = [&](size_t b, RegisterSet pending, bool apply) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            Instruction& inst = insts[i];
+            RegisterSet defs, uses;
+            collectDefsUses(inst, defs, uses);
+            RegisterSet touched = defs;
+            touched |= uses;
+            if (pending.intersects(touched) || (inst.opcode == isa::Opcode::Barrier && pending.any())) {
+                if (apply) inst.wait = true;
+                pending = RegisterSet();
+            }
+            if (isa::isVariableLatency(isa::latencyClassOf(inst.opcode, inst.modifier))) pending |= defs;
+        }
+        return pending;
+    };
+
+    std::pmr::vector<RegisterSet> in(blocks.size(), scratch), out(blocks.size(), scratch);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            RegisterSet entry;
+            for (size_t pred : blocks[b].preds) entry |= out[pred];
+            RegisterSet exit = transfer(b, entry, false);
+            if (entry != in[b] || exit != out[b]) {
+                in[b] = entry;
+                out[b] = exit;
+                changed = true;
+            }
+        }
+    }
+    for (size_t b = 0; b < blocks.size(); ++b) transfer(b, in[b], true);
+}
+
+// In-order issue model per basic block: instruction i+1 issues 1 + stall(i)
+// cycles after instruction i. Fixed-latency results are not tracked across
+// blocks, so each block drains them on its last instruction.
+void StallSetter::setStalls(const ControlFlowGraph& cfg) {
+    std::vector<Instruction>& insts = kernel_.instructions;
+
+    for (const BasicBlock& block : cfg.getBlocks()) {
+        ReadyTimes ready;
+        int cycle = 0;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            Instruction& inst = insts[i];
+            RegisterSet defs, uses;
+            collectDefsUses(inst, defs, uses);
+            RegisterSet touched = defs;
+            touched |= uses;
+
+            int required = ready.latest(touched);
+            if (required > cycle && i > block.begin) {
+                int extra = std::min(required - cycle, isa::kMaxStall - insts[i - 1].stall);
+                insts[i - 1].stall += extra;
+                cycle += extra;
+            }
+
+            isa::LatencyClass latencyClass = isa::latencyClassOf(inst.opcode, inst.modifier);
+            if (!isa::isVariableLatency(latencyClass)) {
+                ready.set(defs, cycle + isa::latencyCycles(latencyClass));
+            }
+            cycle += 1;
+        }
+
+        Instruction& last = insts[block.end - 1];
+        int drain = ready.max() - cycle;
+        if (drain > 0) last.stall = std::min(isa::kMaxStall, last.stall + drain);
+    }
 }
 
 const std::vector<int>& StallSetter::getStalls() const {
     return stalls_;
 }
 
+int StallSetter::getTotalStalls() const {
+    int total = 0;
+    for (int stall : stalls_) total += stall;
+    return total;
+}
+
+int StallSetter::getWaitCount() const {
+    int count = 0;
+    for (const Instruction& inst : kernel_.instructions) count += inst.wait ? 1 : 0;
+    return count;
+}
+
 } // namespace algorithms
 } // namespace opuas
@@ -0,0 +1,38 @@
+// opuas/src/algorithms/StallSetter.h
+#ifndef STALL_SETTER_H
+#define STALL_SETTER_H
+
+#include <memory_resource>
+#include <vector>
+#include "Program.h"
+
+namespace opuas {
+namespace algorithms {
+
+class ControlFlowGraph;
+
+// Sets the stall count and scoreboard wait bit of every instruction in a kernel.
+// Fixed-latency results (ALU, MUL, transcendental) are covered by stall cycles
+// on the preceding instructions; variable-latency memory results are covered by
+// a wait bit on the first instruction that touches the destination register.
+class StallSetter {
+public:
+    explicit StallSetter(Kernel& kernel);
+
+    bool analyzeAndSet();
+    const std::vector<int>& getStalls() const;
+    int getTotalStalls() const;
+    int getWaitCount() const;
+
+private:
+    void setWaitBits(const ControlFlowGraph& cfg, std::pmr::memory_resource* scratch);
+    void setStalls(const ControlFlowGraph& cfg);
+
+    Kernel& kernel_;
+    std::vector<int> stalls_;
+};
+
+} // namespace algorithms
+} // namespace opuas
+
+#endif // STALL_SETTER_H
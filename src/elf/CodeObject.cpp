@@ -0,0 +1,63 @@
+// opuas/src/elf/CodeObject.cpp
+#include "CodeObject.h"
+
+namespace opuas {
+namespace elf {
+
+namespace {
+
+// opu.kernels keys and the descriptor fields they map to.
+struct MetadataField {
+    const char* key;
+    uint32_t KernelDescriptor::*field;
+};
+
+const MetadataField kMetadataFields[] = {
+    { ".shared_memsize",          &KernelDescriptor::sharedMemSize },
+    { ".private_memsize",         &KernelDescriptor::privateMemSize },
+    { ".cmem_size",               &KernelDescriptor::cmemSize },
+    { ".bar_used",                &KernelDescriptor::barUsed },
+    { ".local_framesize",         &KernelDescriptor::localFrameSize },
+    { ".kernel_ctrl",             &KernelDescriptor::kernelCtrl },
+    { ".kernel_mode",             &KernelDescriptor::kernelMode },
+    { ".max_flat_workgroup_size", &KernelDescriptor::maxWorkgroupSize },
+};
+
+} // namespace
+
+KernelDescriptor KernelDescriptor::fromMetadata(const std::map<std::string, int64_t>& metadata,
+                                                std::vector<std::string>* unknownKeys) {
+    KernelDescriptor descriptor;
+    for (const auto& [key, value] : metadata) {
+        bool known = false;
+        for (const MetadataField& field : kMetadataFields) {
+            if (key == field.key) {
+                descriptor.*field.field = static_cast<uint32_t>(value);
+                known = true;
+                break;
+            }
+        }
+        if (!known && unknownKeys) unknownKeys->push_back(key);
+    }
+    return descriptor;
+}
+
+std::map<std::string, int64_t> KernelDescriptor::toMetadata() const {
+    std::map<std::string, int64_t> metadata;
+    for (const MetadataField& field : kMetadataFields) {
+        uint32_t value = this->*field.field;
+        if (field.field == &KernelDescriptor::maxWorkgroupSize && value == 0) continue; // Optional key
+        metadata[field.key] = value;
+    }
+    return metadata;
+}
+
+const KernelCode* CodeObject::findKernel(const std::string& name) const {
+    for (const KernelCode& kernel : kernels) {
+        if (kernel.name == name) return &kernel;
+    }
+    return nullptr;
+}
+
+} // namespace elf
+} // namespace opuas
@@ -0,0 +1,65 @@
+// opuas/src/elf/CodeObject.h
+#ifndef CODE_OBJECT_H
+#define CODE_OBJECT_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Program.h"
+
+namespace opuas {
+namespace elf {
+
+// Per-kernel properties stored in .opu.kernels (see OpuKernelRecord).
+struct KernelDescriptor {
+    uint32_t sharedMemSize = 0;
+    uint32_t privateMemSize = 0;
+    uint32_t cmemSize = 0;
+    uint32_t barUsed = 0;
+    uint32_t localFrameSize = 0;
+    uint32_t kernelCtrl = 0;
+    uint32_t kernelMode = 0;
+    uint32_t maxWorkgroupSize = 0;
+    uint32_t vregCount = 0;
+    uint32_t sregCount = 0;
+    uint32_t pregCount = 0;
+
+    // Convert from/to opu.kernels metadata keys (".shared_memsize", ...).
+    // Keys without a descriptor field are appended to `unknownKeys`.
+    static KernelDescriptor fromMetadata(const std::map<std::string, int64_t>& metadata,
+                                         std::vector<std::string>* unknownKeys = nullptr);
+    std::map<std::string, int64_t> toMetadata() const;
+};
+
+struct Relocation {
+    uint32_t offset = 0;      // Byte offset of the literal word within the kernel code
+    std::string symbol;
+    uint32_t type = 0;        // R_OPU_*
+    int64_t addend = 0;
+};
+
+struct KernelCode {
+    std::string name;
+    std::vector<uint32_t> code;
+    KernelDescriptor descriptor;
+    std::vector<KernelArg> args;
+    std::vector<Relocation> relocations;
+    uint64_t fingerprint = 0; // Hash of the parsed kernel for --incremental; 0 if unknown
+};
+
+// Everything an opuas object carries, independent of the ELF layout.
+struct CodeObject {
+    std::vector<KernelCode> kernels;
+    std::vector<int> version;
+    // Symbols the object defines -> st_value (byte offset in .text), as read
+    // by ElfObjectReader; relocations against them resolve to that value.
+    std::map<std::string, uint64_t> symbols;
+
+    const KernelCode* findKernel(const std::string& name) const;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // CODE_OBJECT_H
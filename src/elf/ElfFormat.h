@@ -0,0 +1,124 @@
+// opuas/src/elf/ElfFormat.h
+#ifndef ELF_FORMAT_H
+#define ELF_FORMAT_H
+
+#include <cstdint>
+
+// --- ELF64 Structures ---
+// Only what opuas objects use; field names follow the ELF specification.
+struct Elf64_Ehdr {
+    unsigned char e_ident[16]; // ELF identification
+    uint16_t e_type;          // Object file type
+    uint16_t e_machine;       // Architecture
+    uint32_t e_version;       // Object file version
+    uint64_t e_entry;         // Entry point virtual address
+    uint64_t e_phoff;         // Program header table file offset
+    uint64_t e_shoff;         // Section header table file offset
+    uint32_t e_flags;         // Processor-specific flags
+    uint16_t e_ehsize;        // ELF header size in bytes
+    uint16_t e_phentsize;     // Program header table entry size
+    uint16_t e_phnum;         // Program header table entry count
+    uint16_t e_shentsize;     // Section header table entry size
+    uint16_t e_shnum;         // Section header table entry count
+    uint16_t e_shstrndx;      // Section header string table index
+};
+
+struct Elf64_Shdr {
+    uint32_t sh_name;      // Section name (string tbl index)
+    uint32_t sh_type;      // Section type
+    uint64_t sh_flags;     // Section flags
+    uint64_t sh_addr;      // Section virtual addr at execution
+    uint64_t sh_offset;    // Section file offset
+    uint64_t sh_size;      // Section size in bytes
+    uint32_t sh_link;      // Link to another section
+    uint32_t sh_info;      // Additional section information
+    uint64_t sh_addralign; // Section alignment
+    uint64_t sh_entsize;   // Entry size if section holds table
+};
+
+struct Elf64_Sym {
+    uint32_t st_name;      // Symbol name (string tbl index)
+    unsigned char st_info; // Symbol type and binding
+    unsigned char st_other;
+    uint16_t st_shndx;     // Section index
+    uint64_t st_value;     // Offset within the section
+    uint64_t st_size;
+};
+
+struct Elf64_Rela {
+    uint64_t r_offset;     // Byte offset of the patched word in the section
+    uint64_t r_info;       // Symbol index << 32 | type
+    int64_t r_addend;
+};
+
+// ELF constants (simplified)
+#define ET_REL 1
+#define EM_OPU 0xFEED // Placeholder machine type for OPU
+#define EV_CURRENT 1
+#define SHT_NULL 0
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHT_RELA 4
+#define SHF_ALLOC 2
+#define SHF_EXECINSTR 4
+#define SHF_INFO_LINK 0x40
+#define SHN_UNDEF 0
+#define STB_GLOBAL 1
+#define STT_NOTYPE 0
+#define STT_FUNC 2
+#define ELF64_ST_INFO(bind, type) (((bind) << 4) | ((type) & 0xf))
+#define ELF64_ST_BIND(info) ((info) >> 4)
+#define ELF64_ST_TYPE(info) ((info) & 0xf)
+#define ELF64_R_INFO(sym, type) ((static_cast<uint64_t>(sym) << 32) | (type))
+#define ELF64_R_SYM(info) ((info) >> 32)
+#define ELF64_R_TYPE(info) ((info) & 0xffffffff)
+
+// OPU relocation types
+#define R_OPU_NONE 0
+#define R_OPU_ABS32 1 // Literal word = S + A (low 32 bits)
+
+// --- OPU Sections ---
+// .opu.kernels holds one OpuKernelRecord per kernel, .opu.kargs the argument
+// records they point at, .opu.version the opu.version list as 32-bit words.
+// All string fields are offsets into .strtab.
+//
+// Every kernel starts on a kOpuKernelAlignment boundary in .text, which is
+// also the section's sh_addralign. The writer (and the linker through it)
+// lays kernels out with it and the patcher appends moved kernels with it.
+constexpr uint64_t kOpuKernelAlignment = 16;
+
+inline uint64_t alignTo(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+struct OpuKernelRecord {
+    uint32_t nameOffset;
+    uint32_t argsIndex;        // First record in .opu.kargs
+    uint32_t argsCount;
+    uint32_t sharedMemSize;
+    uint32_t privateMemSize;
+    uint32_t cmemSize;
+    uint32_t barUsed;
+    uint32_t localFrameSize;
+    uint32_t kernelCtrl;
+    uint32_t kernelMode;
+    uint32_t maxWorkgroupSize; // 0 when not specified
+    uint32_t vregCount;        // %v units referenced by the code
+    uint32_t sregCount;
+    uint32_t pregCount;
+    uint32_t reserved[2];
+};
+
+struct OpuKernelArgRecord {
+    uint32_t nameOffset;
+    uint32_t addressSpaceOffset;
+    uint32_t valueKindOffset;
+    uint32_t offset;
+    uint32_t size;
+};
+
+static_assert(sizeof(OpuKernelRecord) == 64, "OpuKernelRecord layout");
+static_assert(sizeof(OpuKernelArgRecord) == 20, "OpuKernelArgRecord layout");
+
+#endif // ELF_FORMAT_H
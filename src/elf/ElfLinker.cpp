@@ -0,0 +1,104 @@
+// opuas/src/elf/ElfLinker.cpp
+#include "ElfLinker.h"
+#include "ElfFormat.h"
+#include "ElfObjectWriter.h"
+#include <iostream>
+#include <set>
+
+namespace opuas {
+namespace elf {
+
+ElfLinker::ElfLinker(bool deduplicate) : deduplicate_(deduplicate) {}
+
+bool ElfLinker::addObject(const std::string& source, const CodeObject& object) {
+    if (!object.version.empty()) {
+        if (merged_.version.empty()) {
+            merged_.version = object.version;
+            versionSource_ = source;
+        } else if (merged_.version != object.version) {
+            std::cerr << "Linker Error: " << source << ": opu.version differs from " << versionSource_ << "\n";
+            return false;
+        }
+    }
+    for (const KernelCode& kernel : object.kernels) {
+        auto defined = definedIn_.emplace(kernel.name, source);
+        if (!defined.second) {
+            std::cerr << "Linker Error: kernel '" << kernel.name << "' is defined in both " << defined.first->second
+                      << " and " << source << "\n";
+            return false;
+        }
+        merged_.kernels.push_back(kernel);
+    }
+    return true;
+}
+
+bool ElfLinker::link(CodeObject& output) {
+    // Kernel symbols take the .text offsets the writer will give them. With
+    // deduplication, resolving can make more bodies identical, which moves
+    // later kernels; resolve again until the layout settles. Sharing only
+    // grows from one round to the next, so this ends within a round per kernel.
+    std::vector<uint64_t> textOffsets = ElfObjectWriter::textLayout(merged_, deduplicate_);
+    CodeObject resolved;
+    for (size_t round = 0;; ++round) {
+        resolved = merged_;
+        if (!resolve(resolved, textOffsets)) return false;
+        std::vector<uint64_t> layout = ElfObjectWriter::textLayout(resolved, deduplicate_);
+        if (layout == textOffsets) break;
+        if (round > merged_.kernels.size()) {
+            std::cerr << "Linker Error: kernel layout does not settle with deduplication\n";
+            return false;
+        }
+        textOffsets = std::move(layout);
+    }
+    output = std::move(resolved);
+    merged_ = CodeObject();
+    definedIn_.clear();
+    return true;
+}
+
+bool ElfLinker::resolve(CodeObject& object, const std::vector<uint64_t>& textOffsets) {
+    resolved_ = 0;
+    undefined_.clear();
+
+    std::map<std::string, uint64_t> symbolValue;
+    for (size_t k = 0; k < object.kernels.size(); ++k) symbolValue[object.kernels[k].name] = textOffsets[k];
+
+    std::set<std::string> undefined;
+    for (KernelCode& kernel : object.kernels) {
+        // Resolved code no longer matches what its source assembles to.
+        kernel.fingerprint = 0;
+        for (const Relocation& reloc : kernel.relocations) {
+            auto value = symbolValue.find(reloc.symbol);
+            if (value == symbolValue.end()) {
+                undefined.insert(reloc.symbol);
+                continue;
+            }
+            if (reloc.type != R_OPU_ABS32) {
+                std::cerr << "Linker Error: kernel '" << kernel.name << "': unsupported relocation type "
+                          << reloc.type << "\n";
+                return false;
+            }
+            const size_t word = reloc.offset / sizeof(uint32_t);
+            if (reloc.offset % sizeof(uint32_t) != 0 || word >= kernel.code.size()) {
+                std::cerr << "Linker Error: kernel '" << kernel.name << "': relocation offset " << reloc.offset
+                          << " is outside its code\n";
+                return false;
+            }
+            kernel.code[word] = static_cast<uint32_t>(value->second + reloc.addend);
+            ++resolved_;
+        }
+    }
+    undefined_.assign(undefined.begin(), undefined.end());
+    return true;
+}
+
+size_t ElfLinker::getResolvedCount() const {
+    return resolved_;
+}
+
+const std::vector<std::string>& ElfLinker::getUndefinedSymbols() const {
+    return undefined_;
+}
+
+} // namespace elf
+} // namespace opuas
@@ -0,0 +1,46 @@
+// opuas/src/elf/ElfLinker.h
+#ifndef ELF_LINKER_H
+#define ELF_LINKER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "CodeObject.h"
+
+namespace opuas {
+namespace elf {
+
+// Merges code objects into one and resolves the relocations whose symbol is
+// a kernel defined by any of them. Kernels keep the order of the inputs.
+// Every relocation is carried over, resolved or not: ElfPatcher re-applies
+// them when a kernel moves, and linking the output again resolves them to
+// the same values.
+class ElfLinker {
+public:
+    // `deduplicate` must match the ElfObjectWriter that writes the result,
+    // since shared bodies change the kernel addresses relocations resolve to.
+    explicit ElfLinker(bool deduplicate = true);
+
+    // `source` names the object in diagnostics.
+    bool addObject(const std::string& source, const CodeObject& object);
+    bool link(CodeObject& output);
+
+    size_t getResolvedCount() const;
+    const std::vector<std::string>& getUndefinedSymbols() const;
+
+private:
+    // Patch relocations against kernels at `textOffsets` into `object`.
+    bool resolve(CodeObject& object, const std::vector<uint64_t>& textOffsets);
+
+    bool deduplicate_;
+    CodeObject merged_;
+    std::map<std::string, std::string> definedIn_;   // Kernel name -> source
+    std::string versionSource_;
+    size_t resolved_ = 0;
+    std::vector<std::string> undefined_;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // ELF_LINKER_H
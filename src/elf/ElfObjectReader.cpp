@@ -1,14 +1,32 @@
 // opuas/src/elf/ElfObjectReader.cpp
 #include "ElfObjectReader.h"
+#include "ElfFormat.h"
+#include "MappedFile.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 
 namespace opuas {
 namespace elf {
 
-ElfObjectReader::ElfObjectReader(const std::string& filename) : inputFile(filename, std::ios::binary) {
+namespace {
+
+// `count` records of T starting at `offset` (bounds already checked). Empty
+// tables are not copied: data() of an empty vector may be null.
+template <typename T>
+std::vector<T> readTable(std::string_view image, uint64_t offset, size_t count) {
+    std::vector<T> table(count);
+    if (count) memcpy(table.data(), image.data() + offset, count * sizeof(T));
+    return table;
+}
+
+} // namespace
+
+ElfObjectReader::ElfObjectReader(const std::string& filename)
+    : inputFile(filename, std::ios::binary), filename_(filename) {
     if (!inputFile.is_open()) {
         throw std::runtime_error("ElfObjectReader: Could not open input file " + filename);
     }
@@ -20,36 +38,188 @@ bool ElfObjectReader::read() {
         return false;
     }
 
-    std::cout << "ElfObjectReader Info: Reading ELF object file (placeholder)...\n";
+    // Map the file when possible; section contents are copied straight out
+    // of the mapping. Fall back to reading the stream (pipes, empty files).
+    MappedFile mapping;
+    if (mapping.open(filename_)) return parse(std::string_view(mapping.data(), mapping.size()));
+
+    std::stringstream buffer;
+    buffer << inputFile.rdbuf();
+    const std::string contents = buffer.str();
+    return parse(contents);
+}
+
+bool ElfObjectReader::parse(std::string_view image) {
+    object_ = CodeObject();
+    codeSegments_.clear();
+
+    // 1. ELF header
+    Elf64_Ehdr ehdr;
+    if (image.size() < sizeof(ehdr)) return fail("file too small for an ELF header");
+    memcpy(&ehdr, image.data(), sizeof(ehdr));
+    if (memcmp(ehdr.e_ident, "\x7f""ELF", 4) != 0 || ehdr.e_ident[4] != 2 || ehdr.e_ident[5] != 1) {
+        return fail("not a little-endian ELF64 file");
+    }
+    if (ehdr.e_machine != EM_OPU) return fail("not an OPU object (e_machine mismatch)");
+    if (ehdr.e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr.e_shoff + static_cast<uint64_t>(ehdr.e_shnum) * sizeof(Elf64_Shdr) > image.size()) {
+        return fail("section header table out of bounds");
+    }
+
+    // 2. Section headers
+    const std::vector<Elf64_Shdr> shdrs = readTable<Elf64_Shdr>(image, ehdr.e_shoff, ehdr.e_shnum);
+    for (const Elf64_Shdr& shdr : shdrs) {
+        if (shdr.sh_type != SHT_NULL && shdr.sh_offset + shdr.sh_size > image.size()) {
+            return fail("section data out of bounds");
+        }
+    }
+    if (ehdr.e_shstrndx >= shdrs.size()) return fail("invalid section name table index");
+
+    auto stringAt = [&](const Elf64_Shdr& table, uint32_t offset) -> std::string {
+        if (offset >= table.sh_size) return "";
+        const char* start = image.data() + table.sh_offset + offset;
+        return std::string(start, strnlen(start, table.sh_size - offset));
+    };
+    auto findSection = [&](const std::string& name) -> const Elf64_Shdr* {
+        for (const Elf64_Shdr& shdr : shdrs) {
+            if (stringAt(shdrs[ehdr.e_shstrndx], shdr.sh_name) == name) return &shdr;
+        }
+        return nullptr;
+    };
+
+    const Elf64_Shdr* symtab = findSection(".symtab");
+    const Elf64_Shdr* kernelsSec = findSection(".opu.kernels");
+    const Elf64_Shdr* kargsSec = findSection(".opu.kargs");
+    if (!symtab || !kernelsSec || !kargsSec || symtab->sh_link >= shdrs.size()) {
+        return fail("missing .symtab, .opu.kernels or .opu.kargs");
+    }
+    const Elf64_Shdr& strtab = shdrs[symtab->sh_link];
+
+    // 3. Symbols
+    const std::vector<Elf64_Sym> symbols =
+        readTable<Elf64_Sym>(image, symtab->sh_offset, symtab->sh_size / sizeof(Elf64_Sym));
+    std::map<std::string, size_t> symbolByName;
+    for (size_t i = 1; i < symbols.size(); ++i) {
+        const std::string name = stringAt(strtab, symbols[i].st_name);
+        symbolByName[name] = i;
+        if (!name.empty() && symbols[i].st_shndx != SHN_UNDEF) object_.symbols[name] = symbols[i].st_value;
+    }
+
+    // 4. Kernels: descriptor records, code located through the kernel symbol
+    const std::vector<OpuKernelRecord> records =
+        readTable<OpuKernelRecord>(image, kernelsSec->sh_offset, kernelsSec->sh_size / sizeof(OpuKernelRecord));
+    const std::vector<OpuKernelArgRecord> argRecords =
+        readTable<OpuKernelArgRecord>(image, kargsSec->sh_offset, kargsSec->sh_size / sizeof(OpuKernelArgRecord));
+
+    std::vector<size_t> kernelSymbols;
+    for (const OpuKernelRecord& record : records) {
+        KernelCode kernel;
+        kernel.name = stringAt(strtab, record.nameOffset);
+        auto symIt = symbolByName.find(kernel.name);
+        if (symIt == symbolByName.end()) return fail("no symbol for kernel '" + kernel.name + "'");
+        const Elf64_Sym& sym = symbols[symIt->second];
+        if (sym.st_shndx == SHN_UNDEF || sym.st_shndx >= shdrs.size() ||
+            sym.st_value + sym.st_size > shdrs[sym.st_shndx].sh_size || sym.st_size % sizeof(uint32_t) != 0) {
+            return fail("kernel '" + kernel.name + "' code out of bounds");
+        }
+        kernel.code = readTable<uint32_t>(image, shdrs[sym.st_shndx].sh_offset + sym.st_value,
+                                          sym.st_size / sizeof(uint32_t));
+
+        KernelDescriptor& desc = kernel.descriptor;
+        desc.sharedMemSize = record.sharedMemSize;
+        desc.privateMemSize = record.privateMemSize;
+        desc.cmemSize = record.cmemSize;
+        desc.barUsed = record.barUsed;
+        desc.localFrameSize = record.localFrameSize;
+        desc.kernelCtrl = record.kernelCtrl;
+        desc.kernelMode = record.kernelMode;
+        desc.maxWorkgroupSize = record.maxWorkgroupSize;
+        desc.vregCount = record.vregCount;
+        desc.sregCount = record.sregCount;
+        desc.pregCount = record.pregCount;
+
+        if (static_cast<uint64_t>(record.argsIndex) + record.argsCount > argRecords.size()) {
+            return fail("kernel '" + kernel.name + "' argument records out of bounds");
+        }
+        for (uint32_t a = 0; a < record.argsCount; ++a) {
+            const OpuKernelArgRecord& argRecord = argRecords[record.argsIndex + a];
+            KernelArg arg;
+            arg.name = stringAt(strtab, argRecord.nameOffset);
+            arg.addressSpace = stringAt(strtab, argRecord.addressSpaceOffset);
+            arg.valueKind = stringAt(strtab, argRecord.valueKindOffset);
+            arg.offset = argRecord.offset;
+            arg.size = argRecord.size;
+            kernel.args.push_back(arg);
+        }
+        kernelSymbols.push_back(symIt->second);
+        object_.kernels.push_back(std::move(kernel));
+    }
+
+    // 5. Relocations, attributed to every kernel whose code contains them
+    // (kernels with identical bodies share one copy)
+    for (const Elf64_Shdr& shdr : shdrs) {
+        if (shdr.sh_type != SHT_RELA) continue;
+        size_t count = shdr.sh_size / sizeof(Elf64_Rela);
+        for (size_t r = 0; r < count; ++r) {
+            Elf64_Rela rela;
+            memcpy(&rela, image.data() + shdr.sh_offset + r * sizeof(Elf64_Rela), sizeof(rela));
+            if (ELF64_R_SYM(rela.r_info) >= symbols.size()) return fail("relocation symbol out of range");
+            bool attached = false;
+            for (size_t k = 0; k < object_.kernels.size(); ++k) {
+                const Elf64_Sym& sym = symbols[kernelSymbols[k]];
+                if (sym.st_shndx != shdr.sh_info || rela.r_offset < sym.st_value ||
+                    rela.r_offset >= sym.st_value + sym.st_size) {
+                    continue;
+                }
+                Relocation reloc;
+                reloc.offset = static_cast<uint32_t>(rela.r_offset - sym.st_value);
+                reloc.symbol = stringAt(strtab, symbols[ELF64_R_SYM(rela.r_info)].st_name);
+                reloc.type = static_cast<uint32_t>(ELF64_R_TYPE(rela.r_info));
+                reloc.addend = rela.r_addend;
+                object_.kernels[k].relocations.push_back(reloc);
+                attached = true;
+            }
+            if (!attached) return fail("relocation outside of any kernel");
+        }
+    }
 
-    // --- Placeholder ELF Reading Logic ---
-    // This would involve:
-    // 1. Reading the ELF Header.
-    // 2. Seeking to and reading the Section Header Table.
-    // 3. Iterating section headers to find .text, .opu.kernels, etc.
-    // 4. Reading section data into buffers.
-    // 5. Parsing section data (e.g., extracting machine code words from .text,
-    //     parsing metadata structs from .opu.kernels).
+    // 6. opu.version
+    if (const Elf64_Shdr* versionSec = findSection(".opu.version")) {
+        for (uint64_t off = 0; off + sizeof(uint32_t) <= versionSec->sh_size; off += sizeof(uint32_t)) {
+            uint32_t word;
+            memcpy(&word, image.data() + versionSec->sh_offset + off, sizeof(word));
+            object_.version.push_back(static_cast<int>(word));
+        }
+    }
 
-    // For now, simulate reading some dummy data.
-    // In a real reader, you'd populate codeSegments_ and metadata_ from the ELF file.
-    std::vector<uint32_t> dummyReadSegment = {0xDEADBEEF, 0xC0FFEE00};
-    codeSegments_["read_dummy_text"] = dummyReadSegment;
+    // 7. Source fingerprints (--incremental), one per descriptor record
+    if (const Elf64_Shdr* fingerprintSec = findSection(".opu.fingerprints")) {
+        if (fingerprintSec->sh_size != object_.kernels.size() * sizeof(uint64_t)) {
+            return fail("fingerprint count does not match the kernel count");
+        }
+        for (size_t k = 0; k < object_.kernels.size(); ++k) {
+            memcpy(&object_.kernels[k].fingerprint, image.data() + fingerprintSec->sh_offset + k * sizeof(uint64_t),
+                   sizeof(uint64_t));
+        }
+    }
 
-    metadata_[".shared_memsize_read"] = 256;
-    metadata_[".kernel_ctrl_read"] = 15; // Example value
+    for (const KernelCode& kernel : object_.kernels) codeSegments_[kernel.name] = kernel.code;
 
-    std::cout << "ElfObjectReader Info: ELF object file read successfully (placeholder logic).\n";
+    std::clog << "ElfObjectReader Info: Read " << object_.kernels.size() << " kernel(s) from '" << filename_ << "'.\n";
     return true;
-    // --- End of Placeholder Logic ---
+}
+
+const CodeObject& ElfObjectReader::getCodeObject() const {
+    return object_;
 }
 
 const std::map<std::string, std::vector<uint32_t>>& ElfObjectReader::getCodeSegments() const {
     return codeSegments_;
 }
 
-const std::map<std::string, int>& ElfObjectReader::getMetadata() const {
-    return metadata_;
+bool ElfObjectReader::fail(const std::string& message) {
+    std::cerr << "ElfObjectReader Error: " << filename_ << ": " << message << std::endl;
+    return false;
 }
 
 ElfObjectReader::~ElfObjectReader() {
@@ -0,0 +1,40 @@
+// opuas/src/elf/ElfObjectReader.h
+#ifndef ELF_OBJECT_READER_H
+#define ELF_OBJECT_READER_H
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CodeObject.h"
+
+namespace opuas {
+namespace elf {
+
+// Reads an object produced by ElfObjectWriter back into a CodeObject.
+class ElfObjectReader {
+public:
+    explicit ElfObjectReader(const std::string& filename);
+    ~ElfObjectReader();
+
+    bool read();
+    const CodeObject& getCodeObject() const;
+    // Kernel name -> code words.
+    const std::map<std::string, std::vector<uint32_t>>& getCodeSegments() const;
+
+private:
+    bool parse(std::string_view image);
+    bool fail(const std::string& message);
+
+    std::ifstream inputFile;
+    std::string filename_;
+    CodeObject object_;
+    std::map<std::string, std::vector<uint32_t>> codeSegments_;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // ELF_OBJECT_READER_H
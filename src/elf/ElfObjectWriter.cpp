@@ -1,192 +1,562 @@
 // opuas/src/elf/ElfObjectWriter.cpp
 #include "ElfObjectWriter.h"
+#include "ElfFormat.h"
+#include "utils.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <cstdint>
 #include <cstring> // For memcpy
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
 
-// --- Simplified ELF Structures (Placeholder) ---
-// In a real implementation, you'd use a library like libelf or write detailed structs.
-// Or define them here based on ELF specification.
-struct Elf64_Ehdr {
-    unsigned char e_ident[16]; // ELF identification
-    uint16_t e_type;          // Object file type
-    uint16_t e_machine;       // Architecture
-    uint32_t e_version;       // Object file version
-    uint64_t e_entry;         // Entry point virtual address
-    uint64_t e_phoff;         // Program header table file offset
-    uint64_t e_shoff;         // Section header table file offset
-    uint32_t e_flags;         // Processor-specific flags
-    uint16_t e_ehsize;        // ELF header size in bytes
-    uint16_t e_phentsize;     // Program header table entry size
-    uint16_t e_phnum;         // Program header table entry count
-    uint16_t e_shentsize;     // Section header table entry size
-    uint16_t e_shnum;         // Section header table entry count
-    uint16_t e_shstrndx;      // Section header string table index
+namespace opuas {
+namespace elf {
+
+namespace {
+
+template <typename T>
+void appendBytes(std::vector<char>& buffer, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+// Section contents that move to a temporary file once they outgrow
+// kSpillThreshold, so per-kernel tables of a huge input stay off the heap.
+class SpillBuffer {
+public:
+    SpillBuffer() = default;
+    SpillBuffer(const SpillBuffer&) = delete;
+    SpillBuffer& operator=(const SpillBuffer&) = delete;
+    ~SpillBuffer() {
+        if (file_) std::fclose(file_);
+    }
+
+    bool append(const void* data, size_t size) {
+        size_ += size;
+        if (!file_ && memory_.size() + size > kSpillThreshold) {
+            file_ = std::tmpfile();
+            if (!file_ || std::fwrite(memory_.data(), 1, memory_.size(), file_) != memory_.size()) return false;
+            std::vector<char>().swap(memory_);
+        }
+        if (file_) return std::fwrite(data, 1, size, file_) == size;
+        const char* bytes = static_cast<const char*>(data);
+        memory_.insert(memory_.end(), bytes, bytes + size);
+        return true;
+    }
+
+    template <typename T>
+    bool append(const T& value) {
+        return append(&value, sizeof(T));
+    }
+
+    uint64_t size() const { return size_; }
+
+    // Read back `size` bytes at `offset`; appending continues at the end.
+    bool read(uint64_t offset, void* data, size_t size) {
+        if (offset > size_ || size > size_ - offset) return false;
+        if (size == 0) return true;
+        if (!file_) {
+            std::memcpy(data, memory_.data() + offset, size);
+            return true;
+        }
+        const bool ok = std::fseek(file_, static_cast<long>(offset), SEEK_SET) == 0 &&
+                        std::fread(data, 1, size, file_) == size;
+        return std::fseek(file_, 0, SEEK_END) == 0 && ok;
+    }
+
+    // Copy to `out` in whole records of `recordSize` bytes, letting `fixup`
+    // patch each record first.
+    bool copyTo(std::ostream& out, size_t recordSize, const std::function<void(char*)>& fixup = nullptr) {
+        auto emit = [&](char* data, size_t size) {
+            if (fixup) {
+                for (size_t offset = 0; offset + recordSize <= size; offset += recordSize) fixup(data + offset);
+            }
+            out.write(data, size);
+        };
+        if (!file_) {
+            emit(memory_.data(), memory_.size());
+            return static_cast<bool>(out);
+        }
+        std::rewind(file_);
+        std::vector<char> block(kSpillBlock / recordSize * recordSize);
+        for (uint64_t left = size_; left > 0;) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, block.size()));
+            if (std::fread(block.data(), 1, chunk, file_) != chunk) return false;
+            emit(block.data(), chunk);
+            left -= chunk;
+        }
+        return static_cast<bool>(out);
+    }
+
+private:
+    static constexpr size_t kSpillThreshold = 4 << 20;
+    static constexpr size_t kSpillBlock = 1 << 20;
+
+    std::vector<char> memory_;
+    std::FILE* file_ = nullptr;
+    uint64_t size_ = 0;
 };
 
-struct Elf64_Shdr {
-    uint32_t sh_name;      // Section name (string tbl index)
-    uint32_t sh_type;      // Section type
-    uint64_t sh_flags;     // Section flags
-    uint64_t sh_addr;      // Section virtual addr at execution
-    uint64_t sh_offset;    // Section file offset
-    uint64_t sh_size;      // Section size in bytes
-    uint32_t sh_link;      // Link to another section
-    uint32_t sh_info;      // Additional section information
-    uint64_t sh_addralign; // Section alignment
-    uint64_t sh_entsize;   // Entry size if section holds table
+// Null-terminated string table with the empty string at offset 0. The
+// strings stay in the (spilling) buffer; only their hashes and offsets are
+// kept, and a hash match is confirmed by reading the string back.
+class StringTable {
+public:
+    StringTable() { data_.append('\0'); }
+
+    uint32_t add(const std::string& text) {
+        uint32_t offset = 0;
+        if (find(text, offset)) return offset;
+        offset = static_cast<uint32_t>(data_.size());
+        if (!data_.append(text.c_str(), text.size() + 1)) failed_ = true;
+        offsets_.emplace(utils::hash64(text.data(), text.size()), offset);
+        return offset;
+    }
+
+    bool find(const std::string& text, uint32_t& offset) {
+        auto range = offsets_.equal_range(utils::hash64(text.data(), text.size()));
+        std::string stored(text.size() + 1, '\0');
+        for (auto it = range.first; it != range.second; ++it) {
+            if (data_.read(it->second, stored.data(), stored.size()) && stored.back() == '\0' &&
+                stored.compare(0, text.size(), text) == 0) {
+                offset = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    SpillBuffer& data() { return data_; }
+    bool failed() const { return failed_; }
+
+private:
+    SpillBuffer data_;
+    std::unordered_multimap<uint64_t, uint32_t> offsets_;   // Hash -> offset
+    bool failed_ = false;
 };
 
-// ELF constants (simplified)
-#define ET_REL 1
-#define EM_OPU 0xFEED // Placeholder machine type for OPU
-#define EV_CURRENT 1
-#define SHT_PROGBITS 1
-#define SHT_SYMTAB 2
-#define SHT_STRTAB 3
-#define SHF_ALLOC 2
-#define SHF_EXECINSTR 4
+bool sameRelocations(const std::vector<Relocation>& a, const std::vector<Relocation>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Relocation& x, const Relocation& y) {
+        return x.offset == y.offset && x.symbol == y.symbol && x.type == y.type && x.addend == y.addend;
+    });
+}
 
-namespace opuas {
-namespace elf {
+// Kernels may share a body when their code and relocations are identical.
+uint64_t bodyHash(const KernelCode& kernel) {
+    uint64_t hash = utils::hash64(kernel.code.data(), kernel.code.size() * sizeof(uint32_t));
+    for (const Relocation& reloc : kernel.relocations) {
+        hash = utils::hash64(&reloc.offset, sizeof(reloc.offset), hash);
+        hash = utils::hash64(reloc.symbol.data(), reloc.symbol.size(), hash);
+        hash = utils::hash64(&reloc.type, sizeof(reloc.type), hash);
+        hash = utils::hash64(&reloc.addend, sizeof(reloc.addend), hash);
+    }
+    return hash;
+}
+
+} // namespace
+
+std::vector<uint64_t> ElfObjectWriter::textLayout(const CodeObject& object, bool deduplicate) {
+    std::vector<uint64_t> offsets;
+    std::unordered_multimap<uint64_t, size_t> bodies;   // Body hash -> kernel that owns the copy
+    uint64_t end = 0;
+    for (size_t k = 0; k < object.kernels.size(); ++k) {
+        const KernelCode& kernel = object.kernels[k];
+        if (deduplicate) {
+            const uint64_t hash = bodyHash(kernel);
+            auto range = bodies.equal_range(hash);
+            auto match = std::find_if(range.first, range.second, [&](const auto& body) {
+                const KernelCode& other = object.kernels[body.second];
+                return other.code == kernel.code && sameRelocations(other.relocations, kernel.relocations);
+            });
+            if (match != range.second) {
+                offsets.push_back(offsets[match->second]);
+                continue;
+            }
+            bodies.emplace(hash, k);
+        }
+        end = alignTo(end, kOpuKernelAlignment);
+        offsets.push_back(end);
+        end += kernel.code.size() * sizeof(uint32_t);
+    }
+    return offsets;
+}
+
+// Everything after .text, collected while kernels are added. Relocations
+// refer to their symbol by its position in referencedSymbols until finish()
+// knows which symbols end up undefined and where. Symbols are identified by
+// the .strtab offset of their name, so no name is kept here.
+struct ElfObjectWriter::PendingSections {
+    uint64_t position = 0;   // Bytes written to the file so far
+    uint64_t textStart = 0;
+    uint64_t textSize = 0;
+    size_t kernelCount = 0;
+    bool failed = false;
+
+    StringTable strtab;
+    SpillBuffer kernels, kargs, symtab, rela, fingerprints;
+    bool hasFingerprints = false;
+    uint32_t argCount = 0;
+    std::unordered_map<uint32_t, uint32_t> definedSymbols;   // Name -> symbol index
+    std::vector<uint32_t> referencedSymbols;                 // Names, in order of first use
+    std::unordered_map<uint32_t, uint32_t> referenceIds;     // Name -> position in referencedSymbols
+
+    // Deduplication. Bodies and argument lists are found by hash and
+    // confirmed against the file and the spilled .rela.text and .opu.kargs.
+    struct Body {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t firstRelocation;   // Index of its first entry in rela
+        uint64_t relocationCount;
+    };
+    std::unordered_multimap<uint64_t, Body> bodies;
+    std::unordered_multimap<uint64_t, uint32_t> argLists;   // Records' hash -> index of their first copy
+    size_t sharedBodies = 0;
+    size_t sharedArgLists = 0;
+    uint64_t bytesSaved = 0;
+
+    // Whether the relocations stored for `body` are `relocations`.
+    bool sameRelocations(const Body& body, const std::vector<Relocation>& relocations) {
+        if (body.relocationCount != relocations.size()) return false;
+        for (size_t i = 0; i < relocations.size(); ++i) {
+            const Relocation& reloc = relocations[i];
+            Elf64_Rela entry;
+            if (!rela.read((body.firstRelocation + i) * sizeof(entry), &entry, sizeof(entry))) return false;
+            uint32_t name = 0;
+            auto id = strtab.find(reloc.symbol, name) ? referenceIds.find(name) : referenceIds.end();
+            if (id == referenceIds.end() || ELF64_R_SYM(entry.r_info) != id->second ||
+                ELF64_R_TYPE(entry.r_info) != reloc.type || entry.r_offset != body.offset + reloc.offset ||
+                entry.r_addend != reloc.addend) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-ElfObjectWriter::ElfObjectWriter(const std::string& filename) : outputFile(filename, std::ios::binary) {
+    // Whether .opu.kargs holds `records` at record `index`.
+    bool sameArgList(uint32_t index, const std::vector<char>& records) {
+        std::vector<char> stored(records.size());
+        return kargs.read(static_cast<uint64_t>(index) * sizeof(OpuKernelArgRecord), stored.data(), stored.size()) &&
+               stored == records;
+    }
+};
+
+ElfObjectWriter::ElfObjectWriter(const std::string& filename, bool deduplicate)
+    : outputFile(filename, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary),
+      deduplicate(deduplicate) {
     if (!outputFile.is_open()) {
         throw std::runtime_error("ElfObjectWriter: Could not open output file " + filename);
     }
 }
 
-bool ElfObjectWriter::write(const std::map<std::string, std::vector<uint32_t>>& codeSegments,
-                            const std::map<std::string, int>& metadata) {
+bool ElfObjectWriter::write(const CodeObject& object) {
+    std::clog << "ElfObjectWriter Info: Writing ELF object file...\n";
+    for (const KernelCode& kernel : object.kernels) {
+        if (!addKernel(kernel)) return false;
+    }
+    return finish(object.version);
+}
+
+void ElfObjectWriter::startSections() {
+    // The ELF header is written last, once the section table is known.
+    pending = std::make_unique<PendingSections>();
+    pending->textStart = alignTo(sizeof(Elf64_Ehdr), kOpuKernelAlignment);
+    pending->position = pending->textStart;
+    outputFile.seekp(static_cast<std::streamoff>(pending->textStart));
+}
+
+bool ElfObjectWriter::addKernel(const KernelCode& kernel) {
+    if (!outputFile.is_open()) {
+        std::cerr << "ElfObjectWriter Error: Output file is not open.\n";
+        return false;
+    }
+    if (!pending) startSections();
+    PendingSections& sections = *pending;
+
+    // 1. Code, straight to the file unless an identical body is there already
+    const uint64_t codeSize = kernel.code.size() * sizeof(uint32_t);
+    const uint64_t hash = deduplicate ? bodyHash(kernel) : 0;
+    const PendingSections::Body* shared = nullptr;
+    if (deduplicate) {
+        auto range = sections.bodies.equal_range(hash);
+        for (auto it = range.first; it != range.second && !shared; ++it) {
+            const PendingSections::Body& body = it->second;
+            if (body.size == codeSize && sections.sameRelocations(body, kernel.relocations) &&
+                textMatches(body.offset, kernel.code)) {
+                shared = &body;
+            }
+        }
+    }
+    uint64_t offset = 0;
+    if (shared) {
+        offset = shared->offset;
+        sections.sharedBodies++;
+        sections.bytesSaved += codeSize + kernel.relocations.size() * sizeof(Elf64_Rela);
+    } else {
+        offset = alignTo(sections.textSize, kOpuKernelAlignment);
+        const std::vector<char> padding(offset - sections.textSize, 0);
+        outputFile.write(padding.data(), padding.size());
+        outputFile.write(reinterpret_cast<const char*>(kernel.code.data()), codeSize);
+        sections.textSize = offset + codeSize;
+        if (deduplicate) {
+            sections.bodies.emplace(hash, PendingSections::Body{offset, codeSize,
+                                                                sections.rela.size() / sizeof(Elf64_Rela),
+                                                                kernel.relocations.size()});
+        }
+    }
+
+    Elf64_Sym sym = {};
+    sym.st_name = sections.strtab.add(kernel.name);
+    sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+    sym.st_shndx = 1; // .text
+    sym.st_value = offset;
+    sym.st_size = codeSize;
+    sections.definedSymbols[sym.st_name] = static_cast<uint32_t>(++sections.kernelCount);
+    bool ok = sections.symtab.append(sym);
+
+    // 2. Argument and descriptor records
+    std::vector<char> argData;
+    for (const KernelArg& arg : kernel.args) {
+        OpuKernelArgRecord argRecord = {};
+        argRecord.nameOffset = sections.strtab.add(arg.name);
+        argRecord.addressSpaceOffset = sections.strtab.add(arg.addressSpace);
+        argRecord.valueKindOffset = sections.strtab.add(arg.valueKind);
+        argRecord.offset = arg.offset;
+        argRecord.size = arg.size;
+        appendBytes(argData, argRecord);
+    }
+    uint32_t argsIndex = sections.argCount;
+    bool sharedArgs = false;
+    const uint64_t argHash = deduplicate && !argData.empty() ? utils::hash64(argData.data(), argData.size()) : 0;
+    if (deduplicate && !argData.empty()) {
+        auto range = sections.argLists.equal_range(argHash);
+        for (auto it = range.first; it != range.second && !sharedArgs; ++it) {
+            if (sections.sameArgList(it->second, argData)) {
+                argsIndex = it->second;
+                sharedArgs = true;
+            }
+        }
+    }
+    if (sharedArgs) {
+        sections.sharedArgLists++;
+        sections.bytesSaved += argData.size();
+    } else {
+        if (deduplicate && !argData.empty()) sections.argLists.emplace(argHash, argsIndex);
+        ok = sections.kargs.append(argData.data(), argData.size()) && ok;
+        sections.argCount += static_cast<uint32_t>(kernel.args.size());
+    }
+
+    OpuKernelRecord record = {};
+    record.nameOffset = sym.st_name;
+    record.argsIndex = argsIndex;
+    record.argsCount = static_cast<uint32_t>(kernel.args.size());
+    record.sharedMemSize = kernel.descriptor.sharedMemSize;
+    record.privateMemSize = kernel.descriptor.privateMemSize;
+    record.cmemSize = kernel.descriptor.cmemSize;
+    record.barUsed = kernel.descriptor.barUsed;
+    record.localFrameSize = kernel.descriptor.localFrameSize;
+    record.kernelCtrl = kernel.descriptor.kernelCtrl;
+    record.kernelMode = kernel.descriptor.kernelMode;
+    record.maxWorkgroupSize = kernel.descriptor.maxWorkgroupSize;
+    record.vregCount = kernel.descriptor.vregCount;
+    record.sregCount = kernel.descriptor.sregCount;
+    record.pregCount = kernel.descriptor.pregCount;
+    ok = sections.kernels.append(record) && ok;
+    ok = sections.fingerprints.append(kernel.fingerprint) && ok;
+    sections.hasFingerprints = sections.hasFingerprints || kernel.fingerprint != 0;
+
+    // 3. Relocations, resolved to symbol indices in finish(). A shared body
+    // already has its relocations.
+    const std::vector<Relocation> noRelocations;
+    for (const Relocation& reloc : shared ? noRelocations : kernel.relocations) {
+        const uint32_t name = sections.strtab.add(reloc.symbol);
+        auto id = sections.referenceIds.emplace(name, static_cast<uint32_t>(sections.referencedSymbols.size()));
+        if (id.second) sections.referencedSymbols.push_back(name);
+        Elf64_Rela entry = {};
+        entry.r_offset = offset + reloc.offset;
+        entry.r_info = ELF64_R_INFO(id.first->second, reloc.type);
+        entry.r_addend = reloc.addend;
+        ok = sections.rela.append(entry) && ok;
+    }
+
+    if (!ok || sections.strtab.failed() || !outputFile) {
+        std::cerr << "ElfObjectWriter Error: Failed to write kernel '" << kernel.name << "'.\n";
+        sections.failed = true;
+        return false;
+    }
+    sections.position = sections.textStart + sections.textSize;
+    return true;
+}
+
+bool ElfObjectWriter::finish(const std::vector<int>& version) {
     if (!outputFile.is_open()) {
         std::cerr << "ElfObjectWriter Error: Output file is not open.\n";
         return false;
     }
+    if (!pending) startSections();
+    std::unique_ptr<PendingSections> sections = std::move(pending);
+    if (sections->failed) return false;
+
+    // Symbols referenced by relocations but not defined here stay undefined.
+    std::vector<uint32_t> symbolIndex;   // By reference id
+    uint32_t symbolCount = static_cast<uint32_t>(sections->kernelCount) + 1;
+    for (uint32_t name : sections->referencedSymbols) {
+        auto defined = sections->definedSymbols.find(name);
+        if (defined != sections->definedSymbols.end()) {
+            symbolIndex.push_back(defined->second);
+            continue;
+        }
+        Elf64_Sym sym = {};
+        sym.st_name = name;
+        sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        sym.st_shndx = SHN_UNDEF;
+        symbolIndex.push_back(symbolCount++);
+        if (!sections->symtab.append(sym)) {
+            std::cerr << "ElfObjectWriter Error: Failed to buffer the symbol table.\n";
+            return false;
+        }
+    }
+    std::vector<char> versionData;
+    for (int word : version) appendBytes(versionData, static_cast<uint32_t>(word));
+
+    // 1. Section headers (index order is fixed; .rela.text only when needed)
+    struct Section {
+        const char* name;
+        Elf64_Shdr header;
+        std::function<bool()> write;
+        uint64_t size;
+    };
+    auto makeHeader = [](uint32_t type, uint64_t flags, uint64_t align, uint64_t entsize) {
+        Elf64_Shdr shdr = {};
+        shdr.sh_type = type;
+        shdr.sh_flags = flags;
+        shdr.sh_addralign = align;
+        shdr.sh_entsize = entsize;
+        return shdr;
+    };
+    auto bytes = [this](const std::vector<char>& data) {
+        return [this, &data]() {
+            outputFile.write(data.data(), data.size());
+            return static_cast<bool>(outputFile);
+        };
+    };
+    auto spilled = [this](SpillBuffer& buffer, size_t recordSize) {
+        return [this, &buffer, recordSize]() { return buffer.copyTo(outputFile, recordSize); };
+    };
+    auto relocations = [this, &sections, &symbolIndex]() {
+        return sections->rela.copyTo(outputFile, sizeof(Elf64_Rela), [&symbolIndex](char* record) {
+            Elf64_Rela entry;
+            memcpy(&entry, record, sizeof(entry));
+            entry.r_info = ELF64_R_INFO(symbolIndex[ELF64_R_SYM(entry.r_info)], ELF64_R_TYPE(entry.r_info));
+            memcpy(record, &entry, sizeof(entry));
+        });
+    };
 
-    std::cout << "ElfObjectWriter Info: Writing ELF object file...\n";
+    StringTable shstrtab;
+    SpillBuffer& strtab = sections->strtab.data();
+    std::vector<Section> table;
+    table.push_back({"", makeHeader(SHT_NULL, 0, 0, 0), nullptr, 0});
+    table.push_back({".text", makeHeader(SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, kOpuKernelAlignment, 0), nullptr,
+                     sections->textSize});
+    table.push_back({".opu.kernels", makeHeader(SHT_PROGBITS, 0, 4, sizeof(OpuKernelRecord)),
+                     spilled(sections->kernels, sizeof(OpuKernelRecord)), sections->kernels.size()});
+    table.push_back({".opu.kargs", makeHeader(SHT_PROGBITS, 0, 4, sizeof(OpuKernelArgRecord)),
+                     spilled(sections->kargs, sizeof(OpuKernelArgRecord)), sections->kargs.size()});
+    table.push_back({".opu.version", makeHeader(SHT_PROGBITS, 0, 4, sizeof(uint32_t)), bytes(versionData),
+                     versionData.size()});
+    const uint32_t symtabIndex = static_cast<uint32_t>(table.size());
+    table.push_back({".symtab", makeHeader(SHT_SYMTAB, 0, 8, sizeof(Elf64_Sym)),
+                     spilled(sections->symtab, sizeof(Elf64_Sym)), sizeof(Elf64_Sym) + sections->symtab.size()});
+    table.back().header.sh_link = symtabIndex + 1; // .strtab
+    table.back().header.sh_info = 1;               // All symbols after the null one are global
+    table.push_back({".strtab", makeHeader(SHT_STRTAB, 0, 1, 0), spilled(strtab, 1), strtab.size()});
+    if (sections->rela.size() > 0) {
+        table.push_back({".rela.text", makeHeader(SHT_RELA, SHF_INFO_LINK, 8, sizeof(Elf64_Rela)), relocations,
+                         sections->rela.size()});
+        table.back().header.sh_link = symtabIndex;
+        table.back().header.sh_info = 1; // .text
+    }
+    if (sections->hasFingerprints) {
+        table.push_back({".opu.fingerprints", makeHeader(SHT_PROGBITS, 0, 8, sizeof(uint64_t)),
+                         spilled(sections->fingerprints, sizeof(uint64_t)), sections->fingerprints.size()});
+    }
+    for (Section& section : table) section.header.sh_name = shstrtab.add(section.name);
+    const uint16_t shstrtabIndex = static_cast<uint16_t>(table.size());
+    const uint32_t shstrtabName = shstrtab.add(".shstrtab");
+    table.push_back({".shstrtab", makeHeader(SHT_STRTAB, 0, 1, 0), spilled(shstrtab.data(), 1),
+                     shstrtab.data().size()});
+    table.back().header.sh_name = shstrtabName;
 
-    // --- Placeholder ELF Writing Logic ---
-    // A real implementation is complex. This is a very simplified sketch.
+    // 2. Layout: ELF header, .text (already written), the remaining section
+    // contents, section header table
+    uint64_t position = sections->position;
+    auto padTo = [&](uint64_t alignment) {
+        const uint64_t aligned = alignTo(position, std::max<uint64_t>(alignment, 1));
+        const std::vector<char> padding(aligned - position, 0);
+        outputFile.write(padding.data(), padding.size());
+        position = aligned;
+    };
+    table[1].header.sh_offset = sections->textStart;
+    table[1].header.sh_size = sections->textSize;
+    const Elf64_Sym nullSymbol = {};
+    bool ok = true;
+    for (size_t i = 2; i < table.size(); ++i) {
+        Section& section = table[i];
+        padTo(section.header.sh_addralign);
+        section.header.sh_offset = position;
+        section.header.sh_size = section.size;
+        if (i == symtabIndex) outputFile.write(reinterpret_cast<const char*>(&nullSymbol), sizeof(nullSymbol));
+        ok = section.write() && ok;
+        position += section.size;
+    }
+    padTo(8);
 
-    // 1. Prepare ELF Header
     Elf64_Ehdr ehdr = {}; // Zero-initialize
-    // Set magic number
     memcpy(ehdr.e_ident, "\x7f""ELF", 4);
     ehdr.e_ident[4] = 2; // ELFCLASS64
     ehdr.e_ident[5] = 1; // ELFDATA2LSB
     ehdr.e_ident[6] = 1; // EV_CURRENT
-    // ehdr.e_ident[7..15] = 0; // OS/ABI, padding
-
     ehdr.e_type = ET_REL; // Relocatable file
     ehdr.e_machine = EM_OPU; // Our custom machine type
     ehdr.e_version = EV_CURRENT;
-    ehdr.e_entry = 0; // No entry point for .o
-    ehdr.e_phoff = 0; // No program headers in .o
-    ehdr.e_shoff = 0; // Will be set later
-    ehdr.e_flags = 0; // Processor-specific flags (could hold arch info)
+    ehdr.e_shoff = position;
     ehdr.e_ehsize = sizeof(Elf64_Ehdr);
-    ehdr.e_phentsize = 0; // No program headers
-    ehdr.e_phnum = 0;
     ehdr.e_shentsize = sizeof(Elf64_Shdr);
-    ehdr.e_shnum = 0; // Will be set later
-    ehdr.e_shstrndx = 0; // Will be set later
-
-    // 2. Prepare Section Headers and Data
-    // This involves creating sections for code, metadata, symbol table, string table, etc.
-    // For simplicity, let's just write one dummy .text section.
-    std::vector<char> textData;
-    if (!codeSegments.empty()) {
-        // Take the first segment as dummy .text
-        auto it = codeSegments.begin();
-        const std::vector<uint32_t>& segmentWords = it->second;
-        // Convert uint32_t words to bytes
-        textData.resize(segmentWords.size() * sizeof(uint32_t));
-        memcpy(textData.data(), segmentWords.data(), textData.size());
-    }
-
-    Elf64_Shdr textShdr = {};
-    textShdr.sh_name = 1; // Index into shstrtab (placeholder)
-    textShdr.sh_type = SHT_PROGBITS;
-    textShdr.sh_flags = SHF_ALLOC | SHF_EXECINSTR;
-    textShdr.sh_addr = 0; // Relocatable, so 0
-    textShdr.sh_offset = 0; // Will be set later
-    textShdr.sh_size = textData.size();
-    textShdr.sh_link = 0;
-    textShdr.sh_info = 0;
-    textShdr.sh_addralign = 16; // Typical alignment
-    textShdr.sh_entsize = 0;
-
-    // 3. Prepare String Table (.shstrtab)
-    std::string shstrtab = "\0.text\0.shstrtab"; // Null-terminated strings
-    std::vector<char> shstrtabData(shstrtab.begin(), shstrtab.end());
-    shstrtabData.push_back('\0'); // Ensure null termination at the end
-
-    Elf64_Shdr shstrtabShdr = {};
-    shstrtabShdr.sh_name = 8; // Index of ".shstrtab" in shstrtab itself
-    shstrtabShdr.sh_type = SHT_STRTAB;
-    shstrtabShdr.sh_flags = 0;
-    shstrtabShdr.sh_addr = 0;
-    shstrtabShdr.sh_offset = 0; // Will be set later
-    shstrtabShdr.sh_size = shstrtabData.size();
-    shstrtabShdr.sh_link = 0;
-    shstrtabShdr.sh_info = 0;
-    shstrtabShdr.sh_addralign = 1;
-    shstrtabShdr.sh_entsize = 0;
-
-    // 4. Layout ELF in memory/file
-    // Calculate offsets
-    size_t ehdrSize = sizeof(ehdr);
-    size_t shdrSize = sizeof(Elf64_Shdr);
-    size_t numShdrs = 3; // NULL, .text, .shstrtab (placeholder)
-    size_t shdrsOffset = ehdrSize; // Section headers come right after ELF header
-    size_t textOffset = shdrsOffset + numShdrs * shdrSize;
-    size_t shstrtabOffset = textOffset + textData.size();
-
-    // Update offsets in headers
-    textShdr.sh_offset = textOffset;
-    shstrtabShdr.sh_offset = shstrtabOffset;
-    ehdr.e_shoff = shdrsOffset;
-    ehdr.e_shnum = numShdrs;
-    ehdr.e_shstrndx = 2; // Index of .shstrtab section header
-
-    // 5. Write ELF File
-    try {
-        // Write ELF Header
-        outputFile.write(reinterpret_cast<const char*>(&ehdr), ehdrSize);
-
-        // Write Section Headers (placeholder order: NULL, .text, .shstrtab)
-        Elf64_Shdr nullShdr = {}; // NULL section header
-        outputFile.write(reinterpret_cast<const char*>(&nullShdr), shdrSize);
-        outputFile.write(reinterpret_cast<const char*>(&textShdr), shdrSize);
-        outputFile.write(reinterpret_cast<const char*>(&shstrtabShdr), shdrSize);
-
-        // Write Section Data
-        if (!textData.empty()) {
-            outputFile.write(textData.data(), textData.size());
-        }
-        if (!shstrtabData.empty()) {
-            outputFile.write(shstrtabData.data(), shstrtabData.size());
-        }
-
-        outputFile.flush();
-        std::cout << "ElfObjectWriter Info: ELF object file written successfully (placeholder logic).\n";
-        return true;
+    ehdr.e_shnum = static_cast<uint16_t>(table.size());
+    ehdr.e_shstrndx = shstrtabIndex;
+    for (const Section& section : table) {
+        outputFile.write(reinterpret_cast<const char*>(&section.header), sizeof(section.header));
+        position += sizeof(section.header);
+    }
+    outputFile.seekp(0);
+    outputFile.write(reinterpret_cast<const char*>(&ehdr), sizeof(ehdr));
 
-    } catch (const std::exception& e) {
-        std::cerr << "ElfObjectWriter Error: Exception occurred while writing file: " << e.what() << std::endl;
+    // 3. Flush the ELF file
+    outputFile.flush();
+    if (!ok || !outputFile) {
+        std::cerr << "ElfObjectWriter Error: Failed to write output file.\n";
         return false;
     }
+    if (sections->sharedBodies || sections->sharedArgLists) {
+        std::clog << "ElfObjectWriter Info: Deduplication shared " << sections->sharedBodies << " kernel body(ies) and "
+                  << sections->sharedArgLists << " argument list(s), saving " << sections->bytesSaved << " bytes.\n";
+    }
+    std::clog << "ElfObjectWriter Info: ELF object file written successfully (" << sections->kernelCount
+              << " kernel(s), " << position << " bytes).\n";
+    return true;
+}
 
-    // --- End of Placeholder Logic ---
-
-    // A full implementation would:
-    // - Handle multiple code segments.
-    // - Generate and write symbol table (.symtab) and associated string table (.strtab).
-    // - Encode metadata into custom sections (e.g., .opu.kernels, .opu.version).
-    // - Handle relocations if needed.
-    // - Ensure correct alignment and padding.
+bool ElfObjectWriter::textMatches(uint64_t offset, const std::vector<uint32_t>& code) {
+    std::vector<uint32_t> existing(code.size());
+    outputFile.flush();
+    outputFile.seekg(static_cast<std::streamoff>(pending->textStart + offset));
+    outputFile.read(reinterpret_cast<char*>(existing.data()), existing.size() * sizeof(uint32_t));
+    const bool matches = outputFile && existing == code;
+    outputFile.clear();
+    outputFile.seekp(static_cast<std::streamoff>(pending->textStart + pending->textSize));
+    return matches;
 }
 
 ElfObjectWriter::~ElfObjectWriter() {
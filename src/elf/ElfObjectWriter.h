@@ -0,0 +1,65 @@
+// opuas/src/elf/ElfObjectWriter.h
+#ifndef ELF_OBJECT_WRITER_H
+#define ELF_OBJECT_WRITER_H
+
+#include <fstream>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CodeObject.h"
+
+namespace opuas {
+namespace elf {
+
+// Writes a relocatable ELF64 object:
+//   .text          kernel code, one STT_FUNC symbol per kernel
+//   .opu.kernels   OpuKernelRecord per kernel
+//   .opu.kargs     OpuKernelArgRecord per kernel argument
+//   .opu.version   opu.version words
+//   .symtab/.strtab, .rela.text (if any relocations)
+//   .opu.fingerprints  fingerprint per kernel (parsed code), in .opu.kernels order
+//                      (only when some kernel has one)
+//   .shstrtab
+//
+// Kernel code goes to the file as each kernel is added; the other sections,
+// .strtab included, are buffered and spill to temporary files once they grow
+// large, so addKernel()/finish() can write objects that never fit in memory.
+// What stays on the heap until finish() is a fixed-size index entry per
+// kernel, per distinct symbol or argument name and per distinct argument
+// list (hashes, offsets and symbol indices): on the order of 100 bytes per
+// kernel.
+//
+// With deduplication (the default), a kernel whose code and relocations
+// match a kernel already written gets no copy of its own: its symbol points
+// at the existing body and the relocations are stored once. Identical
+// argument lists likewise share one run of .opu.kargs records.
+class ElfObjectWriter {
+public:
+    explicit ElfObjectWriter(const std::string& filename, bool deduplicate = true);
+    ~ElfObjectWriter();
+
+    bool write(const CodeObject& object);
+    // Incremental form of write(); produces the same bytes.
+    bool addKernel(const KernelCode& kernel);
+    bool finish(const std::vector<int>& version);
+
+    // Offset of each kernel in .text, in the order write() places them.
+    static std::vector<uint64_t> textLayout(const CodeObject& object, bool deduplicate = true);
+
+private:
+    struct PendingSections;
+
+    void startSections();
+    // Whether .text already holds `code` at `offset`; reads the file back.
+    bool textMatches(uint64_t offset, const std::vector<uint32_t>& code);
+
+    std::fstream outputFile;   // Read back to confirm duplicate bodies
+    bool deduplicate;
+    std::unique_ptr<PendingSections> pending;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // ELF_OBJECT_WRITER_H
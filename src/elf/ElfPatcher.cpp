@@ -0,0 +1,329 @@
+// opuas/src/elf/ElfPatcher.cpp
+#include "ElfPatcher.h"
+#include "ElfFormat.h"
+#include "MappedFile.h"
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+namespace opuas {
+namespace elf {
+
+namespace {
+
+template <typename T>
+std::vector<T> readTable(const char* image, const Elf64_Shdr& shdr) {
+    std::vector<T> table(shdr.sh_size / sizeof(T));
+    if (!table.empty()) memcpy(table.data(), image + shdr.sh_offset, table.size() * sizeof(T));
+    return table;
+}
+
+template <typename T>
+std::vector<char> tableBytes(const std::vector<T>& table) {
+    const char* bytes = reinterpret_cast<const char*>(table.data());
+    return std::vector<char>(bytes, bytes + table.size() * sizeof(T));
+}
+
+} // namespace
+
+ElfPatcher::ElfPatcher(const std::string& filename) : filename_(filename) {}
+
+bool ElfPatcher::replaceKernel(const KernelCode& kernel) {
+    inPlace_ = false;
+    written_ = 0;
+    appended_ = 0;
+
+    MappedFile file;
+    if (!file.open(filename_, true)) return fail(file.getError());
+    char* image = file.data();
+    const size_t fileSize = file.size();
+
+    // 1. Locate sections, the kernel symbol and its descriptor record.
+    Elf64_Ehdr ehdr;
+    if (fileSize < sizeof(ehdr)) return fail("file too small for an ELF header");
+    memcpy(&ehdr, image, sizeof(ehdr));
+    if (memcmp(ehdr.e_ident, "\x7f""ELF", 4) != 0 || ehdr.e_machine != EM_OPU ||
+        ehdr.e_shentsize != sizeof(Elf64_Shdr) ||
+        ehdr.e_shoff + static_cast<uint64_t>(ehdr.e_shnum) * sizeof(Elf64_Shdr) > fileSize ||
+        ehdr.e_shstrndx >= ehdr.e_shnum) {
+        return fail("not an OPU object");
+    }
+    std::vector<Elf64_Shdr> shdrs(ehdr.e_shnum);
+    memcpy(shdrs.data(), image + ehdr.e_shoff, shdrs.size() * sizeof(Elf64_Shdr));
+    for (const Elf64_Shdr& shdr : shdrs) {
+        if (shdr.sh_type != SHT_NULL && shdr.sh_offset + shdr.sh_size > fileSize) return fail("section data out of bounds");
+    }
+    auto sectionName = [&](const Elf64_Shdr& shdr) {
+        const Elf64_Shdr& names = shdrs[ehdr.e_shstrndx];
+        if (shdr.sh_name >= names.sh_size) return std::string();
+        const char* start = image + names.sh_offset + shdr.sh_name;
+        return std::string(start, strnlen(start, names.sh_size - shdr.sh_name));
+    };
+    auto findSection = [&](const std::string& name) -> int {
+        for (size_t i = 0; i < shdrs.size(); ++i) {
+            if (sectionName(shdrs[i]) == name) return static_cast<int>(i);
+        }
+        return -1;
+    };
+    const int symtabIdx = findSection(".symtab");
+    const int kernelsIdx = findSection(".opu.kernels");
+    const int kargsIdx = findSection(".opu.kargs");
+    const int fingerprintsIdx = findSection(".opu.fingerprints");
+    if (symtabIdx < 0 || kernelsIdx < 0 || kargsIdx < 0 || shdrs[symtabIdx].sh_link >= shdrs.size()) {
+        return fail("missing .symtab, .opu.kernels or .opu.kargs");
+    }
+    const int strtabIdx = static_cast<int>(shdrs[symtabIdx].sh_link);
+
+    std::string strtab(image + shdrs[strtabIdx].sh_offset, shdrs[strtabIdx].sh_size);
+    const size_t oldStrtabSize = strtab.size();
+    std::vector<Elf64_Sym> symbols = readTable<Elf64_Sym>(image, shdrs[symtabIdx]);
+    const size_t oldSymbolCount = symbols.size();
+    std::vector<OpuKernelRecord> records = readTable<OpuKernelRecord>(image, shdrs[kernelsIdx]);
+    std::vector<OpuKernelArgRecord> argRecords = readTable<OpuKernelArgRecord>(image, shdrs[kargsIdx]);
+    const size_t oldArgCount = argRecords.size();
+    auto stringAt = [&](uint32_t offset) {
+        if (offset >= strtab.size()) return std::string();
+        return std::string(strtab.c_str() + offset);
+    };
+
+    size_t symIdx = 0;
+    for (size_t i = 1; i < symbols.size(); ++i) {
+        if (symbols[i].st_shndx != SHN_UNDEF && stringAt(symbols[i].st_name) == kernel.name) symIdx = i;
+    }
+    size_t recordIdx = records.size();
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (stringAt(records[i].nameOffset) == kernel.name) recordIdx = i;
+    }
+    if (symIdx == 0 || recordIdx == records.size()) return fail("no kernel '" + kernel.name + "' in the object");
+    Elf64_Sym& sym = symbols[symIdx];
+    const uint16_t textIdx = sym.st_shndx;
+    if (textIdx >= shdrs.size() || sym.st_value + sym.st_size > shdrs[textIdx].sh_size) {
+        return fail("kernel '" + kernel.name + "' code out of bounds");
+    }
+    const uint64_t oldValue = sym.st_value;
+    const uint64_t oldSize = sym.st_size;
+
+    // The slot runs up to the next symbol in the section (or its end). A
+    // body shared with another kernel has no slot of its own.
+    uint64_t slotEnd = shdrs[textIdx].sh_size;
+    bool codeShared = false;
+    for (size_t i = 1; i < symbols.size(); ++i) {
+        const Elf64_Sym& other = symbols[i];
+        if (other.st_shndx != textIdx || i == symIdx) continue;
+        if (other.st_value > oldValue) slotEnd = std::min(slotEnd, other.st_value);
+        if (other.st_value == oldValue) codeShared = true;
+    }
+
+    int relaIdx = -1;
+    for (size_t i = 0; i < shdrs.size(); ++i) {
+        if (shdrs[i].sh_type == SHT_RELA && shdrs[i].sh_info == textIdx) relaIdx = static_cast<int>(i);
+    }
+    std::vector<Elf64_Rela> relas;
+    if (relaIdx >= 0) relas = readTable<Elf64_Rela>(image, shdrs[relaIdx]);
+    const size_t oldRelaCount = relas.size();
+    if (relaIdx < 0 && !kernel.relocations.empty()) {
+        return fail("the object has no .rela.text section for the new kernel's relocations; reassemble it");
+    }
+
+    // 2. Build the new contents. Strings and symbols are reused when present.
+    auto addString = [&](const std::string& text) -> uint32_t {
+        size_t pos = strtab.find(text + '\0');
+        if (pos != std::string::npos) return static_cast<uint32_t>(pos);
+        pos = strtab.size();
+        strtab.append(text);
+        strtab.push_back('\0');
+        return static_cast<uint32_t>(pos);
+    };
+
+    std::vector<OpuKernelArgRecord> newArgs;
+    for (const KernelArg& arg : kernel.args) {
+        OpuKernelArgRecord record = {};
+        record.nameOffset = addString(arg.name);
+        record.addressSpaceOffset = addString(arg.addressSpace);
+        record.valueKindOffset = addString(arg.valueKind);
+        record.offset = arg.offset;
+        record.size = arg.size;
+        newArgs.push_back(record);
+    }
+    OpuKernelRecord& record = records[recordIdx];
+    bool argsShared = false;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const OpuKernelRecord& other = records[i];
+        argsShared = argsShared || (i != recordIdx && other.argsCount && record.argsCount &&
+                                    other.argsIndex < record.argsIndex + record.argsCount &&
+                                    record.argsIndex < other.argsIndex + other.argsCount);
+    }
+    if (newArgs.size() <= record.argsCount && !argsShared) {
+        std::copy(newArgs.begin(), newArgs.end(), argRecords.begin() + record.argsIndex);
+    } else {
+        record.argsIndex = static_cast<uint32_t>(argRecords.size());
+        argRecords.insert(argRecords.end(), newArgs.begin(), newArgs.end());
+    }
+    record.argsCount = static_cast<uint32_t>(newArgs.size());
+    const KernelDescriptor& desc = kernel.descriptor;
+    record.sharedMemSize = desc.sharedMemSize;
+    record.privateMemSize = desc.privateMemSize;
+    record.cmemSize = desc.cmemSize;
+    record.barUsed = desc.barUsed;
+    record.localFrameSize = desc.localFrameSize;
+    record.kernelCtrl = desc.kernelCtrl;
+    record.kernelMode = desc.kernelMode;
+    record.maxWorkgroupSize = desc.maxWorkgroupSize;
+    record.vregCount = desc.vregCount;
+    record.sregCount = desc.sregCount;
+    record.pregCount = desc.pregCount;
+
+    const uint64_t newSize = kernel.code.size() * sizeof(uint32_t);
+    const bool codeFits = !codeShared && oldValue + newSize <= slotEnd;
+    std::vector<char> newText;
+    if (codeFits) {
+        sym.st_size = newSize;
+    } else {
+        const Elf64_Shdr& text = shdrs[textIdx];
+        newText.assign(image + text.sh_offset, image + text.sh_offset + text.sh_size);
+        newText.resize(alignTo(newText.size(), kOpuKernelAlignment), 0);
+        sym.st_value = newText.size();
+        sym.st_size = newSize;
+        const char* bytes = reinterpret_cast<const char*>(kernel.code.data());
+        newText.insert(newText.end(), bytes, bytes + newSize);
+    }
+
+    std::vector<Elf64_Rela> newRelas;
+    for (const Elf64_Rela& rela : relas) {
+        if (!codeShared && rela.r_offset >= oldValue && rela.r_offset < oldValue + oldSize) continue;
+        newRelas.push_back(rela);
+    }
+    for (const Relocation& reloc : kernel.relocations) {
+        uint32_t target = 0;
+        for (size_t i = 1; i < symbols.size() && !target; ++i) {
+            if (stringAt(symbols[i].st_name) == reloc.symbol) target = static_cast<uint32_t>(i);
+        }
+        if (!target) {
+            Elf64_Sym undefined = {};
+            undefined.st_name = addString(reloc.symbol);
+            undefined.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+            undefined.st_shndx = SHN_UNDEF;
+            target = static_cast<uint32_t>(symbols.size());
+            symbols.push_back(undefined);
+        }
+        Elf64_Rela rela = {};
+        rela.r_offset = symbols[symIdx].st_value + reloc.offset;
+        rela.r_info = ELF64_R_INFO(target, reloc.type);
+        rela.r_addend = reloc.addend;
+        newRelas.push_back(rela);
+    }
+
+    // Relocations against kernels of this object hold absolute .text offsets
+    // once linked (ElfLinker keeps them). Resolve the new code's own, and
+    // when the kernel moved, repoint every word that refers to it.
+    const bool moved = sym.st_value != oldValue;
+    const size_t firstNewRela = newRelas.size() - kernel.relocations.size();
+    std::vector<std::pair<uint64_t, uint32_t>> fixups;    // .text offset, value
+    for (size_t i = 0; i < newRelas.size(); ++i) {
+        const Elf64_Rela& rela = newRelas[i];
+        const size_t target = ELF64_R_SYM(rela.r_info);
+        if (target >= symbols.size() || symbols[target].st_shndx != textIdx) continue;
+        if (i < firstNewRela && !(moved && target == symIdx)) continue;
+        if (ELF64_R_TYPE(rela.r_info) != R_OPU_ABS32) {
+            return fail("unsupported relocation type " + std::to_string(ELF64_R_TYPE(rela.r_info)) +
+                        " against kernel '" + stringAt(symbols[target].st_name) + "'");
+        }
+        fixups.emplace_back(rela.r_offset, static_cast<uint32_t>(symbols[target].st_value + rela.r_addend));
+    }
+    const uint64_t textSize = codeFits ? shdrs[textIdx].sh_size : newText.size();
+    for (const auto& [offset, value] : fixups) {
+        if (offset % sizeof(uint32_t) != 0 || offset + sizeof(uint32_t) > textSize) {
+            return fail("relocation offset " + std::to_string(offset) + " is outside .text");
+        }
+        if (!codeFits) memcpy(newText.data() + offset, &value, sizeof(value));
+    }
+
+    // 3. Append the sections that grew, then patch everything else through
+    // the mapping. The mapping stays valid for the original file size.
+    std::vector<std::pair<int, std::vector<char>>> appends;
+    if (!codeFits) appends.emplace_back(textIdx, std::move(newText));
+    if (argRecords.size() != oldArgCount) appends.emplace_back(kargsIdx, tableBytes(argRecords));
+    if (symbols.size() != oldSymbolCount) appends.emplace_back(symtabIdx, tableBytes(symbols));
+    if (strtab.size() != oldStrtabSize) appends.emplace_back(strtabIdx, std::vector<char>(strtab.begin(), strtab.end()));
+    if (relaIdx >= 0 && newRelas.size() != oldRelaCount) appends.emplace_back(relaIdx, tableBytes(newRelas));
+
+    if (!appends.empty()) {
+        std::ofstream out(filename_, std::ios::binary | std::ios::app);
+        if (!out.is_open()) return fail("could not open for appending");
+        size_t end = fileSize;
+        for (auto& [index, bytes] : appends) {
+            const size_t start = alignTo(end, std::max<uint64_t>(shdrs[index].sh_addralign, 1));
+            std::vector<char> padding(start - end, 0);
+            out.write(padding.data(), padding.size());
+            out.write(bytes.data(), bytes.size());
+            shdrs[index].sh_offset = start;
+            shdrs[index].sh_size = bytes.size();
+            end = start + bytes.size();
+            appended_ += padding.size() + bytes.size();
+        }
+        out.flush();
+        if (!out) return fail("failed to append sections");
+    }
+
+    auto patch = [&](uint64_t offset, const void* data, size_t size) {
+        memcpy(image + offset, data, size);
+        written_ += size;
+    };
+    if (codeFits) {
+        const uint64_t base = shdrs[textIdx].sh_offset + oldValue;
+        patch(base, kernel.code.data(), newSize);
+        if (oldSize > newSize) {
+            std::vector<char> zeros(oldSize - newSize, 0);
+            patch(base + newSize, zeros.data(), zeros.size());
+        }
+        for (const auto& [offset, value] : fixups) {
+            char* word = image + shdrs[textIdx].sh_offset + offset;
+            if (memcmp(word, &value, sizeof(value)) != 0) patch(word - image, &value, sizeof(value));
+        }
+    }
+    patch(shdrs[kernelsIdx].sh_offset + recordIdx * sizeof(OpuKernelRecord), &record, sizeof(record));
+    if (fingerprintsIdx >= 0 && (recordIdx + 1) * sizeof(uint64_t) <= shdrs[fingerprintsIdx].sh_size) {
+        // The old fingerprint must not let --incremental bring the old code back.
+        patch(shdrs[fingerprintsIdx].sh_offset + recordIdx * sizeof(uint64_t), &kernel.fingerprint, sizeof(uint64_t));
+    }
+    if (argRecords.size() == oldArgCount && !newArgs.empty()) {
+        patch(shdrs[kargsIdx].sh_offset + record.argsIndex * sizeof(OpuKernelArgRecord), newArgs.data(),
+              newArgs.size() * sizeof(OpuKernelArgRecord));
+    }
+    if (symbols.size() == oldSymbolCount) {
+        patch(shdrs[symtabIdx].sh_offset + symIdx * sizeof(Elf64_Sym), &symbols[symIdx], sizeof(Elf64_Sym));
+    }
+    if (relaIdx >= 0 && newRelas.size() == oldRelaCount && !newRelas.empty()) {
+        patch(shdrs[relaIdx].sh_offset, newRelas.data(), newRelas.size() * sizeof(Elf64_Rela));
+    }
+    for (const auto& [index, bytes] : appends) {
+        patch(ehdr.e_shoff + index * sizeof(Elf64_Shdr), &shdrs[index], sizeof(Elf64_Shdr));
+    }
+    if (!file.sync()) return fail(file.getError());
+
+    inPlace_ = appends.empty();
+    return true;
+}
+
+bool ElfPatcher::wasInPlace() const {
+    return inPlace_;
+}
+
+size_t ElfPatcher::getBytesWritten() const {
+    return written_;
+}
+
+size_t ElfPatcher::getBytesAppended() const {
+    return appended_;
+}
+
+bool ElfPatcher::fail(const std::string& message) {
+    std::cerr << "ElfPatcher Error: " << filename_ << ": " << message << std::endl;
+    return false;
+}
+
+} // namespace elf
+} // namespace opuas
@@ -0,0 +1,48 @@
+// opuas/src/elf/ElfPatcher.h
+#ifndef ELF_PATCHER_H
+#define ELF_PATCHER_H
+
+#include <cstddef>
+#include <string>
+#include "CodeObject.h"
+
+namespace opuas {
+namespace elf {
+
+// Replaces one kernel's code, descriptor and arguments inside an existing
+// object written by ElfObjectWriter, without rewriting the rest of the file.
+//
+// Everything that fits its old place is written through a shared mapping:
+// the code (when it fits the kernel's slot in .text, alignment padding
+// included), the OpuKernelRecord, argument records and relocations. A
+// section that must grow is appended to the end of the file as a new copy,
+// and only that section's header is updated to point at it. Code or argument
+// records the writer shared with another kernel are never overwritten; the
+// patched kernel gets its own copy.
+//
+// Relocations against kernels of the object are applied to the new code,
+// and a kernel that moves has every relocation against it re-applied, so
+// callers in a linked object follow it.
+class ElfPatcher {
+public:
+    explicit ElfPatcher(const std::string& filename);
+
+    bool replaceKernel(const KernelCode& kernel);
+
+    bool wasInPlace() const;            // Nothing had to be appended
+    size_t getBytesWritten() const;     // Patched in place
+    size_t getBytesAppended() const;
+
+private:
+    bool fail(const std::string& message);
+
+    std::string filename_;
+    bool inPlace_ = false;
+    size_t written_ = 0;
+    size_t appended_ = 0;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // ELF_PATCHER_H
@@ -0,0 +1,60 @@
+// opuas/src/elf/MappedFile.cpp
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace opuas {
+namespace elf {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path, bool writable) {
+    close();
+    fd_ = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd_ < 0) {
+        error_ = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        error_ = path + ": not a non-empty regular file";
+        close();
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         writable ? MAP_SHARED : MAP_PRIVATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        error_ = path + ": mmap failed: " + std::strerror(errno);
+        close();
+        return false;
+    }
+    data_ = static_cast<char*>(mapping);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+}
+
+bool MappedFile::sync() {
+    if (!data_) return false;
+    if (msync(data_, size_, MS_SYNC) != 0) {
+        error_ = std::string("msync failed: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+} // namespace elf
+} // namespace opuas
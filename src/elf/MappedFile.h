@@ -0,0 +1,40 @@
+// opuas/src/elf/MappedFile.h
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace opuas {
+namespace elf {
+
+// A whole file mapped into memory (POSIX mmap). Read-only mappings are
+// private; writable mappings are shared, so stores reach the file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, bool writable = false);
+    void close();
+    bool sync();    // Flush a writable mapping to the file
+
+    bool isOpen() const { return data_ != nullptr; }
+    const char* data() const { return data_; }
+    char* data() { return data_; }
+    size_t size() const { return size_; }
+    const std::string& getError() const { return error_; }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+    std::string error_;
+};
+
+} // namespace elf
+} // namespace opuas
+
+#endif // MAPPED_FILE_H
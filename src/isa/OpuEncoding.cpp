@@ -0,0 +1,227 @@
+// opuas/src/isa/OpuEncoding.cpp
+#include "OpuEncoding.h"
+#include <cstdint>
+
+namespace opuas {
+namespace isa {
+
+namespace {
+
+bool needsLiteral(const Operand& operand) {
+    if (operand.kind == OperandKind::Symbol) return true;
+    return operand.kind == OperandKind::Imm && (operand.imm < 0 || operand.imm > kMaxInlineImm);
+}
+
+bool encodeOperand(const Operand& operand, uint32_t symbolValue, uint32_t& field,
+                   bool& hasLiteral, uint32_t& literal, std::string& errorMessage) {
+    uint32_t kind = FieldNone;
+    uint32_t value = 0;
+    switch (operand.kind) {
+        case OperandKind::None:    break;
+        case OperandKind::VReg:    kind = FieldVReg; value = operand.reg; break;
+        case OperandKind::VReg64:  kind = FieldVReg64; value = operand.reg; break;
+        case OperandKind::SReg:    kind = FieldSReg; value = operand.reg; break;
+        case OperandKind::PReg:    kind = FieldPReg; value = operand.reg; break;
+        case OperandKind::Special: kind = FieldSpecial; value = operand.reg; break;
+        case OperandKind::Imm:
+        case OperandKind::Symbol:
+            if (!needsLiteral(operand)) {
+                kind = FieldInline;
+                value = static_cast<uint32_t>(operand.imm);
+                break;
+            }
+            if (hasLiteral) {
+                errorMessage = "at most one literal operand per instruction";
+                return false;
+            }
+            if (operand.kind == OperandKind::Imm && (operand.imm < INT32_MIN || operand.imm > UINT32_MAX)) {
+                errorMessage = "immediate " + std::to_string(operand.imm) + " does not fit in 32 bits";
+                return false;
+            }
+            kind = FieldLiteral;
+            hasLiteral = true;
+            literal = operand.kind == OperandKind::Symbol ? symbolValue : static_cast<uint32_t>(operand.imm);
+            break;
+    }
+    if (value > 63) {
+        errorMessage = "register index " + std::to_string(value) + " out of range";
+        return false;
+    }
+    field = (kind << 6) | value;
+    return true;
+}
+
+bool decodeOperand(uint32_t field, Operand& operand) {
+    uint32_t value = field & 0x3f;
+    switch (field >> 6) {
+        case FieldNone:    operand.kind = OperandKind::None; return value == 0;
+        case FieldVReg:    operand.kind = OperandKind::VReg; break;
+        case FieldVReg64:  operand.kind = OperandKind::VReg64; break;
+        case FieldSReg:    operand.kind = OperandKind::SReg; break;
+        case FieldPReg:    operand.kind = OperandKind::PReg; break;
+        case FieldSpecial:
+            operand.kind = OperandKind::Special;
+            if (static_cast<int>(value) >= numSpecialRegisters()) return false;
+            break;
+        case FieldInline:
+            operand.kind = OperandKind::Imm;
+            operand.imm = value;
+            return true;
+        case FieldLiteral:
+            operand.kind = OperandKind::Imm;
+            return value == 0;
+    }
+    operand.reg = static_cast<int>(value);
+    return true;
+}
+
+} // namespace
+
+bool formatHasDestination(Format format) {
+    switch (format) {
+        case Format::VOP1:
+        case Format::VOP2:
+        case Format::VOP3:
+        case Format::VCMP:
+        case Format::MLOAD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t formatOperandCount(Format format) {
+    switch (format) {
+        case Format::VOP1:     return 1;
+        case Format::VOP2:     return 2;
+        case Format::VOP3:     return 3;
+        case Format::VCMP:     return 2;
+        case Format::MLOAD:    return 2;
+        case Format::MSTORE:   return 3;
+        case Format::SOPP:     return 0;
+        case Format::SBRANCH:  return 1;
+        case Format::SCBRANCH: return 2;
+    }
+    return 0;
+}
+
+size_t encodedSize(const Instruction& inst) {
+    for (const Operand& operand : inst.operands) {
+        if (needsLiteral(operand)) return kBaseWords + 1;
+    }
+    return kBaseWords;
+}
+
+bool encodeInstruction(const Instruction& inst, uint32_t symbolValue, std::vector<uint32_t>& words,
+                       std::string& errorMessage) {
+    const Format format = inst.info().format;
+    const size_t first = formatHasDestination(format) ? 1 : 0;
+    if (inst.operands.size() != first + formatOperandCount(format)) {
+        errorMessage = "wrong number of operands";
+        return false;
+    }
+    if (inst.stall < 0 || inst.stall > kMaxStall) {
+        errorMessage = "stall count " + std::to_string(inst.stall) + " out of range";
+        return false;
+    }
+
+    bool hasLiteral = false;
+    uint32_t literal = 0;
+    uint32_t dst = 0;
+    if (first && !encodeOperand(inst.operands[0], symbolValue, dst, hasLiteral, literal, errorMessage)) {
+        return false;
+    }
+    uint32_t srcs[3] = {0, 0, 0};
+    for (size_t i = first; i < inst.operands.size(); ++i) {
+        if (!encodeOperand(inst.operands[i], symbolValue, srcs[i - first], hasLiteral, literal, errorMessage)) {
+            return false;
+        }
+    }
+
+    uint32_t word0 = static_cast<uint32_t>(inst.opcode) |
+                     (static_cast<uint32_t>(inst.type) << 7) |
+                     (static_cast<uint32_t>(inst.modifier & 0xf) << 11) |
+                     (static_cast<uint32_t>(inst.stall) << 15) |
+                     (inst.wait ? 1u << 19 : 0u) |
+                     (hasLiteral ? 1u << 20 : 0u) |
+                     (dst << 23);
+    uint32_t word1 = srcs[0] | (srcs[1] << 9) | (srcs[2] << 18);
+    words.push_back(word0);
+    words.push_back(word1);
+    if (hasLiteral) words.push_back(literal);
+    return true;
+}
+
+bool decodeInstruction(const uint32_t* words, size_t available, DecodedInstruction& decoded,
+                       std::string& errorMessage) {
+    if (available < kBaseWords) {
+        errorMessage = "truncated instruction";
+        return false;
+    }
+    const uint32_t word0 = words[0];
+    const uint32_t word1 = words[1];
+    const uint32_t opcode = word0 & 0x7f;
+    const uint32_t type = (word0 >> 7) & 0xf;
+    if (opcode >= static_cast<uint32_t>(Opcode::Count) || type >= static_cast<uint32_t>(DataType::Count) ||
+        ((word0 >> 21) & 0x3) != 0 || (word1 >> 27) != 0) {
+        errorMessage = "invalid instruction word";
+        return false;
+    }
+
+    Instruction& inst = decoded.inst;
+    inst = Instruction();
+    inst.opcode = static_cast<Opcode>(opcode);
+    inst.type = static_cast<DataType>(type);
+    inst.modifier = static_cast<uint8_t>((word0 >> 11) & 0xf);
+    inst.stall = static_cast<int>((word0 >> 15) & 0xf);
+    inst.wait = (word0 >> 19) & 1;
+    const bool hasLiteral = (word0 >> 20) & 1;
+    decoded.words = kBaseWords + (hasLiteral ? 1 : 0);
+    decoded.literalOperand = -1;
+    if (available < decoded.words) {
+        errorMessage = "truncated literal";
+        return false;
+    }
+    decoded.literal = hasLiteral ? words[2] : 0;
+
+    const Format format = inst.info().format;
+    std::vector<uint32_t> fields;
+    if (formatHasDestination(format)) fields.push_back(word0 >> 23);
+    const uint32_t srcs[3] = {word1 & 0x1ff, (word1 >> 9) & 0x1ff, (word1 >> 18) & 0x1ff};
+    for (size_t i = 0; i < formatOperandCount(format); ++i) fields.push_back(srcs[i]);
+    for (size_t i = formatOperandCount(format); i < 3; ++i) {
+        if (srcs[i] != 0) {
+            errorMessage = "unused operand slot is not zero";
+            return false;
+        }
+    }
+    if (!formatHasDestination(format) && (word0 >> 23) != 0) {
+        errorMessage = "unused destination slot is not zero";
+        return false;
+    }
+
+    for (uint32_t field : fields) {
+        Operand operand;
+        if (!decodeOperand(field, operand) || operand.kind == OperandKind::None) {
+            errorMessage = "invalid operand field";
+            return false;
+        }
+        if ((field >> 6) == FieldLiteral) {
+            if (!hasLiteral || decoded.literalOperand >= 0) {
+                errorMessage = "inconsistent literal operand";
+                return false;
+            }
+            operand.imm = decoded.literal;
+            decoded.literalOperand = static_cast<int>(inst.operands.size());
+        }
+        inst.operands.push_back(operand);
+    }
+    if (hasLiteral && decoded.literalOperand < 0) {
+        errorMessage = "literal word without a literal operand";
+        return false;
+    }
+    return true;
+}
+
+} // namespace isa
+} // namespace opuas
@@ -0,0 +1,64 @@
+// opuas/src/isa/OpuEncoding.h
+#ifndef OPU_ENCODING_H
+#define OPU_ENCODING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.h"
+
+namespace opuas {
+namespace isa {
+
+// --- Instruction Word Layout ---
+// Every instruction is two 32-bit words, followed by one 32-bit literal word
+// when an operand does not fit the 6-bit inline field.
+//
+// word0: [6:0] opcode  [10:7] data type  [14:11] modifier  [18:15] stall
+//        [19] wait     [20] literal follows  [22:21] reserved  [31:23] dst
+// word1: [8:0] src0    [17:9] src1       [26:18] src2      [31:27] reserved
+//
+// Operand field (9 bits): [8:6] kind, [5:0] register index / inline value.
+enum OperandField : uint32_t {
+    FieldNone = 0,
+    FieldVReg = 1,
+    FieldVReg64 = 2,
+    FieldSReg = 3,
+    FieldPReg = 4,
+    FieldSpecial = 5,
+    FieldInline = 6,    // Immediate 0..63
+    FieldLiteral = 7,   // Value in the literal word
+};
+
+constexpr size_t kBaseWords = 2;
+constexpr int kMaxInlineImm = 63;
+
+// Number of operand slots after the destination, and whether the format has one.
+bool formatHasDestination(Format format);
+size_t formatOperandCount(Format format);
+
+// Words needed by an instruction. Symbol operands (labels, external symbols)
+// always take the literal word so that sizes are known before layout.
+size_t encodedSize(const Instruction& inst);
+
+// Encode one instruction. `symbolValue` is the resolved value of its Symbol
+// operand, if it has one. Returns false (with a message) for operands that
+// cannot be encoded, e.g. two literals.
+bool encodeInstruction(const Instruction& inst, uint32_t symbolValue, std::vector<uint32_t>& words,
+                       std::string& errorMessage);
+
+struct DecodedInstruction {
+    Instruction inst;           // Literal operands decode to OperandKind::Imm
+    size_t words = 0;           // Encoded size
+    int literalOperand = -1;    // Index into inst.operands of the literal, if any
+    uint32_t literal = 0;
+};
+
+// Decode the instruction at `words`; `available` bounds the read.
+bool decodeInstruction(const uint32_t* words, size_t available, DecodedInstruction& decoded,
+                       std::string& errorMessage);
+
+} // namespace isa
+} // namespace opuas
+
+#endif // OPU_ENCODING_H
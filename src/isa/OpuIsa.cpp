@@ -0,0 +1,249 @@
+// opuas/src/isa/OpuIsa.cpp
+#include "OpuIsa.h"
+#include "utils.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace opuas {
+namespace isa {
+
+namespace {
+
+const OpcodeInfo kOpcodeTable[] = {
+#define OPU_OPCODE(id, mnemonic, format, latency, modifier) \
+    { mnemonic, Format::format, LatencyClass::latency, ModifierKind::modifier },
+#include "OpuIsa.def"
+#undef OPU_OPCODE
+};
+
+const char* const kDataTypeNames[] = {
+    "", "b32", "b64", "u16", "s16", "u32", "s32", "u64", "s64", "f16", "f32", "f64"
+};
+
+const char* const kMulModeNames[] = { "", "lo", "hi", "wide" };
+const char* const kCompareNames[] = { "", "eq", "ne", "lt", "le", "gt", "ge" };
+const char* const kSpaceNames[] = { "", "param", "global", "shared", "local", "const" };
+
+const char* const kSpecialRegisterNames[] = {
+    "%tid.x", "%tid.y", "%tid.z",
+    "%ntid.x", "%ntid.y", "%ntid.z",
+    "%ctaid.x", "%ctaid.y", "%ctaid.z",
+    "%nctaid.x", "%nctaid.y", "%nctaid.z",
+    "%laneid",
+};
+
+// Cycles until a result can be consumed, indexed by LatencyClass.
+const int kLatencyCycles[] = {
+    4,    // Alu
+    6,    // Mul
+    16,   // Trans
+    24,   // Param
+    32,   // Shared
+    400,  // Global
+    200,  // Local
+    2,    // Branch
+    1,    // Control
+};
+
+const char* const kLatencyClassNames[] = {
+    "alu", "mul", "trans", "param", "shared", "global", "local", "branch", "control"
+};
+
+const TargetInfo kTargetInfo = {
+    32,          // waveSize
+    4,           // simdsPerCU
+    8,           // maxWavesPerSimd
+    256,         // vregsPerSimd
+    8,           // vregGranule
+    512,         // sregsPerSimd
+    16,          // sregGranule
+    16,          // pregsPerWave
+    64 * 1024,   // sharedMemPerCU
+    256 * 1024,  // scratchPerCU
+    16,          // maxWorkgroupsPerCU
+    256,         // defaultWorkgroupSize
+};
+
+template <size_t N>
+bool lookupName(const char* const (&names)[N], const std::string& name, uint8_t& value) {
+    for (size_t i = 1; i < N; ++i) {
+        if (name == names[i]) {
+            value = static_cast<uint8_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <size_t N>
+const char* nameOf(const char* const (&names)[N], uint8_t value) {
+    return value < N ? names[value] : "";
+}
+
+} // namespace
+
+// --- Opcode Table ---
+
+const OpcodeInfo& getOpcodeInfo(Opcode opcode) {
+    return kOpcodeTable[static_cast<size_t>(opcode)];
+}
+
+bool lookupOpcode(const std::string& mnemonic, Opcode& opcode) {
+    static const std::unordered_map<std::string, Opcode> table = [] {
+        std::unordered_map<std::string, Opcode> map;
+        for (size_t i = 0; i < static_cast<size_t>(Opcode::Count); ++i) {
+            map.emplace(kOpcodeTable[i].mnemonic, static_cast<Opcode>(i));
+        }
+        return map;
+    }();
+    auto it = table.find(mnemonic);
+    if (it == table.end()) return false;
+    opcode = it->second;
+    return true;
+}
+
+// --- Data Types ---
+
+const char* dataTypeName(DataType type) {
+    return nameOf(kDataTypeNames, static_cast<uint8_t>(type));
+}
+
+bool lookupDataType(const std::string& name, DataType& type) {
+    uint8_t value = 0;
+    if (!lookupName(kDataTypeNames, name, value)) return false;
+    type = static_cast<DataType>(value);
+    return true;
+}
+
+unsigned dataTypeBits(DataType type) {
+    switch (type) {
+        case DataType::U16: case DataType::S16: case DataType::F16: return 16;
+        case DataType::B64: case DataType::U64: case DataType::S64: case DataType::F64: return 64;
+        case DataType::None: return 0;
+        default: return 32;
+    }
+}
+
+// --- Mnemonics ---
+
+bool parseMnemonic(const std::string& text, Opcode& opcode, DataType& type, uint8_t& modifier) {
+    // Dot-separated parts, split in place: this runs once per instruction.
+    size_t start = 0;
+    auto nextPart = [&]() {
+        size_t dot = std::min(text.find('.', start), text.size());
+        std::string part = text.substr(start, dot - start);
+        start = dot + 1;
+        return part;
+    };
+    if (text.empty() || !lookupOpcode(nextPart(), opcode)) return false;
+
+    const ModifierKind kind = getOpcodeInfo(opcode).modifierKind;
+    type = DataType::None;
+    modifier = 0;
+    while (start < text.size()) {
+        const std::string suffix = nextPart();
+        DataType suffixType;
+        if (lookupDataType(suffix, suffixType)) {
+            if (type == DataType::None) {
+                type = suffixType;
+            } else if (kind == ModifierKind::SrcType && modifier == 0) {
+                modifier = static_cast<uint8_t>(suffixType); // cvt.<dst>.<src>
+            } else {
+                return false;
+            }
+            continue;
+        }
+        if (modifier != 0) return false;
+        bool known = false;
+        switch (kind) {
+            case ModifierKind::MulMode: known = lookupName(kMulModeNames, suffix, modifier); break;
+            case ModifierKind::Compare: known = lookupName(kCompareNames, suffix, modifier); break;
+            case ModifierKind::Space:   known = lookupName(kSpaceNames, suffix, modifier); break;
+            default: break;
+        }
+        if (!known) return false;
+    }
+    return true;
+}
+
+std::string formatMnemonic(Opcode opcode, DataType type, uint8_t modifier) {
+    const OpcodeInfo& info = getOpcodeInfo(opcode);
+    std::string text = info.mnemonic;
+    const char* modName = "";
+    switch (info.modifierKind) {
+        case ModifierKind::MulMode: modName = nameOf(kMulModeNames, modifier); break;
+        case ModifierKind::Compare: modName = nameOf(kCompareNames, modifier); break;
+        case ModifierKind::Space:   modName = nameOf(kSpaceNames, modifier); break;
+        default: break;
+    }
+    if (*modName) text += std::string(".") + modName;
+    if (type != DataType::None) text += std::string(".") + dataTypeName(type);
+    if (info.modifierKind == ModifierKind::SrcType && modifier != 0) {
+        text += std::string(".") + dataTypeName(static_cast<DataType>(modifier));
+    }
+    return text;
+}
+
+// --- Special Registers ---
+
+bool lookupSpecialRegister(const std::string& name, int& id) {
+    for (int i = 0; i < numSpecialRegisters(); ++i) {
+        if (name == kSpecialRegisterNames[i]) {
+            id = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* specialRegisterName(int id) {
+    return (id >= 0 && id < numSpecialRegisters()) ? kSpecialRegisterNames[id] : "%invalid";
+}
+
+int numSpecialRegisters() {
+    return static_cast<int>(sizeof(kSpecialRegisterNames) / sizeof(kSpecialRegisterNames[0]));
+}
+
+// --- Latency Tables ---
+
+LatencyClass latencyClassOf(Opcode opcode, uint8_t modifier) {
+    const OpcodeInfo& info = getOpcodeInfo(opcode);
+    if (info.modifierKind != ModifierKind::Space) return info.latency;
+    switch (modifier) {
+        case SpaceParam:
+        case SpaceConst:  return LatencyClass::Param;
+        case SpaceShared: return LatencyClass::Shared;
+        case SpaceLocal:  return LatencyClass::Local;
+        default:          return LatencyClass::Global;
+    }
+}
+
+int latencyCycles(LatencyClass latencyClass) {
+    return kLatencyCycles[static_cast<size_t>(latencyClass)];
+}
+
+bool isVariableLatency(LatencyClass latencyClass) {
+    switch (latencyClass) {
+        case LatencyClass::Param:
+        case LatencyClass::Shared:
+        case LatencyClass::Global:
+        case LatencyClass::Local:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char* latencyClassName(LatencyClass latencyClass) {
+    return kLatencyClassNames[static_cast<size_t>(latencyClass)];
+}
+
+// --- Target Resources ---
+
+const TargetInfo& getTargetInfo() {
+    return kTargetInfo;
+}
+
+} // namespace isa
+} // namespace opuas
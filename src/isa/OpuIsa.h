@@ -0,0 +1,107 @@
+// opuas/src/isa/OpuIsa.h
+#ifndef OPU_ISA_H
+#define OPU_ISA_H
+
+#include <cstdint>
+#include <string>
+
+namespace opuas {
+namespace isa {
+
+// --- Instruction Formats ---
+// VOP1/VOP2/VOP3: vector ALU with one destination and 1-3 sources.
+// VCMP:           compare writing a predicate register.
+// MLOAD/MSTORE:   memory access through a [base + offset] address.
+// SOPP:           no operands (t_exit, s_nop, s_barrier).
+// SBRANCH:        unconditional branch to a label.
+// SCBRANCH:       branch on a predicate register (p0 LABEL).
+enum class Format : uint8_t { VOP1, VOP2, VOP3, VCMP, MLOAD, MSTORE, SOPP, SBRANCH, SCBRANCH };
+
+// Latency classes used by the stall setter and the static performance model.
+// Memory opcodes are listed as Global in OpuIsa.def and refined by address space.
+enum class LatencyClass : uint8_t { Alu, Mul, Trans, Param, Shared, Global, Local, Branch, Control, Count };
+
+// Which modifier family an opcode accepts in its mnemonic suffixes.
+enum class ModifierKind : uint8_t { None, MulMode, Compare, Space, SrcType };
+
+enum class Opcode : uint8_t {
+#define OPU_OPCODE(id, mnemonic, format, latency, modifier) id,
+#include "OpuIsa.def"
+#undef OPU_OPCODE
+    Count
+};
+
+enum class DataType : uint8_t { None, B32, B64, U16, S16, U32, S32, U64, S64, F16, F32, F64, Count };
+
+// Modifier values. Zero always means "no modifier"; the meaning of a non-zero
+// value depends on the opcode's ModifierKind (SrcType stores a DataType).
+enum MulMode : uint8_t { MulLo = 1, MulHi, MulWide };
+enum CompareOp : uint8_t { CmpEq = 1, CmpNe, CmpLt, CmpLe, CmpGt, CmpGe };
+enum AddressSpace : uint8_t { SpaceParam = 1, SpaceGlobal, SpaceShared, SpaceLocal, SpaceConst };
+
+struct OpcodeInfo {
+    const char* mnemonic;
+    Format format;
+    LatencyClass latency;
+    ModifierKind modifierKind;
+};
+
+// --- Opcode Table ---
+const OpcodeInfo& getOpcodeInfo(Opcode opcode);
+bool lookupOpcode(const std::string& mnemonic, Opcode& opcode);
+
+// --- Data Types ---
+const char* dataTypeName(DataType type);
+bool lookupDataType(const std::string& name, DataType& type);
+unsigned dataTypeBits(DataType type);
+
+// --- Mnemonics ---
+// Split "set_tcc.ge.u32" into opcode, data type and modifier. Returns false on
+// an unknown opcode or a suffix the opcode does not accept.
+bool parseMnemonic(const std::string& text, Opcode& opcode, DataType& type, uint8_t& modifier);
+std::string formatMnemonic(Opcode opcode, DataType type, uint8_t modifier);
+
+// --- Special Registers (%tid.x, %ntid.x, %ctaid.x, ...) ---
+bool lookupSpecialRegister(const std::string& name, int& id);
+const char* specialRegisterName(int id);
+int numSpecialRegisters();
+
+// --- Latency Tables ---
+constexpr int kMaxStall = 15; // Width of the stall field in the instruction word
+
+LatencyClass latencyClassOf(Opcode opcode, uint8_t modifier);
+int latencyCycles(LatencyClass latencyClass);
+// Memory results arrive after a variable number of cycles and are tracked by
+// the scoreboard (wait bit) instead of fixed stall counts.
+bool isVariableLatency(LatencyClass latencyClass);
+const char* latencyClassName(LatencyClass latencyClass);
+
+// --- Target Resources (per compute unit) ---
+struct TargetInfo {
+    int waveSize;               // Threads per wave
+    int simdsPerCU;
+    int maxWavesPerSimd;
+    int vregsPerSimd;           // 32-bit %v registers per lane per SIMD
+    int vregGranule;            // %v allocation granule per wave
+    int sregsPerSimd;
+    int sregGranule;
+    int pregsPerWave;           // Architectural %p registers
+    int sharedMemPerCU;         // Bytes
+    int scratchPerCU;           // Bytes of private memory backing store
+    int maxWorkgroupsPerCU;
+    int defaultWorkgroupSize;   // Threads, when the kernel does not say
+};
+
+const TargetInfo& getTargetInfo();
+
+// Architectural %v units (6-bit register field).
+constexpr int kMaxVRegs = 64;
+// .kernel_ctrl bits [31:24] hold the %v limit the kernel was allocated for
+// (--max-regs and friends); 0 when the registers are as written.
+constexpr int kKernelCtrlRegLimitShift = 24;
+constexpr uint32_t kKernelCtrlRegLimitMask = 0xffu << kKernelCtrlRegLimitShift;
+
+} // namespace isa
+} // namespace opuas
+
+#endif // OPU_ISA_H
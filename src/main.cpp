@@ -3,22 +3,152 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <filesystem>
+#include <algorithm>
+#include <cstdlib>
 #include "OpuAssembler.h"
 #include "OpuDisassembler.h"
+#include "OpuSimulator.h"
+#include "OpuLinker.h"
+#include "OpuPatcher.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <mode> [options] <input_file> [output_file]\n";
+    std::cerr << "Modes:\n";
+    std::cerr << "  assemble    - Assemble .coasm to .o/.cubin\n";
+    std::cerr << "  disassemble - Disassemble .o/.cubin to .coasm\n";
+    std::cerr << "  simulate    - Run a kernel of a .o and write its execution profile [profile_file]\n";
+    std::cerr << "  link        - Merge .o files into one object: link [-o output] <input>...\n";
+    std::cerr << "  patch       - Replace one kernel of a .o in place: patch <object> <replacement.coasm|.o>\n";
+    std::cerr << "Assemble options:\n";
+    std::cerr << "  --perf-report[=text|json]  - Print the static per-kernel performance report\n";
+    std::cerr << "  --perf-report-out <file>   - Write the performance report to <file>\n";
+    std::cerr << "  --layout-profile <file>    - Reorder basic blocks using an execution profile\n";
+    std::cerr << "  --stream                   - Assemble kernel by kernel; memory follows the largest kernel\n";
+    std::cerr << "  --incremental <previous.o> - Reuse kernels whose source is unchanged since <previous.o>\n";
+    std::cerr << "  --threads <n>              - Threads parsing large inputs (default: hardware threads)\n";
+    std::cerr << "  --mem-report               - Print allocation counts and peak RSS per phase\n";
+    std::cerr << "  --no-dedup                 - Keep separate copies of identical kernel bodies and argument lists\n";
+    std::cerr << "  --max-regs <n|auto>        - Fit each kernel in <n> %v registers, spilling as needed; 'auto' keeps\n";
+    std::cerr << "                               the limit with the best estimated throughput\n";
+    std::cerr << "  --target-occupancy <waves> - Fit each kernel's %v registers to <waves> waves per CU\n";
+    std::cerr << "                               (.max_regs / .target_occupancy in opu.kernels override both)\n";
+    std::cerr << "Disassemble options:\n";
+    std::cerr << "  --annotate                 - Comment basic blocks, loops, stalls, latency classes and live registers\n";
+    std::cerr << "  --profile <file>           - Mark hot instructions from an execution profile (implies --annotate)\n";
+    std::cerr << "Simulate options:\n";
+    std::cerr << "  --kernel <name>            - Kernel to launch (default: the only kernel)\n";
+    std::cerr << "  --grid X[,Y,Z]             - Workgroups in the grid (default 1)\n";
+    std::cerr << "  --block X[,Y,Z]            - Threads per workgroup (default 1)\n";
+    std::cerr << "  --arg <value>              - Next kernel argument, in .args order (repeatable)\n";
+    std::cerr << "  --memory <file>            - Initial global memory image\n";
+    std::cerr << "  --memory-size <bytes>      - Minimum global memory size, zero-filled\n";
+    std::cerr << "  --memory-out <file>        - Write global memory after the launch to <file>\n";
+    std::cerr << "  --threads <n>              - Host threads simulating workgroups (default 1)\n";
+    std::cerr << "  --wave-limit <n>           - Stop a wave after <n> instructions (default 16777216)\n";
+    std::cerr << "Link options:\n";
+    std::cerr << "  -o <file>                  - Output object (default output.bin)\n";
+    std::cerr << "  --threads <n>              - Threads loading inputs (default: hardware threads)\n";
+    std::cerr << "  --no-dedup                 - Keep separate copies of identical kernel bodies and argument lists\n";
+    std::cerr << "Patch options:\n";
+    std::cerr << "  --kernel <name>            - Kernel to replace (default: the replacement's only kernel)\n";
+}
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <mode> <input_file> [output_file]\n";
-        std::cerr << "Modes:\n";
-        std::cerr << "  assemble    - Assemble .coasm to .o/.cubin\n";
-        std::cerr << "  disassemble - Disassemble .o/.cubin to .coasm\n";
+        printUsage(argv[0]);
         return 1;
     }
 
     std::string mode = argv[1];
-    std::string input_file = argv[2];
-    std::string output_file = (argc > 3) ? argv[3] : "output.bin"; // Default output
+    AssemblerOptions asmOptions;
+    DisassemblerOptions disOptions;
+    SimulatorOptions simOptions;
+    unsigned threads = 0;
+    std::string outputOption;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--perf-report") {
+            asmOptions.perfReportFormat = "text";
+        } else if (arg.rfind("--perf-report=", 0) == 0) {
+            asmOptions.perfReportFormat = arg.substr(arg.find('=') + 1);
+        } else if (arg == "--perf-report-out" && i + 1 < argc) {
+            asmOptions.perfReportFile = argv[++i];
+            if (asmOptions.perfReportFormat.empty()) asmOptions.perfReportFormat = "text";
+        } else if (arg == "--stream") {
+            asmOptions.streaming = true;
+        } else if (arg == "--incremental" && i + 1 < argc) {
+            asmOptions.incrementalBase = argv[++i];
+        } else if (arg == "--mem-report") {
+            asmOptions.memoryReport = true;
+        } else if (arg == "--no-dedup") {
+            asmOptions.deduplicate = false;
+        } else if (arg == "--max-regs" && i + 1 < argc) {
+            const std::string value = argv[++i];
+            asmOptions.autoRegisterLimit = value == "auto";
+            asmOptions.maxRegs = asmOptions.autoRegisterLimit ? 0 : std::atoi(value.c_str());
+            if (!asmOptions.autoRegisterLimit && asmOptions.maxRegs <= 0) {
+                std::cerr << "Error: Invalid --max-regs '" << value << "', expected a register count or 'auto'.\n";
+                return 1;
+            }
+        } else if (arg == "--target-occupancy" && i + 1 < argc) {
+            asmOptions.targetOccupancy = std::atoi(argv[++i]);
+            if (asmOptions.targetOccupancy <= 0) {
+                std::cerr << "Error: Invalid --target-occupancy '" << argv[i] << "', expected waves per CU.\n";
+                return 1;
+            }
+        } else if (arg == "--annotate") {
+            disOptions.annotate = true;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            disOptions.profileFile = argv[++i];
+        } else if (arg == "--layout-profile" && i + 1 < argc) {
+            asmOptions.layoutProfileFile = argv[++i];
+        } else if (arg == "--kernel" && i + 1 < argc) {
+            simOptions.kernelName = argv[++i];
+        } else if ((arg == "--grid" || arg == "--block") && i + 1 < argc) {
+            opuas::sim::Dim3& dim = (arg == "--grid") ? simOptions.grid : simOptions.block;
+            if (!opuas::sim::parseDim3(argv[++i], dim)) {
+                std::cerr << "Error: Invalid " << arg << " '" << argv[i] << "', expected X[,Y,Z].\n";
+                return 1;
+            }
+        } else if (arg == "--arg" && i + 1 < argc) {
+            simOptions.args.push_back(argv[++i]);
+        } else if (arg == "--memory" && i + 1 < argc) {
+            simOptions.memoryFile = argv[++i];
+        } else if (arg == "--memory-size" && i + 1 < argc) {
+            simOptions.memorySize = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--wave-limit" && i + 1 < argc) {
+            simOptions.waveInstructionLimit = std::strtoull(argv[++i], nullptr, 0);
+            if (simOptions.waveInstructionLimit == 0) {
+                std::cerr << "Error: Invalid --wave-limit '" << argv[i] << "', expected a count.\n";
+                return 1;
+            }
+        } else if (arg == "--memory-out" && i + 1 < argc) {
+            simOptions.memoryOutFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputOption = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option '" << arg << "'.\n";
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string input_file = positional[0];
+    std::string output_file = (positional.size() > 1) ? positional[1] : "output.bin"; // Default output
+    if (!outputOption.empty()) output_file = outputOption;
+    simOptions.threads = threads ? threads : 1;
+    asmOptions.threads = threads;
 
     std::ifstream stream(input_file);
     if (!stream.good()) {
@@ -27,26 +157,56 @@ int main(int argc, char* argv[]) {
     }
 
     if (mode == "assemble") {
-        std::cout << "Assembling '" << input_file << "'...\n";
-        // For now, just validate using coasm_infra's parser
-        OpuAssembler assembler(input_file, output_file);
+        std::clog << "Assembling '" << input_file << "'...\n";
+        OpuAssembler assembler(input_file, output_file, asmOptions);
         if (assembler.assemble()) {
-            std::cout << "Assembly successful. Output written to '" << output_file << "'.\n";
+            std::clog << "Assembly successful. Output written to '" << output_file << "'.\n";
         } else {
             std::cerr << "Assembly failed.\n";
             return 1;
         }
     } else if (mode == "disassemble") {
-        std::cout << "Disassembling '" << input_file << "'...\n";
-        OpuDisassembler disassembler(input_file, output_file);
+        std::clog << "Disassembling '" << input_file << "'...\n";
+        OpuDisassembler disassembler(input_file, output_file, disOptions);
         if (disassembler.disassemble()) {
-            std::cout << "Disassembly successful. Output written to '" << output_file << "'.\n";
+            std::clog << "Disassembly successful. Output written to '" << output_file << "'.\n";
         } else {
             std::cerr << "Disassembly failed.\n";
             return 1;
         }
+    } else if (mode == "simulate") {
+        std::clog << "Simulating '" << input_file << "'...\n";
+        OpuSimulator simulator(input_file, positional.size() > 1 ? positional[1] : "", simOptions);
+        if (simulator.simulate()) {
+            std::clog << "Simulation successful.\n";
+        } else {
+            std::cerr << "Simulation failed.\n";
+            return 1;
+        }
+    } else if (mode == "link") {
+        const std::string linkOutput = outputOption.empty() ? "output.bin" : outputOption;
+        OpuLinker linker(positional, linkOutput, threads, asmOptions.deduplicate);
+        if (linker.link()) {
+            std::clog << "Link successful. Output written to '" << linkOutput << "'.\n";
+        } else {
+            std::cerr << "Link failed.\n";
+            return 1;
+        }
+    } else if (mode == "patch") {
+        if (positional.size() < 2) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        OpuPatcher patcher(input_file, positional[1], simOptions.kernelName);
+        if (patcher.patch()) {
+            std::clog << "Patch successful. '" << input_file << "' updated.\n";
+        } else {
+            std::cerr << "Patch failed.\n";
+            return 1;
+        }
     } else {
-        std::cerr << "Error: Unknown mode '" << mode << "'. Use 'assemble' or 'disassemble'.\n";
+        std::cerr << "Error: Unknown mode '" << mode
+                  << "'. Use 'assemble', 'disassemble', 'simulate', 'link' or 'patch'.\n";
         return 1;
     }
 
@@ -0,0 +1,163 @@
+// opuas/src/sim/ExecutionProfile.cpp
+#include "ExecutionProfile.h"
+#include <iomanip>
+#include <sstream>
+
+namespace opuas {
+namespace sim {
+
+uint64_t KernelProfile::totalInstructions() const {
+    uint64_t total = 0;
+    for (const auto& [pc, counters] : pcs) total += counters.count;
+    return total;
+}
+
+uint64_t KernelProfile::totalLanes() const {
+    uint64_t total = 0;
+    for (const auto& [pc, counters] : pcs) total += counters.lanes;
+    return total;
+}
+
+uint64_t KernelProfile::totalStallCycles() const {
+    uint64_t total = 0;
+    for (const auto& [pc, counters] : pcs) total += counters.stallCycles;
+    return total;
+}
+
+uint64_t KernelProfile::totalWaits() const {
+    uint64_t total = 0;
+    for (const auto& [pc, counters] : pcs) total += counters.waits;
+    return total;
+}
+
+void KernelProfile::merge(const KernelProfile& other) {
+    for (const auto& [pc, counters] : other.pcs) {
+        PcCounters& into = pcs[pc];
+        into.count += counters.count;
+        into.lanes += counters.lanes;
+        into.stallCycles += counters.stallCycles;
+        into.waits += counters.waits;
+    }
+    for (const auto& [pc, counters] : other.branches) {
+        BranchCounters& into = branches[pc];
+        into.executed += counters.executed;
+        into.takenLanes += counters.takenLanes;
+        into.notTakenLanes += counters.notTakenLanes;
+        into.divergent += counters.divergent;
+    }
+    for (const auto& [label, count] : other.labels) labels[label] += count;
+    workgroups += other.workgroups;
+    waves += other.waves;
+}
+
+const KernelProfile* ExecutionProfile::findKernel(const std::string& name) const {
+    for (const KernelProfile& kernel : kernels) {
+        if (kernel.name == name) return &kernel;
+    }
+    return nullptr;
+}
+
+std::string ExecutionProfile::toText() const {
+    std::ostringstream out;
+    out << "# opuas profile v1\n";
+    for (const KernelProfile& kernel : kernels) {
+        uint64_t divergent = 0;
+        for (const auto& [pc, counters] : kernel.branches) divergent += counters.divergent;
+        out << "kernel " << kernel.name << "\n";
+        out << "summary workgroups " << kernel.workgroups << " waves " << kernel.waves
+            << " instructions " << kernel.totalInstructions() << " lanes " << kernel.totalLanes()
+            << " stall_cycles " << kernel.totalStallCycles() << " waits " << kernel.totalWaits()
+            << " divergent_branches " << divergent << "\n";
+        for (const auto& [pc, counters] : kernel.pcs) {
+            out << "pc 0x" << std::hex << std::setw(4) << std::setfill('0') << pc << std::dec << std::setfill(' ')
+                << " " << counters.count << " lanes " << counters.lanes << " stall " << counters.stallCycles
+                << " wait " << counters.waits << "\n";
+        }
+        for (const auto& [pc, counters] : kernel.branches) {
+            out << "branch 0x" << std::hex << std::setw(4) << std::setfill('0') << pc << std::dec << std::setfill(' ')
+                << " executed " << counters.executed << " taken " << counters.takenLanes
+                << " not_taken " << counters.notTakenLanes << " divergent " << counters.divergent << "\n";
+        }
+        for (const auto& [label, count] : kernel.labels) out << "label " << label << " " << count << "\n";
+    }
+    return out.str();
+}
+
+bool ExecutionProfile::parse(const std::string& text, ExecutionProfile& profile, std::string& errorMessage) {
+    profile = ExecutionProfile();
+    std::istringstream lines(text);
+    std::string line;
+    int lineNo = 0;
+    auto fail = [&](const std::string& message) {
+        errorMessage = "line " + std::to_string(lineNo) + ": " + message;
+        return false;
+    };
+    auto number = [](const std::string& word, uint64_t& value) {
+        if (word.empty() || word[0] == '-') return false;
+        try {
+            size_t used = 0;
+            value = std::stoull(word, &used, 0);
+            return used == word.size();
+        } catch (const std::exception&) {
+            return false;
+        }
+    };
+
+    while (std::getline(lines, line)) {
+        ++lineNo;
+        std::istringstream words(line);
+        std::string record;
+        if (!(words >> record) || record[0] == '#') continue;
+
+        if (record == "kernel") {
+            KernelProfile kernel;
+            if (!(words >> kernel.name)) return fail("'kernel' needs a name");
+            profile.kernels.push_back(kernel);
+            continue;
+        }
+        if (record != "pc" && record != "label" && record != "branch") continue;
+        if (profile.kernels.empty()) return fail("'" + record + "' before any 'kernel' line");
+        KernelProfile& kernel = profile.kernels.back();
+
+        std::string key, countText;
+        uint64_t pc = 0, count = 0;
+        if (!(words >> key)) return fail("'" + record + "' needs a " + (record == "label" ? "label" : "pc"));
+        if (record != "label" && (!number(key, pc) || pc > UINT32_MAX)) return fail("invalid pc '" + key + "'");
+
+        if (record == "branch") {
+            // branch PC key value [key value ...]
+            BranchCounters& branch = kernel.branches[static_cast<uint32_t>(pc)];
+            std::string field, valueText;
+            while (words >> field >> valueText) {
+                uint64_t value = 0;
+                if (!number(valueText, value)) return fail("invalid value '" + valueText + "' for '" + field + "'");
+                if (field == "executed") branch.executed += value;
+                else if (field == "taken") branch.takenLanes += value;
+                else if (field == "not_taken") branch.notTakenLanes += value;
+                else if (field == "divergent") branch.divergent += value;
+            }
+            continue;
+        }
+
+        if (!(words >> countText) || !number(countText, count)) return fail("'" + record + "' needs a count");
+        if (record == "label") {
+            kernel.labels[key] += count;
+            continue;
+        }
+        // pc PC COUNT [key value ...]
+        PcCounters& counters = kernel.pcs[static_cast<uint32_t>(pc)];
+        counters.count += count;
+        std::string field, valueText;
+        while (words >> field >> valueText) {
+            uint64_t value = 0;
+            if (!number(valueText, value)) return fail("invalid value '" + valueText + "' for '" + field + "'");
+            if (field == "lanes") counters.lanes += value;
+            else if (field == "stall") counters.stallCycles += value;
+            else if (field == "wait") counters.waits += value;
+        }
+    }
+    return true;
+}
+
+} // namespace sim
+} // namespace opuas
@@ -0,0 +1,63 @@
+// opuas/src/sim/ExecutionProfile.h
+#ifndef EXECUTION_PROFILE_H
+#define EXECUTION_PROFILE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace opuas {
+namespace sim {
+
+struct PcCounters {
+    uint64_t count = 0;        // Wave-level issues
+    uint64_t lanes = 0;        // Active lanes summed over those issues
+    uint64_t stallCycles = 0;  // Encoded stall field times issues
+    uint64_t waits = 0;        // Issues that waited on the memory scoreboard
+};
+
+struct BranchCounters {
+    uint64_t executed = 0;
+    uint64_t takenLanes = 0;
+    uint64_t notTakenLanes = 0;
+    uint64_t divergent = 0;    // Issues where the wave split both ways
+};
+
+// Dynamic counters for one kernel, keyed by byte offset (PC) in its code.
+struct KernelProfile {
+    std::string name;
+    std::map<uint32_t, PcCounters> pcs;
+    std::map<uint32_t, BranchCounters> branches;
+    std::map<std::string, uint64_t> labels;   // Counts keyed by label instead of PC
+    uint64_t workgroups = 0;
+    uint64_t waves = 0;
+
+    uint64_t totalInstructions() const;
+    uint64_t totalLanes() const;
+    uint64_t totalStallCycles() const;
+    uint64_t totalWaits() const;
+    void merge(const KernelProfile& other);
+};
+
+// Text form, one record per line:
+//   # opuas profile v1
+//   kernel NAME
+//   summary workgroups N waves N instructions N lanes N stall_cycles N waits N divergent_branches N
+//   pc 0xOFFSET COUNT lanes N stall N wait N
+//   branch 0xOFFSET executed N taken N not_taken N divergent N
+//   label NAME COUNT
+// Hand-written or hardware-counter profiles may use only "pc" or "label"
+// lines; trailing fields and unknown records are ignored when parsing.
+struct ExecutionProfile {
+    std::vector<KernelProfile> kernels;
+
+    const KernelProfile* findKernel(const std::string& name) const;
+    std::string toText() const;
+    static bool parse(const std::string& text, ExecutionProfile& profile, std::string& errorMessage);
+};
+
+} // namespace sim
+} // namespace opuas
+
+#endif // EXECUTION_PROFILE_H
@@ -0,0 +1,969 @@
+// opuas/src/sim/Simulator.cpp
+#include "Simulator.h"
+#include "ElfFormat.h"
+#include "OpuEncoding.h"
+#include "OpuIsa.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+namespace opuas {
+namespace sim {
+
+namespace {
+
+constexpr int kWaveSize = 32;
+constexpr int kNumRegs = 64;  // Width of the register index field
+using LaneMask = uint32_t;
+
+static_assert(sizeof(LaneMask) * 8 == kWaveSize, "one predicate bit per lane");
+
+int popcount(LaneMask mask) {
+    return static_cast<int>(std::bitset<kWaveSize>(mask).count());
+}
+
+std::string hexOffset(uint64_t value) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "0x%04llx", static_cast<unsigned long long>(value));
+    return buf;
+}
+
+} // namespace
+
+// Register state is stored lane-minor (one array of 32 lanes per register) so
+// every handler works on whole rows and the lane loops vectorize.
+struct WaveState {
+    alignas(64) uint32_t v[kNumRegs + 1][kWaveSize];  // Extra row: %vd63 reads %v64
+    uint32_t s[kNumRegs + 1];
+    LaneMask p[kNumRegs];
+    uint32_t pc[kWaveSize];                           // Per-lane instruction index
+    uint32_t tid[3][kWaveSize];
+    LaneMask live = 0;                                // Lanes that have not exited
+    LaneMask exec = 0;                                // Lanes issuing the current instruction
+    bool atBarrier = false;
+    uint64_t issued = 0;
+    std::vector<uint8_t> privateMemory;               // privateSize bytes per lane
+};
+
+struct WorkgroupState {
+    const LaunchConfig* config = nullptr;
+    uint32_t ctaid[3] = {0, 0, 0};
+    std::vector<uint8_t> params;
+    std::vector<uint8_t>* global = nullptr;
+    std::vector<uint8_t> shared;
+    uint32_t privateSize = 0;
+    std::string* error = nullptr;
+};
+
+struct ExecContext {
+    WaveState& wave;
+    WorkgroupState& group;
+    LaneMask taken = 0;   // Set by branch handlers
+};
+
+namespace {
+
+// --- Lane Values ---
+
+template <typename T>
+constexpr bool kIsFloat = std::is_floating_point_v<T>;
+
+// Integer arithmetic wraps; 16-bit values are widened so that the promotion
+// to int cannot overflow.
+template <typename T>
+using Arith = std::conditional_t<(sizeof(T) < 4), uint32_t, std::make_unsigned_t<T>>;
+
+template <typename T>
+T fromBits(uint64_t bits) {
+    if constexpr (std::is_same_v<T, float>) {
+        uint32_t word = static_cast<uint32_t>(bits);
+        float value;
+        memcpy(&value, &word, sizeof(value));
+        return value;
+    } else if constexpr (std::is_same_v<T, double>) {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    } else {
+        return static_cast<T>(bits);
+    }
+}
+
+template <typename T>
+uint64_t toBits(T value) {
+    if constexpr (std::is_same_v<T, float>) {
+        uint32_t word;
+        memcpy(&word, &value, sizeof(word));
+        return word;
+    } else if constexpr (std::is_same_v<T, double>) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    } else {
+        return static_cast<std::make_unsigned_t<T>>(value);
+    }
+}
+
+// Immediates are at most 32 bits; float immediates are f32 bit patterns.
+template <typename T>
+T immValue(int64_t imm) {
+    if constexpr (std::is_same_v<T, double>) {
+        return static_cast<double>(fromBits<float>(static_cast<uint64_t>(imm)));
+    } else if constexpr (std::is_signed_v<T> && sizeof(T) == 8) {
+        return static_cast<int32_t>(static_cast<uint32_t>(imm));
+    } else {
+        return fromBits<T>(static_cast<uint64_t>(imm));
+    }
+}
+
+uint32_t specialValue(const ExecContext& ctx, int id, int lane) {
+    const LaunchConfig& config = *ctx.group.config;
+    const uint32_t ntid[3] = {config.block.x, config.block.y, config.block.z};
+    const uint32_t nctaid[3] = {config.grid.x, config.grid.y, config.grid.z};
+    if (id < 3) return ctx.wave.tid[id][lane];
+    if (id < 6) return ntid[id - 3];
+    if (id < 9) return ctx.group.ctaid[id - 6];
+    if (id < 12) return nctaid[id - 9];
+    return static_cast<uint32_t>(lane); // %laneid
+}
+
+template <typename T>
+void fetch(const ExecContext& ctx, const SimOperand& op, T (&out)[kWaveSize]) {
+    const WaveState& wave = ctx.wave;
+    switch (op.kind) {
+        case OperandKind::VReg:
+        case OperandKind::VReg64:
+            if constexpr (sizeof(T) == 8) {
+                for (int l = 0; l < kWaveSize; ++l) {
+                    out[l] = fromBits<T>(wave.v[op.reg][l] | static_cast<uint64_t>(wave.v[op.reg + 1][l]) << 32);
+                }
+            } else {
+                for (int l = 0; l < kWaveSize; ++l) out[l] = fromBits<T>(wave.v[op.reg][l]);
+            }
+            return;
+        case OperandKind::SReg: {
+            uint64_t bits = wave.s[op.reg];
+            if (sizeof(T) == 8) bits |= static_cast<uint64_t>(wave.s[op.reg + 1]) << 32;
+            std::fill(out, out + kWaveSize, fromBits<T>(bits));
+            return;
+        }
+        case OperandKind::PReg:
+            for (int l = 0; l < kWaveSize; ++l) out[l] = static_cast<T>((wave.p[op.reg] >> l) & 1);
+            return;
+        case OperandKind::Special:
+            for (int l = 0; l < kWaveSize; ++l) out[l] = static_cast<T>(specialValue(ctx, op.reg, l));
+            return;
+        case OperandKind::Imm:
+            std::fill(out, out + kWaveSize, immValue<T>(op.imm));
+            return;
+        default:
+            std::fill(out, out + kWaveSize, T());
+            return;
+    }
+}
+
+// Addresses: %vd operands are 64-bit, everything else is a 32-bit value;
+// immediate offsets are sign-extended.
+void fetchAddress(const ExecContext& ctx, const SimOperand& op, uint64_t (&out)[kWaveSize]) {
+    if (op.kind == OperandKind::VReg64) {
+        fetch<uint64_t>(ctx, op, out);
+    } else if (op.kind == OperandKind::Imm) {
+        std::fill(out, out + kWaveSize, static_cast<uint64_t>(immValue<int64_t>(op.imm)));
+    } else {
+        uint32_t words[kWaveSize];
+        fetch<uint32_t>(ctx, op, words);
+        for (int l = 0; l < kWaveSize; ++l) out[l] = words[l];
+    }
+}
+
+template <typename T>
+void store(ExecContext& ctx, const SimOperand& op, const T (&values)[kWaveSize]) {
+    WaveState& wave = ctx.wave;
+    const LaneMask exec = wave.exec;
+    switch (op.kind) {
+        case OperandKind::VReg:
+        case OperandKind::VReg64:
+            for (int l = 0; l < kWaveSize; ++l) {
+                const bool active = (exec >> l) & 1;
+                const uint64_t bits = toBits(values[l]);
+                wave.v[op.reg][l] = active ? static_cast<uint32_t>(bits) : wave.v[op.reg][l];
+                if constexpr (sizeof(T) == 8) {
+                    wave.v[op.reg + 1][l] = active ? static_cast<uint32_t>(bits >> 32) : wave.v[op.reg + 1][l];
+                }
+            }
+            return;
+        case OperandKind::SReg: {
+            // Scalar destinations take the value of the first active lane.
+            int lane = 0;
+            while (lane < kWaveSize - 1 && !((exec >> lane) & 1)) ++lane;
+            const uint64_t bits = toBits(values[lane]);
+            wave.s[op.reg] = static_cast<uint32_t>(bits);
+            if constexpr (sizeof(T) == 8) wave.s[op.reg + 1] = static_cast<uint32_t>(bits >> 32);
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+void fault(ExecContext& ctx, const DecodedOp& op, const std::string& message) {
+    if (ctx.group.error->empty()) *ctx.group.error = hexOffset(op.pc) + ": " + message;
+    ctx.wave.live = 0;
+}
+
+// --- ALU Operations ---
+// Each operation says which element types it accepts; handler selection
+// rejects the rest at load time.
+
+struct AddOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a, T b) {
+        if constexpr (kIsFloat<T>) return a + b;
+        else return static_cast<T>(static_cast<Arith<T>>(a) + static_cast<Arith<T>>(b));
+    }
+};
+
+struct SubOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a, T b) {
+        if constexpr (kIsFloat<T>) return a - b;
+        else return static_cast<T>(static_cast<Arith<T>>(a) - static_cast<Arith<T>>(b));
+    }
+};
+
+struct MulLoOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a, T b) {
+        if constexpr (kIsFloat<T>) return a * b;
+        else return static_cast<T>(static_cast<Arith<T>>(a) * static_cast<Arith<T>>(b));
+    }
+};
+
+struct MulHiOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) {
+        constexpr int bits = sizeof(T) * 8;
+        if constexpr (sizeof(T) == 8) {
+            using Wide = std::conditional_t<std::is_signed_v<T>, __int128, unsigned __int128>;
+            return static_cast<T>((static_cast<Wide>(a) * static_cast<Wide>(b)) >> bits);
+        } else {
+            using Wide = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+            return static_cast<T>((static_cast<Wide>(a) * static_cast<Wide>(b)) >> bits);
+        }
+    }
+};
+
+struct MinOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a, T b) {
+        if constexpr (kIsFloat<T>) return std::fmin(a, b);
+        else return std::min(a, b);
+    }
+};
+
+struct MaxOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a, T b) {
+        if constexpr (kIsFloat<T>) return std::fmax(a, b);
+        else return std::max(a, b);
+    }
+};
+
+struct AndOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) { return static_cast<T>(a & b); }
+};
+
+struct OrOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) { return static_cast<T>(a | b); }
+};
+
+struct XorOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) { return static_cast<T>(a ^ b); }
+};
+
+struct ShlOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) {
+        const Arith<T> shift = static_cast<Arith<T>>(b);
+        if (shift >= sizeof(T) * 8) return 0;
+        return static_cast<T>(static_cast<Arith<T>>(a) << shift);
+    }
+};
+
+struct ShrOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a, T b) {
+        const Arith<T> shift = static_cast<Arith<T>>(b);
+        if (shift >= sizeof(T) * 8) return (std::is_signed_v<T> && a < 0) ? static_cast<T>(-1) : 0;
+        return static_cast<T>(a >> shift); // Arithmetic for signed types
+    }
+};
+
+struct MovOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a) { return a; }
+};
+
+struct NotOp {
+    static constexpr bool kInteger = true, kFloat = false;
+    template <typename T> static T apply(T a) { return static_cast<T>(~a); }
+};
+
+struct NegOp {
+    static constexpr bool kInteger = true, kFloat = true;
+    template <typename T> static T apply(T a) {
+        if constexpr (kIsFloat<T>) return -a;
+        else return static_cast<T>(Arith<T>(0) - static_cast<Arith<T>>(a));
+    }
+};
+
+struct RcpOp {
+    static constexpr bool kInteger = false, kFloat = true;
+    template <typename T> static T apply(T a) { return T(1) / a; }
+};
+
+struct SqrtOp {
+    static constexpr bool kInteger = false, kFloat = true;
+    template <typename T> static T apply(T a) { return std::sqrt(a); }
+};
+
+template <typename T> struct Wider;
+template <> struct Wider<uint16_t> { using type = uint32_t; };
+template <> struct Wider<int16_t> { using type = int32_t; };
+template <> struct Wider<uint32_t> { using type = uint64_t; };
+template <> struct Wider<int32_t> { using type = int64_t; };
+
+template <typename D, typename S>
+D convert(S value) {
+    if constexpr (kIsFloat<S> && !kIsFloat<D>) {
+        // Saturate like the hardware instead of relying on undefined casts.
+        if (std::isnan(value)) return 0;
+        if (value <= static_cast<S>(std::numeric_limits<D>::min())) return std::numeric_limits<D>::min();
+        if (value >= static_cast<S>(std::numeric_limits<D>::max())) return std::numeric_limits<D>::max();
+    }
+    return static_cast<D>(value);
+}
+
+// --- Handlers ---
+
+template <typename T, typename Op>
+void unaryHandler(ExecContext& ctx, const DecodedOp& op) {
+    T a[kWaveSize], r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = Op::apply(a[l]);
+    store(ctx, op.dst, r);
+}
+
+template <typename T, typename Op>
+void binaryHandler(ExecContext& ctx, const DecodedOp& op) {
+    T a[kWaveSize], b[kWaveSize], r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = Op::apply(a[l], b[l]);
+    store(ctx, op.dst, r);
+}
+
+// mad: a * b + c, with the multiply in the given mode.
+template <typename T, typename Op>
+void madHandler(ExecContext& ctx, const DecodedOp& op) {
+    T a[kWaveSize], b[kWaveSize], c[kWaveSize], r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    fetch(ctx, op.src[2], c);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = AddOp::apply(Op::apply(a[l], b[l]), c[l]);
+    store(ctx, op.dst, r);
+}
+
+template <typename T>
+void mulWideHandler(ExecContext& ctx, const DecodedOp& op) {
+    using W = typename Wider<T>::type;
+    T a[kWaveSize], b[kWaveSize];
+    W r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = MulLoOp::apply<W>(a[l], b[l]);
+    store(ctx, op.dst, r);
+}
+
+template <typename T>
+void madWideHandler(ExecContext& ctx, const DecodedOp& op) {
+    using W = typename Wider<T>::type;
+    T a[kWaveSize], b[kWaveSize];
+    W c[kWaveSize], r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    fetch(ctx, op.src[2], c);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = AddOp::apply<W>(MulLoOp::apply<W>(a[l], b[l]), c[l]);
+    store(ctx, op.dst, r);
+}
+
+template <typename D, typename S>
+void cvtHandler(ExecContext& ctx, const DecodedOp& op) {
+    S a[kWaveSize];
+    D r[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = convert<D>(a[l]);
+    store(ctx, op.dst, r);
+}
+
+// selp d, a, b, c: d = c ? a : b
+template <typename T>
+void selpHandler(ExecContext& ctx, const DecodedOp& op) {
+    T a[kWaveSize], b[kWaveSize], r[kWaveSize];
+    uint32_t c[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    fetch(ctx, op.src[2], c);
+    for (int l = 0; l < kWaveSize; ++l) r[l] = c[l] ? a[l] : b[l];
+    store(ctx, op.dst, r);
+}
+
+template <typename T, typename Compare>
+LaneMask compareLanes(const T (&a)[kWaveSize], const T (&b)[kWaveSize], Compare compare) {
+    LaneMask mask = 0;
+    for (int l = 0; l < kWaveSize; ++l) mask |= static_cast<LaneMask>(compare(a[l], b[l])) << l;
+    return mask;
+}
+
+template <typename T>
+void setTccHandler(ExecContext& ctx, const DecodedOp& op) {
+    T a[kWaveSize], b[kWaveSize];
+    fetch(ctx, op.src[0], a);
+    fetch(ctx, op.src[1], b);
+    LaneMask mask = 0;
+    switch (op.modifier) {
+        case isa::CmpEq: mask = compareLanes(a, b, [](T x, T y) { return x == y; }); break;
+        case isa::CmpNe: mask = compareLanes(a, b, [](T x, T y) { return x != y; }); break;
+        case isa::CmpLt: mask = compareLanes(a, b, [](T x, T y) { return x < y; }); break;
+        case isa::CmpLe: mask = compareLanes(a, b, [](T x, T y) { return x <= y; }); break;
+        case isa::CmpGt: mask = compareLanes(a, b, [](T x, T y) { return x > y; }); break;
+        case isa::CmpGe: mask = compareLanes(a, b, [](T x, T y) { return x >= y; }); break;
+    }
+    LaneMask& pred = ctx.wave.p[op.dst.reg];
+    pred = (pred & ~ctx.wave.exec) | (mask & ctx.wave.exec);
+}
+
+// Resolve `size` bytes at `address` in an address space for one lane, or
+// report a fault and return nullptr.
+uint8_t* resolveAddress(ExecContext& ctx, const DecodedOp& op, bool write, uint64_t address, size_t size, int lane) {
+    std::vector<uint8_t>* buffer = nullptr;
+    uint64_t base = 0;
+    uint64_t limit = 0;
+    const char* spaceName = "global";
+    switch (op.modifier) {
+        case isa::SpaceParam:
+            buffer = &ctx.group.params;
+            spaceName = "param";
+            if (write) {
+                fault(ctx, op, "store to param space");
+                return nullptr;
+            }
+            break;
+        case isa::SpaceShared:
+            buffer = &ctx.group.shared;
+            spaceName = "shared";
+            break;
+        case isa::SpaceLocal:
+            buffer = &ctx.wave.privateMemory;
+            base = static_cast<uint64_t>(lane) * ctx.group.privateSize;
+            limit = ctx.group.privateSize;
+            spaceName = "local";
+            break;
+        case isa::SpaceConst:
+            spaceName = "const";
+            buffer = ctx.group.global;
+            break;
+        default:
+            buffer = ctx.group.global;
+            break;
+    }
+    if (op.modifier != isa::SpaceLocal) limit = buffer->size();
+    if (address > limit || size > limit - address) {
+        fault(ctx, op, std::string(spaceName) + (write ? " store" : " load") + " of " + std::to_string(size) +
+                           " bytes at " + hexOffset(address) + " is outside the " + std::to_string(limit) +
+                           "-byte " + spaceName + " memory");
+        return nullptr;
+    }
+    return buffer->data() + base + address;
+}
+
+template <typename T>
+void loadHandler(ExecContext& ctx, const DecodedOp& op) {
+    uint64_t base[kWaveSize], offset[kWaveSize];
+    T r[kWaveSize] = {};
+    fetchAddress(ctx, op.src[0], base);
+    fetchAddress(ctx, op.src[1], offset);
+    for (int l = 0; l < kWaveSize; ++l) {
+        if (!((ctx.wave.exec >> l) & 1)) continue;
+        const uint8_t* data = resolveAddress(ctx, op, false, base[l] + offset[l], sizeof(T), l);
+        if (!data) return;
+        memcpy(&r[l], data, sizeof(T));
+    }
+    store(ctx, op.dst, r);
+}
+
+template <typename T>
+void storeHandler(ExecContext& ctx, const DecodedOp& op) {
+    uint64_t base[kWaveSize], offset[kWaveSize];
+    T value[kWaveSize];
+    fetchAddress(ctx, op.src[0], base);
+    fetchAddress(ctx, op.src[1], offset);
+    fetch(ctx, op.src[2], value);
+    for (int l = 0; l < kWaveSize; ++l) {
+        if (!((ctx.wave.exec >> l) & 1)) continue;
+        uint8_t* data = resolveAddress(ctx, op, true, base[l] + offset[l], sizeof(T), l);
+        if (!data) return;
+        memcpy(data, &value[l], sizeof(T));
+    }
+}
+
+void branchHandler(ExecContext& ctx, const DecodedOp& op) {
+    for (int l = 0; l < kWaveSize; ++l) {
+        if ((ctx.wave.exec >> l) & 1) ctx.wave.pc[l] = op.target;
+    }
+    ctx.taken = ctx.wave.exec;
+}
+
+template <bool kOnSet>
+void condBranchHandler(ExecContext& ctx, const DecodedOp& op) {
+    const LaneMask pred = ctx.wave.p[op.src[0].reg];
+    const LaneMask taken = ctx.wave.exec & (kOnSet ? pred : ~pred);
+    for (int l = 0; l < kWaveSize; ++l) {
+        if ((taken >> l) & 1) ctx.wave.pc[l] = op.target;
+    }
+    ctx.taken = taken;
+}
+
+void barrierHandler(ExecContext& ctx, const DecodedOp&) {
+    ctx.wave.atBarrier = true;
+}
+
+void nopHandler(ExecContext&, const DecodedOp&) {}
+
+void exitHandler(ExecContext& ctx, const DecodedOp&) {
+    ctx.wave.live &= ~ctx.wave.exec;
+}
+
+// --- Handler Selection ---
+
+template <typename T> struct TypeTag { using type = T; };
+
+// Call `select` with the host type for a data type. F16 has no host type.
+template <typename F>
+OpHandler forType(isa::DataType type, F select) {
+    switch (type) {
+        case isa::DataType::B32:
+        case isa::DataType::U32: return select(TypeTag<uint32_t>());
+        case isa::DataType::S32: return select(TypeTag<int32_t>());
+        case isa::DataType::B64:
+        case isa::DataType::U64: return select(TypeTag<uint64_t>());
+        case isa::DataType::S64: return select(TypeTag<int64_t>());
+        case isa::DataType::U16: return select(TypeTag<uint16_t>());
+        case isa::DataType::S16: return select(TypeTag<int16_t>());
+        case isa::DataType::F32: return select(TypeTag<float>());
+        case isa::DataType::F64: return select(TypeTag<double>());
+        default: return nullptr;
+    }
+}
+
+template <typename T, typename Op>
+constexpr bool supports() {
+    return kIsFloat<T> ? Op::kFloat : Op::kInteger;
+}
+
+template <typename Op>
+OpHandler selectUnary(isa::DataType type) {
+    return forType(type, [](auto tag) -> OpHandler {
+        using T = typename decltype(tag)::type;
+        if constexpr (supports<T, Op>()) return &unaryHandler<T, Op>;
+        else return nullptr;
+    });
+}
+
+template <typename Op>
+OpHandler selectBinary(isa::DataType type) {
+    return forType(type, [](auto tag) -> OpHandler {
+        using T = typename decltype(tag)::type;
+        if constexpr (supports<T, Op>()) return &binaryHandler<T, Op>;
+        else return nullptr;
+    });
+}
+
+template <typename Op>
+OpHandler selectMad(isa::DataType type) {
+    return forType(type, [](auto tag) -> OpHandler {
+        using T = typename decltype(tag)::type;
+        if constexpr (supports<T, Op>()) return &madHandler<T, Op>;
+        else return nullptr;
+    });
+}
+
+template <bool kMad>
+OpHandler selectWide(isa::DataType type) {
+    return forType(type, [](auto tag) -> OpHandler {
+        using T = typename decltype(tag)::type;
+        if constexpr (!kIsFloat<T> && sizeof(T) <= 4) return kMad ? &madWideHandler<T> : &mulWideHandler<T>;
+        else return nullptr;
+    });
+}
+
+OpHandler selectHandler(const Instruction& inst) {
+    using isa::Opcode;
+    const isa::DataType type = inst.type;
+    switch (inst.opcode) {
+        case Opcode::Mov:  return selectUnary<MovOp>(type);
+        case Opcode::Add:  return selectBinary<AddOp>(type);
+        case Opcode::Sub:  return selectBinary<SubOp>(type);
+        case Opcode::Mul:
+            if (inst.modifier == isa::MulWide) return selectWide<false>(type);
+            if (inst.modifier == isa::MulHi) return selectBinary<MulHiOp>(type);
+            return selectBinary<MulLoOp>(type);
+        case Opcode::Mad:
+            if (inst.modifier == isa::MulWide) return selectWide<true>(type);
+            if (inst.modifier == isa::MulHi) return selectMad<MulHiOp>(type);
+            return selectMad<MulLoOp>(type);
+        case Opcode::Min:  return selectBinary<MinOp>(type);
+        case Opcode::Max:  return selectBinary<MaxOp>(type);
+        case Opcode::And:  return selectBinary<AndOp>(type);
+        case Opcode::Or:   return selectBinary<OrOp>(type);
+        case Opcode::Xor:  return selectBinary<XorOp>(type);
+        case Opcode::Not:  return selectUnary<NotOp>(type);
+        case Opcode::Neg:  return selectUnary<NegOp>(type);
+        case Opcode::Shl:  return selectBinary<ShlOp>(type);
+        case Opcode::Shr:  return selectBinary<ShrOp>(type);
+        case Opcode::Rcp:  return selectUnary<RcpOp>(type);
+        case Opcode::Sqrt: return selectUnary<SqrtOp>(type);
+        case Opcode::Cvt: {
+            // cvt.<dst>.<src>; without a source type it is a plain move.
+            const isa::DataType srcType = inst.modifier ? static_cast<isa::DataType>(inst.modifier) : type;
+            return forType(type, [srcType](auto dstTag) -> OpHandler {
+                using D = typename decltype(dstTag)::type;
+                return forType(srcType, [](auto srcTag) -> OpHandler {
+                    using S = typename decltype(srcTag)::type;
+                    return &cvtHandler<D, S>;
+                });
+            });
+        }
+        case Opcode::Selp:
+            return forType(type, [](auto tag) -> OpHandler { return &selpHandler<typename decltype(tag)::type>; });
+        case Opcode::SetTcc:
+            return forType(type, [](auto tag) -> OpHandler { return &setTccHandler<typename decltype(tag)::type>; });
+        case Opcode::Ld:
+            return forType(type, [](auto tag) -> OpHandler { return &loadHandler<typename decltype(tag)::type>; });
+        case Opcode::St:
+            return forType(type, [](auto tag) -> OpHandler { return &storeHandler<typename decltype(tag)::type>; });
+        case Opcode::Barrier:     return &barrierHandler;
+        case Opcode::Nop:         return &nopHandler;
+        case Opcode::Branch:      return &branchHandler;
+        case Opcode::BranchTccnz: return &condBranchHandler<true>;
+        case Opcode::BranchTccz:  return &condBranchHandler<false>;
+        case Opcode::Exit:        return &exitHandler;
+        default:                  return nullptr;
+    }
+}
+
+SimOperand toSimOperand(const Operand& operand) {
+    SimOperand op;
+    op.kind = operand.kind;
+    op.reg = static_cast<uint8_t>(operand.reg);
+    op.imm = operand.imm;
+    return op;
+}
+
+// Issue instructions for one wave until it exits, reaches a barrier or faults.
+void runWave(const std::vector<DecodedOp>& ops, ExecContext& ctx, uint64_t instructionLimit,
+             std::vector<PcCounters>& pcCounters, std::vector<BranchCounters>& branchCounters) {
+    WaveState& wave = ctx.wave;
+    while (wave.live && !wave.atBarrier) {
+        uint32_t index = UINT32_MAX;
+        for (int l = 0; l < kWaveSize; ++l) {
+            if ((wave.live >> l) & 1) index = std::min(index, wave.pc[l]);
+        }
+        if (index >= ops.size()) {
+            const uint32_t end = ops.empty() ? 0 : ops.back().pc;
+            if (ctx.group.error->empty()) *ctx.group.error = "execution ran past the last instruction at " + hexOffset(end);
+            wave.live = 0;
+            return;
+        }
+        const DecodedOp& op = ops[index];
+        if (++wave.issued > instructionLimit) {
+            fault(ctx, op, "wave exceeded " + std::to_string(instructionLimit) + " instructions");
+            return;
+        }
+
+        LaneMask exec = 0;
+        for (int l = 0; l < kWaveSize; ++l) exec |= static_cast<LaneMask>(wave.pc[l] == index) << l;
+        exec &= wave.live;
+        wave.exec = exec;
+        for (int l = 0; l < kWaveSize; ++l) {
+            if ((exec >> l) & 1) wave.pc[l] = index + 1;
+        }
+        ctx.taken = 0;
+        op.handler(ctx, op);
+
+        PcCounters& counters = pcCounters[index];
+        const int lanes = popcount(exec);
+        ++counters.count;
+        counters.lanes += lanes;
+        counters.stallCycles += op.stall;
+        counters.waits += op.wait ? 1 : 0;
+        if (op.branch) {
+            BranchCounters& branch = branchCounters[index];
+            const int taken = popcount(ctx.taken);
+            ++branch.executed;
+            branch.takenLanes += taken;
+            branch.notTakenLanes += lanes - taken;
+            if (taken != 0 && taken != lanes) ++branch.divergent;
+        }
+    }
+}
+
+} // namespace
+
+bool parseDim3(const std::string& text, Dim3& dim) {
+    uint32_t values[3] = {1, 1, 1};
+    std::istringstream in(text);
+    std::string part;
+    int count = 0;
+    while (std::getline(in, part, ',')) {
+        if (count == 3 || part.empty() || part.find_first_not_of("0123456789") != std::string::npos) return false;
+        unsigned long value = std::stoul(part);
+        if (value == 0 || value > UINT32_MAX) return false;
+        values[count++] = static_cast<uint32_t>(value);
+    }
+    if (count == 0) return false;
+    dim.x = values[0];
+    dim.y = values[1];
+    dim.z = values[2];
+    return true;
+}
+
+Simulator::Simulator(const elf::KernelCode& kernel, const std::map<std::string, uint64_t>* symbols)
+    : kernel_(kernel), symbols_(symbols) {}
+
+bool Simulator::load() {
+    ops_.clear();
+    error_.clear();
+
+    // Resolve literals against the symbols the object defines, as the
+    // linker would; the assembler leaves 0 in the word.
+    std::vector<uint32_t> code = kernel_.code;
+    for (const elf::Relocation& reloc : kernel_.relocations) {
+        if (!symbols_ || !symbols_->count(reloc.symbol)) {
+            error_ = "kernel '" + kernel_.name + "' references unresolved symbol '" + reloc.symbol + "'";
+            return false;
+        }
+        const size_t word = reloc.offset / sizeof(uint32_t);
+        if (reloc.type != R_OPU_ABS32 || reloc.offset % sizeof(uint32_t) != 0 || word >= code.size()) {
+            error_ = "kernel '" + kernel_.name + "' at " + hexOffset(reloc.offset) + ": unsupported relocation";
+            return false;
+        }
+        code[word] = static_cast<uint32_t>(symbols_->at(reloc.symbol) + reloc.addend);
+    }
+
+    std::map<uint32_t, uint32_t> indexOfOffset;
+    size_t pos = 0;
+    while (pos < code.size()) {
+        isa::DecodedInstruction decoded;
+        std::string message;
+        const uint32_t offset = static_cast<uint32_t>(pos * sizeof(uint32_t));
+        if (!isa::decodeInstruction(code.data() + pos, code.size() - pos, decoded, message)) {
+            error_ = "kernel '" + kernel_.name + "' at " + hexOffset(offset) + ": " + message;
+            return false;
+        }
+        const Instruction& inst = decoded.inst;
+        const std::pmr::vector<Operand>& operands = inst.operands;
+
+        DecodedOp op;
+        op.pc = offset;
+        op.modifier = inst.modifier;
+        op.stall = static_cast<uint8_t>(inst.stall);
+        op.wait = inst.wait;
+        op.branch = inst.isBranch();
+        op.handler = selectHandler(inst);
+        if (!op.handler) {
+            error_ = "kernel '" + kernel_.name + "' at " + hexOffset(offset) + ": '" +
+                     isa::formatMnemonic(inst.opcode, inst.type, inst.modifier) + "' is not supported by the simulator";
+            return false;
+        }
+
+        const isa::Format format = inst.info().format;
+        size_t first = 0;
+        if (isa::formatHasDestination(format) && !operands.empty()) {
+            op.dst = toSimOperand(operands[0]);
+            first = 1;
+        }
+        if (op.branch) {
+            op.target = static_cast<uint32_t>(operands.back().imm); // Byte offset until resolved below
+            if (format == isa::Format::SCBRANCH) op.src[0] = toSimOperand(operands[0]);
+        } else {
+            for (size_t i = first; i < operands.size() && i - first < 3; ++i) {
+                op.src[i - first] = toSimOperand(operands[i]);
+            }
+        }
+
+        indexOfOffset[offset] = static_cast<uint32_t>(ops_.size());
+        ops_.push_back(op);
+        pos += decoded.words;
+    }
+
+    for (DecodedOp& op : ops_) {
+        if (!op.branch) continue;
+        auto index = indexOfOffset.find(op.target);
+        if (index == indexOfOffset.end()) {
+            error_ = "kernel '" + kernel_.name + "' at " + hexOffset(op.pc) + ": branch target " +
+                     hexOffset(op.target) + " is not an instruction boundary";
+            return false;
+        }
+        op.target = index->second;
+    }
+    return true;
+}
+
+bool Simulator::run(const LaunchConfig& config, std::vector<uint8_t>& memory, KernelProfile& profile) {
+    error_.clear();
+    if (ops_.empty()) {
+        error_ = "kernel '" + kernel_.name + "' has no code loaded";
+        return false;
+    }
+    const uint32_t maxWorkgroupSize = kernel_.descriptor.maxWorkgroupSize;
+    if (maxWorkgroupSize != 0 && config.block.count() > maxWorkgroupSize) {
+        error_ = "block of " + std::to_string(config.block.count()) + " threads exceeds the kernel's "
+                 ".max_flat_workgroup_size of " + std::to_string(maxWorkgroupSize);
+        return false;
+    }
+
+    struct Worker {
+        std::vector<PcCounters> pcs;
+        std::vector<BranchCounters> branches;
+        uint64_t waves = 0;
+        uint64_t workgroups = 0;
+        std::string error;
+    };
+    const uint64_t workgroups = config.grid.count();
+    const unsigned threadCount =
+        static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(config.threads, workgroups)));
+    std::vector<Worker> workers(threadCount);
+    std::atomic<uint64_t> next{0};
+    std::atomic<bool> failed{false};
+
+    // Workgroups are independent, so each worker takes whole workgroups and
+    // keeps its own counters; global memory is shared as on the device.
+    auto work = [&](Worker& worker) {
+        worker.pcs.assign(ops_.size(), PcCounters());
+        worker.branches.assign(ops_.size(), BranchCounters());
+        for (uint64_t id = next++; id < workgroups && !failed; id = next++) {
+            if (!runWorkgroup(config, id, memory, worker.pcs, worker.branches, worker.waves, worker.error)) {
+                failed = true;
+                return;
+            }
+            ++worker.workgroups;
+        }
+    };
+    if (threadCount == 1) {
+        work(workers[0]);
+    } else {
+        std::vector<std::thread> threads;
+        for (Worker& worker : workers) threads.emplace_back(work, std::ref(worker));
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    for (const Worker& worker : workers) {
+        if (!worker.error.empty()) {
+            error_ = "kernel '" + kernel_.name + "' at " + worker.error;
+            return false;
+        }
+    }
+
+    KernelProfile result;
+    result.name = kernel_.name;
+    for (const Worker& worker : workers) {
+        for (size_t i = 0; i < ops_.size(); ++i) {
+            const PcCounters& counters = worker.pcs[i];
+            if (counters.count == 0) continue;
+            PcCounters& into = result.pcs[ops_[i].pc];
+            into.count += counters.count;
+            into.lanes += counters.lanes;
+            into.stallCycles += counters.stallCycles;
+            into.waits += counters.waits;
+            if (!ops_[i].branch) continue;
+            const BranchCounters& branch = worker.branches[i];
+            BranchCounters& branchInto = result.branches[ops_[i].pc];
+            branchInto.executed += branch.executed;
+            branchInto.takenLanes += branch.takenLanes;
+            branchInto.notTakenLanes += branch.notTakenLanes;
+            branchInto.divergent += branch.divergent;
+        }
+        result.waves += worker.waves;
+        result.workgroups += worker.workgroups;
+    }
+    profile.merge(result);
+    if (profile.name.empty()) profile.name = kernel_.name;
+    return true;
+}
+
+const std::string& Simulator::getError() const {
+    return error_;
+}
+
+bool Simulator::runWorkgroup(const LaunchConfig& config, uint64_t workgroupId, std::vector<uint8_t>& memory,
+                             std::vector<PcCounters>& pcCounters, std::vector<BranchCounters>& branchCounters,
+                             uint64_t& waves, std::string& error) const {
+    WorkgroupState group;
+    group.config = &config;
+    group.params = config.params;
+    group.global = &memory;
+    group.ctaid[0] = static_cast<uint32_t>(workgroupId % config.grid.x);
+    group.ctaid[1] = static_cast<uint32_t>(workgroupId / config.grid.x % config.grid.y);
+    group.ctaid[2] = static_cast<uint32_t>(workgroupId / (static_cast<uint64_t>(config.grid.x) * config.grid.y));
+    group.shared.assign(kernel_.descriptor.sharedMemSize, 0);
+    group.privateSize = std::max(kernel_.descriptor.privateMemSize, kernel_.descriptor.localFrameSize);
+    group.error = &error;
+
+    const uint64_t threads = config.block.count();
+    const size_t waveCount = static_cast<size_t>((threads + kWaveSize - 1) / kWaveSize);
+    std::vector<WaveState> states(waveCount);
+    for (size_t w = 0; w < waveCount; ++w) {
+        WaveState& wave = states[w];
+        for (int l = 0; l < kWaveSize; ++l) {
+            const uint64_t tid = w * kWaveSize + l;
+            if (tid >= threads) break;
+            wave.live |= LaneMask(1) << l;
+            wave.tid[0][l] = static_cast<uint32_t>(tid % config.block.x);
+            wave.tid[1][l] = static_cast<uint32_t>(tid / config.block.x % config.block.y);
+            wave.tid[2][l] = static_cast<uint32_t>(tid / (static_cast<uint64_t>(config.block.x) * config.block.y));
+        }
+        wave.privateMemory.assign(static_cast<size_t>(group.privateSize) * kWaveSize, 0);
+    }
+    waves += waveCount;
+
+    // Run each wave up to its next barrier; once every live wave waits there,
+    // release them together.
+    for (;;) {
+        bool anyLive = false;
+        for (WaveState& wave : states) {
+            if (wave.live && !wave.atBarrier) {
+                ExecContext ctx{wave, group};
+                runWave(ops_, ctx, config.waveInstructionLimit, pcCounters, branchCounters);
+            }
+            anyLive = anyLive || wave.live;
+        }
+        if (!error.empty()) return false;
+        if (!anyLive) return true;
+        for (WaveState& wave : states) wave.atBarrier = false;
+    }
+}
+
+} // namespace sim
+} // namespace opuas
@@ -0,0 +1,93 @@
+// opuas/src/sim/Simulator.h
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "CodeObject.h"
+#include "ExecutionProfile.h"
+
+namespace opuas {
+namespace sim {
+
+struct Dim3 {
+    uint32_t x = 1;
+    uint32_t y = 1;
+    uint32_t z = 1;
+
+    uint64_t count() const { return static_cast<uint64_t>(x) * y * z; }
+};
+
+// Parse "X", "X,Y" or "X,Y,Z"; missing dimensions are 1.
+bool parseDim3(const std::string& text, Dim3& dim);
+
+// About 16.8M instructions per wave: seconds of host time, far beyond any
+// kernel the assembler's tests run.
+constexpr uint64_t kDefaultWaveInstructionLimit = 1ull << 24;
+
+struct LaunchConfig {
+    Dim3 grid;                    // Workgroups (%nctaid)
+    Dim3 block;                   // Threads per workgroup (%ntid)
+    std::vector<uint8_t> params;  // Kernel argument buffer; param space starts at %s0 = 0
+    unsigned threads = 1;         // Host threads, each simulating whole workgroups
+    uint64_t waveInstructionLimit = kDefaultWaveInstructionLimit; // Stops kernels that never exit
+};
+
+struct WaveState;
+struct ExecContext;
+struct DecodedOp;
+using OpHandler = void (*)(ExecContext& ctx, const DecodedOp& op);
+
+// Operand as the handlers see it; literals are already folded into `imm`.
+struct SimOperand {
+    OperandKind kind = OperandKind::None;
+    uint8_t reg = 0;
+    int64_t imm = 0;
+};
+
+// One predecoded instruction. The handler is picked for the opcode and data
+// type once, at load time, so the interpreter loop is a plain indirect call.
+struct DecodedOp {
+    OpHandler handler = nullptr;
+    uint32_t pc = 0;              // Byte offset in the kernel code
+    uint32_t target = 0;          // Branch target, as an instruction index
+    uint8_t modifier = 0;
+    uint8_t stall = 0;
+    bool wait = false;
+    bool branch = false;
+    SimOperand dst;
+    SimOperand src[3];
+};
+
+// Functional interpreter for one kernel of a code object. Waves execute with
+// per-lane program counters; each step issues the lowest PC among the live
+// lanes, so divergent paths reconverge at the first common instruction.
+class Simulator {
+public:
+    // Relocations against names in `symbols` (CodeObject::symbols) are
+    // applied when loading; any other relocation is an unresolved symbol.
+    explicit Simulator(const elf::KernelCode& kernel, const std::map<std::string, uint64_t>* symbols = nullptr);
+
+    bool load();
+    // Run a whole grid. `memory` is the global memory image; global addresses
+    // are byte offsets into it.
+    bool run(const LaunchConfig& config, std::vector<uint8_t>& memory, KernelProfile& profile);
+    const std::string& getError() const;
+
+private:
+    const elf::KernelCode& kernel_;
+    const std::map<std::string, uint64_t>* symbols_;
+    std::vector<DecodedOp> ops_;
+    std::string error_;
+
+    bool runWorkgroup(const LaunchConfig& config, uint64_t workgroupId, std::vector<uint8_t>& memory,
+                      std::vector<PcCounters>& pcCounters, std::vector<BranchCounters>& branchCounters,
+                      uint64_t& waves, std::string& error) const;
+};
+
+} // namespace sim
+} // namespace opuas
+
+#endif // SIMULATOR_H
@@ -6,6 +6,14 @@
 #include <algorithm>
 #include <cctype>
 #include <filesystem> // C++17
+#include <atomic>
+#include <sys/resource.h>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
 
 namespace opuas {
 namespace utils {
@@ -51,6 +59,22 @@ bool writeStringToFile(const std::string& filename, const std::string& content)
     }
 }
 
+// --- Memory Statistics ---
+
+void noteAllocation() {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t peakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Kilobytes on Linux
+}
+
 // --- String Manipulation Utilities ---
 
 std::string trim(const std::string& str) {
@@ -121,10 +145,22 @@ bool pathExists(const std::string& path) {
     }
 }
 
+// --- Hashing ---
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
 // --- Error and Logging Utilities ---
 
 void logInfo(const std::string& message) {
-    std::cout << "Info: " << message << std::endl;
+    std::clog << "Info: " << message << std::endl;
 }
 
 void logWarning(const std::string& message) {
@@ -2,6 +2,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -24,6 +26,20 @@ std::string getParentPath(const std::string& path);
 std::string getFilename(const std::string& path);
 bool pathExists(const std::string& path);
 
+// --- Hashing ---
+// 64-bit FNV-1a; pass a previous result as `seed` to hash several pieces.
+constexpr uint64_t kHashSeed = 14695981039346656037ull;
+uint64_t hash64(const void* data, size_t size, uint64_t seed = kHashSeed);
+
+// --- Memory Statistics ---
+// Calls to the global operator new since startup, and the peak resident set
+// size of the process in bytes (0 where the platform does not report it).
+// Allocations are counted by AllocationCounter.cpp, which only the opuas
+// tool links; in other programs allocationCount() stays 0.
+void noteAllocation();
+uint64_t allocationCount();
+uint64_t peakResidentBytes();
+
 // --- Error and Logging Utilities ---
 void logInfo(const std::string& message);
 void logWarning(const std::string& message);
@@ -0,0 +1,205 @@
+// opuas/test/CrossKernel.cpp
+//
+// Kernels that take the address of another kernel must simulate. kA stores
+// the literal `kB` to global memory; the word written must be kB's offset
+// in .text (its symbol value)
+//   - in an object assembled from one file,
+//   - in an object linked from separate files for kA and kB,
+//   - after the linked kB is patched with a body too large for its slot,
+//     which moves it to the end of .text.
+//
+// Usage: opuas_cross_kernel [--keep DIR]
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include "OpuAssembler.h"
+#include "OpuLinker.h"
+#include "OpuPatcher.h"
+#include "OpuSimulator.h"
+#include "ElfObjectReader.h"
+#include "utils.h"
+#include "TestSupport.h"
+
+namespace {
+
+using namespace opuas;
+using test::QuietLog;
+
+const char* const kCaller =
+    "    .global kA\n"
+    "    .type kA,@function\n"
+    "kA:\n"
+    "    ld.param.u64    %vd0, [%s0 + kA_param_0]\n"
+    "    mov.u32         %v2, kB\n"
+    "    st.global.u32   [%vd0 + 0], %v2\n"
+    "    t_exit\n";
+
+const char* const kCallerMetadata =
+    " - .name: kA\n"
+    "   .args:\n"
+    "     - .address_space: global .name: kA_param_0 .offset: 0 .size: 8 .value_kind: global_buffer\n";
+
+const char* const kCallee =
+    "    .global kB\n"
+    "    .type kB,@function\n"
+    "kB:\n"
+    "    mov.u32         %v1, 5\n"
+    "    t_exit\n";
+
+const char* const kCalleeMetadata = " - .name: kB\n";
+
+// Replacement for kB that cannot fit where the original was.
+const char* const kLargerCallee =
+    "    .global kB\n"
+    "    .type kB,@function\n"
+    "kB:\n"
+    "    mov.u32         %v1, 5\n"
+    "    add.u32         %v1, %v1, 1\n"
+    "    add.u32         %v1, %v1, 2\n"
+    "    add.u32         %v1, %v1, 3\n"
+    "    add.u32         %v1, %v1, 4\n"
+    "    add.u32         %v1, %v1, 5\n"
+    "    add.u32         %v1, %v1, 6\n"
+    "    t_exit\n";
+
+std::string coasmFile(const std::string& text, const std::string& metadata) {
+    return "    .text\n" + text + "-\nopu.kernels:\n" + metadata + "opu.version:\n - 2\n - 0\n...\n";
+}
+
+bool assemble(const std::string& source, const std::string& object) {
+    QuietLog quiet;
+    OpuAssembler assembler(source, object);
+    return assembler.assemble();
+}
+
+// Run kA of `object` and check the word it stores against kB's symbol value,
+// which `value` receives.
+bool checkCaller(const std::string& what, const std::string& object, const std::filesystem::path& dir,
+                 uint64_t* value = nullptr) {
+    uint64_t expected = 0;
+    {
+        QuietLog quiet;
+        elf::ElfObjectReader reader(object);
+        if (!reader.read() || !reader.getCodeObject().symbols.count("kB")) {
+            std::cerr << "CrossKernel Error: " << what << ": no symbol kB in '" << object << "'\n";
+            return false;
+        }
+        expected = reader.getCodeObject().symbols.at("kB");
+    }
+
+    SimulatorOptions options;
+    options.kernelName = "kA";
+    options.args = {"0"};
+    options.memorySize = sizeof(uint32_t);
+    options.memoryOutFile = (dir / "memory.out").string();
+    {
+        QuietLog quiet;
+        OpuSimulator simulator(object, (dir / "kA.profile").string(), options);
+        if (!simulator.simulate()) {
+            std::cerr << "CrossKernel Error: " << what << ": kA does not simulate\n";
+            return false;
+        }
+    }
+    std::string memory;
+    uint32_t stored = 0;
+    if (!utils::readFileToString(options.memoryOutFile, memory) || memory.size() < sizeof(stored)) return false;
+    std::memcpy(&stored, memory.data(), sizeof(stored));
+    if (stored != expected) {
+        std::cerr << "CrossKernel Error: " << what << ": kA stored 0x" << std::hex << stored << ", kB is at 0x"
+                  << expected << std::dec << "\n";
+        return false;
+    }
+    std::cout << "  " << what << ": kA sees kB at 0x" << std::hex << stored << std::dec << "\n";
+    if (value) *value = expected;
+    return true;
+}
+
+// kA and kB from separate objects, linked; then kB patched so that it moves.
+bool linkAndPatch(const std::filesystem::path& dir) {
+    const std::string a = (dir / "a.coasm").string(), aObject = (dir / "a.o").string();
+    const std::string b = (dir / "b.coasm").string(), bObject = (dir / "b.o").string();
+    const std::string linked = (dir / "ab.o").string();
+    const std::string larger = (dir / "kB.coasm").string();
+    bool built = utils::writeStringToFile(a, coasmFile(kCaller, kCallerMetadata)) &&
+                 utils::writeStringToFile(b, coasmFile(kCallee, kCalleeMetadata)) &&
+                 utils::writeStringToFile(larger, coasmFile(kLargerCallee, kCalleeMetadata)) &&
+                 assemble(a, aObject) && assemble(b, bObject);
+    if (built) {
+        QuietLog quiet;
+        OpuLinker linker({aObject, bObject}, linked);
+        built = linker.link();
+    }
+    uint64_t before = 0, after = 0;
+    if (!built) {
+        std::cerr << "CrossKernel Error: could not link kA and kB from separate objects\n";
+        return false;
+    }
+    if (!checkCaller("linked", linked, dir, &before)) return false;
+
+    bool patched = false;
+    {
+        QuietLog quiet;
+        OpuPatcher patcher(linked, larger, "kB");
+        patched = patcher.patch();
+    }
+    if (!patched) {
+        std::cerr << "CrossKernel Error: could not patch kB in '" << linked << "'\n";
+        return false;
+    }
+    if (!checkCaller("patched, kB moved", linked, dir, &after)) return false;
+    if (after == before) {
+        std::cerr << "CrossKernel Error: the larger kB was patched in place; nothing moved\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string keepDir;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--keep" && i + 1 < argc) {
+            keepDir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--keep DIR]\n";
+            return 2;
+        }
+    }
+
+    namespace fs = std::filesystem;
+    fs::path dir = keepDir;
+    if (dir.empty()) {
+        dir = test::makeScratchDirectory("opuas_cross_kernel");
+        if (dir.empty()) {
+            std::cerr << "CrossKernel Error: could not create a scratch directory in "
+                      << fs::temp_directory_path() << "\n";
+            return 1;
+        }
+    } else {
+        fs::create_directories(dir);
+    }
+
+    std::cout << "Cross-kernel references:\n";
+    bool ok = true;
+    const std::string same = (dir / "same.coasm").string();
+    const std::string sameObject = (dir / "same.o").string();
+    if (!utils::writeStringToFile(same, coasmFile(std::string(kCaller) + kCallee,
+                                                  std::string(kCallerMetadata) + kCalleeMetadata)) ||
+        !assemble(same, sameObject)) {
+        std::cerr << "CrossKernel Error: '" << same << "' does not assemble\n";
+        ok = false;
+    } else {
+        ok = checkCaller("one object", sameObject, dir) && ok;
+    }
+
+    ok = linkAndPatch(dir) && ok;
+
+    if (keepDir.empty()) fs::remove_all(dir);
+    std::cout << (ok ? "Cross-kernel PASSED\n" : "Cross-kernel FAILED\n");
+    return ok ? 0 : 1;
+}
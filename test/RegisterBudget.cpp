@@ -0,0 +1,322 @@
+// opuas/test/RegisterBudget.cpp
+//
+// End-to-end test for %v register budgets (algorithms/RegisterAllocator).
+//
+// A kernel that keeps more values live than a small budget allows is
+// assembled as written, with --max-regs and with the automatic limit. Each
+// object is simulated on the same memory image; the budgeted builds must
+// leave global memory exactly as the unconstrained build does. The objects
+// must also record the budget: .kernel_ctrl bits [31:24] hold the limit,
+// the code uses no more %v registers than that, and a build that spills
+// reserves private memory for it. The automatic limit must be the one the
+// static model scores best among the occupancy steps below the footprint.
+//
+// Usage: opuas_register_budget [--values N] [--keep DIR]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "OpuAssembler.h"
+#include "OpuSimulator.h"
+#include "ElfObjectReader.h"
+#include "OpuIsa.h"
+#include "Parser.h"
+#include "PerfModel.h"
+#include "RegisterAllocator.h"
+#include "StallSetter.h"
+#include "utils.h"
+#include "TestSupport.h"
+
+namespace {
+
+using namespace opuas;
+using test::QuietLog;
+
+constexpr int kSmallBudget = 16;
+constexpr uint32_t kThreads = 32;
+constexpr int kIterations = 3;
+
+// Loads `values` words per thread, keeps them all live across a loop that
+// reads each of them every iteration, and stores the sum. Besides the loaded
+// values it holds a constant and a literal that can be rematerialised, and a
+// %vd pair built from two halves.
+std::string pressureKernel(int values) {
+    std::ostringstream out;
+    out << "    .text\n"
+        << "    .global press\n"
+        << "    .type press,@function\n"
+        << "press:\n"
+        << "    ld.param.u64    %vd0, [%s0 + press_param_0]\n"
+        << "    ld.param.u32    %v2, [%s0 + press_param_1]\n"
+        << "    mov.u32         %v3, %tid.x\n"
+        << "    mul.wide.u32    %vd4, %v3, 4\n"
+        << "    add.u64         %vd6, %vd0, %vd4\n"
+        << "    mov.u32         %v3, 77\n"
+        << "    mov.u32         %v60, 1000003\n";
+    for (int k = 0; k < values; ++k) {
+        out << "    ld.global.u32   %v" << 8 + k << ", [%vd6 + " << 128 * k << "]\n";
+    }
+    out << "    mov.u32         %v62, 5\n"
+        << "    mov.u32         %v63, 9\n"
+        << "    mov.u32         %v59, 0\n"
+        << "LOOP:\n";
+    for (int k = 0; k < values; ++k) {
+        out << "    mad.lo.u32      %v59, %v" << 8 + k << ", %v3, %v59\n";
+        if (k % 7 == 0) out << "    add.u32         %v59, %v59, %v60\n";
+    }
+    out << "    sub.u32         %v2, %v2, 1\n"
+        << "    set_tcc.gt.u32  %p0, %v2, 0\n"
+        << "    s_branch_tccnz  p0 LOOP\n"
+        << "    add.u32         %v59, %v59, %v62\n"
+        << "    st.global.u64   [%vd6 + " << 128 * (values + 1) << "], %vd62\n"
+        << "    st.global.u32   [%vd6 + " << 128 * values << "], %v59\n"
+        << "    t_exit\n"
+        << "-\n"
+        << "opu.kernels:\n"
+        << " - .name: press\n"
+        << "   .args:\n"
+        << "     - .address_space: global .name: press_param_0 .offset: 0 .size: 8 .value_kind: global_buffer\n"
+        << "     - .address_space: global .name: press_param_1 .offset: 8 .size: 4 .value_kind: by_value\n"
+        << "   .shared_memsize: 0\n"
+        << "   .private_memsize: 0\n"
+        << "   .cmem_size: 0\n"
+        << "   .bar_used: 0\n"
+        << "   .local_framesize: 0\n"
+        << "   .kernel_ctrl: 7\n"
+        << "   .kernel_mode: 0\n"
+        << "opu.version:\n"
+        << " - 2\n"
+        << " - 0\n"
+        << "...\n";
+    return out.str();
+}
+
+struct Build {
+    std::string name;
+    AssemblerOptions options;
+    std::string object;
+    std::string memoryOut;
+    elf::KernelDescriptor descriptor;
+};
+
+bool assembleAndRun(Build& build, const std::string& source, const std::string& memory) {
+    {
+        QuietLog quiet;
+        OpuAssembler assembler(source, build.object, build.options);
+        if (!assembler.assemble()) {
+            std::cerr << "RegisterBudget Error: " << build.name << ": the kernel does not assemble\n";
+            return false;
+        }
+    }
+    {
+        QuietLog quiet;
+        elf::ElfObjectReader reader(build.object);
+        const elf::KernelCode* kernel = reader.read() ? reader.getCodeObject().findKernel("press") : nullptr;
+        if (!kernel) {
+            std::cerr << "RegisterBudget Error: " << build.name << ": no kernel 'press' in '" << build.object << "'\n";
+            return false;
+        }
+        build.descriptor = kernel->descriptor;
+    }
+
+    SimulatorOptions options;
+    options.kernelName = "press";
+    options.block.x = kThreads;
+    options.args = {"0", std::to_string(kIterations)};
+    options.memoryFile = memory;
+    options.memoryOutFile = build.memoryOut;
+    QuietLog quiet;
+    OpuSimulator simulator(build.object, build.object + ".profile", options);
+    if (!simulator.simulate()) {
+        std::cerr << "RegisterBudget Error: " << build.name << ": the kernel does not simulate\n";
+        return false;
+    }
+    return true;
+}
+
+// The limit --max-regs auto should pick: every occupancy step below the
+// kernel's footprint is allocated and scored with the static model, and the
+// best estimated throughput wins (the footprint on ties). Returns 0 when the
+// kernel cannot be parsed; `tried` counts the lower limits scored.
+int expectedAutoLimit(const std::string& source, int& tried) {
+    std::string text;
+    if (!utils::readFileToString(source, text)) return 0;
+    QuietLog quiet;
+    Parser parser(text, source);
+    if (!parser.parse() || parser.getProgram().kernels.size() != 1) return 0;
+    const Kernel& kernel = parser.getProgram().kernels[0];
+
+    algorithms::PerfModel model;
+    auto estimate = [&](Kernel& trial) {
+        algorithms::StallSetter stallSetter(trial);
+        if (!stallSetter.analyzeAndSet()) return -1.0;
+        return model.analyze(trial).throughput.wavesPerKcycle;
+    };
+    Kernel asWritten = kernel;
+    asWritten.arena.reset();
+    const int footprint = model.analyze(kernel).registers.vregsUsed;
+    int best = footprint;
+    double bestThroughput = estimate(asWritten);
+    std::ostringstream scores;
+    scores << footprint << ": " << bestThroughput;
+
+    const isa::TargetInfo& target = isa::getTargetInfo();
+    int previous = footprint;
+    tried = 0;
+    for (int waves = 1; waves <= target.maxWavesPerSimd; ++waves) {
+        const int limit = std::min(target.vregsPerSimd / waves / target.vregGranule * target.vregGranule,
+                                   isa::kMaxVRegs);
+        if (limit <= 0 || limit >= previous) continue;
+        previous = limit;
+        Kernel trial = kernel;
+        trial.arena.reset();
+        algorithms::RegisterAllocator allocator(trial);
+        if (!allocator.allocate(limit)) continue;
+        const double throughput = estimate(trial);
+        scores << ", " << limit << ": " << throughput;
+        ++tried;
+        if (throughput > bestThroughput) {
+            best = limit;
+            bestThroughput = throughput;
+        }
+    }
+    std::cout << "  estimated waves per kcycle by %v limit: " << scores.str() << "\n";
+    return best;
+}
+
+// The limit in .kernel_ctrl, the code within it and the other bits intact.
+// `mustSpill` when the limit is below the number of values live at once.
+bool checkDescriptor(const Build& build, const elf::KernelDescriptor& unconstrained, int expectedLimit,
+                     bool mustSpill) {
+    const uint32_t ctrl = build.descriptor.kernelCtrl;
+    const int limit = static_cast<int>((ctrl & isa::kKernelCtrlRegLimitMask) >> isa::kKernelCtrlRegLimitShift);
+    bool ok = true;
+    if (expectedLimit ? limit != expectedLimit : (limit <= 0 || limit > isa::kMaxVRegs)) {
+        std::cerr << "RegisterBudget Error: " << build.name << ": .kernel_ctrl[31:24] is " << limit << "\n";
+        ok = false;
+    }
+    if ((ctrl & ~isa::kKernelCtrlRegLimitMask) != (unconstrained.kernelCtrl & ~isa::kKernelCtrlRegLimitMask)) {
+        std::cerr << "RegisterBudget Error: " << build.name << ": .kernel_ctrl lost its other bits\n";
+        ok = false;
+    }
+    if (limit > 0 && static_cast<int>(build.descriptor.vregCount) > limit) {
+        std::cerr << "RegisterBudget Error: " << build.name << ": " << build.descriptor.vregCount
+                  << " %v registers used, limit " << limit << "\n";
+        ok = false;
+    }
+    // Loaded values cannot be rematerialised, so only spill slots make room.
+    if (build.descriptor.privateMemSize < unconstrained.privateMemSize ||
+        (mustSpill && build.descriptor.privateMemSize == unconstrained.privateMemSize)) {
+        std::cerr << "RegisterBudget Error: " << build.name << ": .private_memsize is "
+                  << build.descriptor.privateMemSize << " with limit " << limit << "\n";
+        ok = false;
+    }
+    std::cout << "  " << build.name << ": limit " << limit << ", " << build.descriptor.vregCount
+              << " %v registers, .private_memsize " << build.descriptor.privateMemSize << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // At 30 values the model prefers a limit below the footprint, so the
+    // automatic limit has to beat the registers as written.
+    int values = 30;
+    std::string keepDir;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--values" && i + 1 < argc) {
+            values = std::atoi(argv[++i]);
+        } else if (arg == "--keep" && i + 1 < argc) {
+            keepDir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--values N] [--keep DIR]\n";
+            return 2;
+        }
+    }
+    // Loaded values live in %v8 upwards, below the fixed %v59..%v63.
+    if (values <= kSmallBudget || values > 50) {
+        std::cerr << "RegisterBudget Error: --values must be in (" << kSmallBudget << ", 50]\n";
+        return 2;
+    }
+
+    namespace fs = std::filesystem;
+    fs::path dir = keepDir;
+    if (dir.empty()) {
+        dir = test::makeScratchDirectory("opuas_register_budget");
+        if (dir.empty()) {
+            std::cerr << "RegisterBudget Error: could not create a scratch directory in "
+                      << fs::temp_directory_path() << "\n";
+            return 1;
+        }
+    } else {
+        fs::create_directories(dir);
+    }
+
+    const std::string source = (dir / "press.coasm").string();
+    const std::string memory = (dir / "memory.bin").string();
+    std::string image(128 * (values + 2) + 4 * kThreads, '\0');
+    std::mt19937 random(values);
+    for (char& byte : image) byte = static_cast<char>(random());
+    if (!utils::writeStringToFile(source, pressureKernel(values)) || !utils::writeStringToFile(memory, image)) {
+        std::cerr << "RegisterBudget Error: could not write to " << dir << "\n";
+        return 1;
+    }
+
+    std::vector<Build> builds(3);
+    builds[0].name = "as written";
+    builds[1].name = "--max-regs " + std::to_string(kSmallBudget);
+    builds[1].options.maxRegs = kSmallBudget;
+    builds[2].name = "--max-regs auto";
+    builds[2].options.autoRegisterLimit = true;
+    for (size_t i = 0; i < builds.size(); ++i) {
+        builds[i].object = (dir / ("press" + std::to_string(i) + ".o")).string();
+        builds[i].memoryOut = (dir / ("memory" + std::to_string(i) + ".out")).string();
+    }
+
+    std::cout << "Register budget: " << values << " live values, " << kThreads << " threads, " << kIterations
+              << " iterations\n";
+    bool ok = true;
+    for (Build& build : builds) ok = assembleAndRun(build, source, memory) && ok;
+
+    if (ok) {
+        const elf::KernelDescriptor& unconstrained = builds[0].descriptor;
+        if (unconstrained.vregCount <= static_cast<uint32_t>(kSmallBudget)) {
+            std::cerr << "RegisterBudget Error: the kernel needs only " << unconstrained.vregCount
+                      << " %v registers; nothing to test\n";
+            ok = false;
+        }
+        ok = checkDescriptor(builds[1], unconstrained, kSmallBudget, true) && ok;
+        // Auto mode must have scored the lower limits and kept the best one.
+        int tried = 0;
+        const int autoLimit = expectedAutoLimit(source, tried);
+        if (autoLimit == 0 || tried == 0) {
+            std::cerr << "RegisterBudget Error: no limit below the footprint to choose from\n";
+            ok = false;
+        }
+        ok = checkDescriptor(builds[2], unconstrained, autoLimit, false) && ok;
+
+        std::string expected, actual;
+        if (!utils::readFileToString(builds[0].memoryOut, expected) || expected == image) {
+            std::cerr << "RegisterBudget Error: the unconstrained build wrote nothing\n";
+            ok = false;
+        }
+        for (size_t i = 1; i < builds.size(); ++i) {
+            if (!utils::readFileToString(builds[i].memoryOut, actual) || actual != expected) {
+                std::cerr << "RegisterBudget Error: " << builds[i].name
+                          << ": global memory differs from the unconstrained build\n";
+                ok = false;
+            }
+        }
+    }
+
+    if (keepDir.empty()) fs::remove_all(dir);
+    std::cout << (ok ? "Register budget PASSED\n" : "Register budget FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,800 @@
+// opuas/test/RoundTrip.cpp
+//
+// Round-trip test and benchmark for the encoder, decoder, assembler and
+// disassembler.
+//
+// 1. Every instruction of a generated corpus is encoded and decoded again
+//    and must come back unchanged; encode and decode throughput are timed
+//    per instruction format.
+// 2. The corpus (random kernels over every opcode, data type and modifier)
+//    is assembled, the object is disassembled, and the listing is assembled
+//    again. Both objects must be byte-identical, kernel fingerprints
+//    included. The same holds for the annotated listing (--annotate with a
+//    --profile made up from the kernels' own PCs).
+// 3. The corpus, a rearranged copy of it and the named files are assembled
+//    with and without --stream; the objects must be byte-identical. After
+//    one kernel of the corpus is edited, --incremental against the old
+//    object must give the bytes of a full assemble.
+//
+// Files named on the command line go through steps 2 and 3 as well.
+//
+// Usage: opuas_roundtrip [--seed N] [--kernels N] [--instructions N]
+//                        [--iterations N] [--keep DIR] [file.coasm ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "OpuAssembler.h"
+#include "OpuDisassembler.h"
+#include "ElfObjectReader.h"
+#include "ExecutionProfile.h"
+#include "OpuEncoding.h"
+#include "Program.h"
+#include "utils.h"
+#include "TestSupport.h"
+
+namespace {
+
+using namespace opuas;
+using Clock = std::chrono::steady_clock;
+using test::QuietLog;
+
+constexpr isa::Format kFormats[] = {
+    isa::Format::VOP1, isa::Format::VOP2, isa::Format::VOP3, isa::Format::VCMP, isa::Format::MLOAD,
+    isa::Format::MSTORE, isa::Format::SOPP, isa::Format::SBRANCH, isa::Format::SCBRANCH,
+};
+
+const char* formatName(isa::Format format) {
+    switch (format) {
+        case isa::Format::VOP1:     return "VOP1";
+        case isa::Format::VOP2:     return "VOP2";
+        case isa::Format::VOP3:     return "VOP3";
+        case isa::Format::VCMP:     return "VCMP";
+        case isa::Format::MLOAD:    return "MLOAD";
+        case isa::Format::MSTORE:   return "MSTORE";
+        case isa::Format::SOPP:     return "SOPP";
+        case isa::Format::SBRANCH:  return "SBRANCH";
+        case isa::Format::SCBRANCH: return "SCBRANCH";
+    }
+    return "?";
+}
+
+struct Options {
+    uint64_t seed = 1;
+    int kernels = 16;
+    int instructions = 512;     // Per kernel, on top of the coverage set
+    int iterations = 200;       // Passes over each format's instructions when timing
+    std::string keepDir;        // Keep the generated sources and objects here
+    std::vector<std::string> files;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// --- Corpus Generation ---
+
+// Opcode, data type and modifier combinations whose mnemonic reads back as
+// the same combination.
+struct Variant {
+    isa::Opcode opcode;
+    isa::DataType type;
+    uint8_t modifier;
+};
+
+std::vector<Variant> allVariants() {
+    std::vector<Variant> variants;
+    for (int op = 0; op < static_cast<int>(isa::Opcode::Count); ++op) {
+        const isa::Opcode opcode = static_cast<isa::Opcode>(op);
+        const isa::OpcodeInfo& info = isa::getOpcodeInfo(opcode);
+        if (info.format == isa::Format::SOPP || info.format == isa::Format::SBRANCH ||
+            info.format == isa::Format::SCBRANCH) {
+            variants.push_back({opcode, isa::DataType::None, 0});
+            continue;
+        }
+        int modifiers = 1;
+        switch (info.modifierKind) {
+            case isa::ModifierKind::None:    modifiers = 1; break;
+            case isa::ModifierKind::MulMode: modifiers = isa::MulWide + 1; break;
+            case isa::ModifierKind::Compare: modifiers = isa::CmpGe + 1; break;
+            case isa::ModifierKind::Space:   modifiers = isa::SpaceConst + 1; break;
+            case isa::ModifierKind::SrcType: modifiers = static_cast<int>(isa::DataType::Count); break;
+        }
+        for (int type = 0; type < static_cast<int>(isa::DataType::Count); ++type) {
+            for (int modifier = 0; modifier < modifiers; ++modifier) {
+                // "cvt.<src>" alone would read back as the destination type.
+                if (info.modifierKind == isa::ModifierKind::SrcType && type == 0 && modifier != 0) continue;
+                variants.push_back({opcode, static_cast<isa::DataType>(type), static_cast<uint8_t>(modifier)});
+            }
+        }
+    }
+    return variants;
+}
+
+class Generator {
+public:
+    explicit Generator(uint64_t seed) : rng_(seed) {}
+
+    int uniform(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng_); }
+    bool chance(int percent) { return uniform(0, 99) < percent; }
+
+    // A kernel holding `variants` in random order plus `extra` random ones.
+    Kernel kernel(const std::string& name, std::vector<Variant> variants, int extra,
+                  const std::vector<Variant>& pool) {
+        Kernel kernel;
+        kernel.name = name;
+        for (int i = 0; i < 3; ++i) {
+            KernelArg arg;
+            arg.name = name + "_param_" + std::to_string(i);
+            arg.addressSpace = "global";
+            arg.valueKind = "global_buffer";
+            arg.offset = 8 * i;
+            arg.size = 8;
+            kernel.args.push_back(arg);
+        }
+        kernel.metadata[".shared_memsize"] = 256 * uniform(0, 16);
+        kernel.metadata[".max_flat_workgroup_size"] = 64 << uniform(0, 4);
+
+        for (int i = 0; i < extra; ++i) variants.push_back(pool[uniform(0, static_cast<int>(pool.size()) - 1)]);
+        std::shuffle(variants.begin(), variants.end(), rng_);
+        for (const Variant& variant : variants) kernel.instructions.push_back(instruction(variant, kernel));
+
+        Instruction exit;
+        exit.opcode = isa::Opcode::Exit;
+        kernel.instructions.push_back(exit);
+
+        // Branch targets: any instruction of the kernel.
+        const int last = static_cast<int>(kernel.instructions.size()) - 1;
+        for (Instruction& inst : kernel.instructions) {
+            if (!inst.isBranch()) continue;
+            const int target = uniform(0, last);
+            const std::string label = "L" + std::to_string(target);
+            kernel.labels[label] = target;
+            inst.operands.back().symbol = label;
+        }
+        return kernel;
+    }
+
+private:
+    Operand reg(OperandKind kind, int count) {
+        Operand operand;
+        operand.kind = kind;
+        operand.reg = uniform(0, count - 1);
+        if (kind == OperandKind::VReg64) operand.reg &= ~1; // Aligned pairs
+        return operand;
+    }
+
+    Operand destination() {
+        switch (uniform(0, 2)) {
+            case 0:  return reg(OperandKind::VReg, 64);
+            case 1:  return reg(OperandKind::VReg64, 64);
+            default: return reg(OperandKind::SReg, 64);
+        }
+    }
+
+    // Any source operand; at most one per instruction may need a literal.
+    Operand source(const Kernel& kernel, bool& literalUsed) {
+        Operand operand;
+        const int pick = uniform(0, literalUsed ? 5 : 8);
+        switch (pick) {
+            case 0: return reg(OperandKind::VReg, 64);
+            case 1: return reg(OperandKind::VReg64, 64);
+            case 2: return reg(OperandKind::SReg, 64);
+            case 3: return reg(OperandKind::PReg, 8);
+            case 4: return reg(OperandKind::Special, isa::numSpecialRegisters());
+            case 5:
+                operand.kind = OperandKind::Imm;
+                operand.imm = uniform(0, isa::kMaxInlineImm);
+                return operand;
+            case 6:
+                operand.kind = OperandKind::Imm;
+                operand.imm = chance(50) ? -uniform(1, 1 << 30) : uniform(isa::kMaxInlineImm + 1, 1 << 30);
+                break;
+            case 7:
+                operand.kind = OperandKind::Symbol;
+                operand.symbol = kernel.args[uniform(0, static_cast<int>(kernel.args.size()) - 1)].name;
+                return operand;   // Substituted by its (inline) offset
+            default:
+                operand.kind = OperandKind::Symbol;
+                operand.symbol = "rt_extern_" + std::to_string(uniform(0, 3));
+                break;
+        }
+        literalUsed = true;
+        return operand;
+    }
+
+    Operand address() {
+        return chance(50) ? reg(OperandKind::VReg64, 64) : reg(OperandKind::SReg, 64);
+    }
+
+    Instruction instruction(const Variant& variant, const Kernel& kernel) {
+        Instruction inst;
+        inst.opcode = variant.opcode;
+        inst.type = variant.type;
+        inst.modifier = variant.modifier;
+        bool literalUsed = false;
+        std::vector<Operand> ops;
+        switch (inst.info().format) {
+            case isa::Format::VOP1:
+            case isa::Format::VOP2:
+            case isa::Format::VOP3:
+                ops.push_back(destination());
+                for (size_t i = 0; i < isa::formatOperandCount(inst.info().format); ++i) {
+                    ops.push_back(source(kernel, literalUsed));
+                }
+                break;
+            case isa::Format::VCMP:
+                ops.push_back(reg(OperandKind::PReg, 8));
+                ops.push_back(source(kernel, literalUsed));
+                ops.push_back(source(kernel, literalUsed));
+                break;
+            case isa::Format::MLOAD:
+                ops.push_back(destination());
+                ops.push_back(address());
+                ops.push_back(source(kernel, literalUsed));
+                break;
+            case isa::Format::MSTORE:
+                ops.push_back(address());
+                ops.push_back(source(kernel, literalUsed));
+                ops.push_back(source(kernel, literalUsed));
+                break;
+            case isa::Format::SOPP:
+                break;
+            case isa::Format::SBRANCH:
+            case isa::Format::SCBRANCH:
+                if (inst.info().format == isa::Format::SCBRANCH) ops.push_back(reg(OperandKind::PReg, 8));
+                ops.emplace_back();
+                ops.back().kind = OperandKind::Symbol;  // Target picked once the kernel is complete
+                break;
+        }
+        inst.operands.assign(ops.begin(), ops.end());
+        return inst;
+    }
+
+    std::mt19937_64 rng_;
+};
+
+Program generateCorpus(const Options& options) {
+    Generator generator(options.seed);
+    const std::vector<Variant> variants = allVariants();
+
+    // Every variant appears at least once, spread over the kernels.
+    Program program;
+    program.version = {2, 0};
+    const size_t kernels = static_cast<size_t>(std::max(options.kernels, 1));
+    std::vector<std::vector<Variant>> coverage(kernels);
+    for (size_t i = 0; i < variants.size(); ++i) coverage[i % kernels].push_back(variants[i]);
+    for (size_t k = 0; k < kernels; ++k) {
+        program.kernels.push_back(
+            generator.kernel("rt_kernel_" + std::to_string(k), coverage[k], options.instructions, variants));
+    }
+    return program;
+}
+
+// --- Encoder / Decoder ---
+
+// What an instruction decodes back to: kernel arguments become their offset,
+// other symbols `symbolValue`, and literals read back as unsigned 32-bit words.
+Instruction normalized(const Instruction& inst, const Kernel& kernel, uint32_t symbolValue) {
+    Instruction result = inst;
+    for (Operand& operand : result.operands) {
+        if (operand.kind == OperandKind::Symbol) {
+            const KernelArg* arg = kernel.findArg(operand.symbol);
+            operand = Operand();
+            operand.kind = OperandKind::Imm;
+            operand.imm = arg ? arg->offset : symbolValue;
+        } else if (operand.kind == OperandKind::Imm) {
+            operand.imm = static_cast<uint32_t>(operand.imm);
+        }
+    }
+    return result;
+}
+
+bool sameInstruction(const Instruction& a, const Instruction& b) {
+    if (a.opcode != b.opcode || a.type != b.type || a.modifier != b.modifier || a.stall != b.stall ||
+        a.wait != b.wait || a.operands.size() != b.operands.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.operands.size(); ++i) {
+        const Operand& x = a.operands[i];
+        const Operand& y = b.operands[i];
+        if (x.kind != y.kind || (x.kind == OperandKind::Imm ? x.imm != y.imm : x.reg != y.reg)) return false;
+    }
+    return true;
+}
+
+struct FormatResult {
+    size_t instructions = 0;
+    size_t words = 0;
+    double encodeSeconds = 0;
+    double decodeSeconds = 0;
+};
+
+// Encode and decode every instruction once for correctness, then time
+// `iterations` passes over each format's instructions.
+bool encodeDecodeRoundTrip(const Program& program, const Options& options,
+                           std::map<isa::Format, FormatResult>& results) {
+    std::mt19937_64 rng(options.seed);
+    std::map<isa::Format, std::vector<Instruction>> byFormat;
+    for (const Kernel& kernel : program.kernels) {
+        for (const Instruction& original : kernel.instructions) {
+            // Stall and wait bits are set by the assembler; cover them here.
+            Instruction inst = normalized(original, kernel, 0x1000);
+            inst.stall = static_cast<int>(rng() % (isa::kMaxStall + 1));
+            inst.wait = rng() % 2;
+            byFormat[inst.info().format].push_back(inst);
+        }
+    }
+
+    bool ok = true;
+    for (const auto& [format, insts] : byFormat) {
+        FormatResult& result = results[format];
+        result.instructions = insts.size();
+
+        std::vector<uint32_t> words;
+        std::string message;
+        for (const Instruction& inst : insts) {
+            const size_t start = words.size();
+            isa::DecodedInstruction decoded;
+            if (!isa::encodeInstruction(inst, 0x1000, words, message) ||
+                !isa::decodeInstruction(words.data() + start, words.size() - start, decoded, message) ||
+                decoded.words != words.size() - start || !sameInstruction(inst, decoded.inst)) {
+                std::cerr << "RoundTrip Error: " << formatName(format) << " '" << formatInstruction(inst)
+                          << "' does not survive encode/decode" << (message.empty() ? "" : ": " + message) << "\n";
+                ok = false;
+                break;
+            }
+        }
+        result.words = words.size();
+
+        std::vector<uint32_t> scratch;
+        scratch.reserve(words.size());
+        auto start = Clock::now();
+        for (int i = 0; i < options.iterations; ++i) {
+            scratch.clear();
+            for (const Instruction& inst : insts) isa::encodeInstruction(inst, 0x1000, scratch, message);
+        }
+        result.encodeSeconds = secondsSince(start);
+
+        // Count what the timed loops produced so they cannot be dropped, and
+        // so a decoder that loses its place fails the test.
+        isa::DecodedInstruction decoded;
+        size_t decodedCount = 0;
+        start = Clock::now();
+        for (int i = 0; i < options.iterations; ++i) {
+            for (size_t pos = 0; pos < words.size(); pos += decoded.words) {
+                if (!isa::decodeInstruction(words.data() + pos, words.size() - pos, decoded, message)) break;
+                ++decodedCount;
+            }
+        }
+        result.decodeSeconds = secondsSince(start);
+        if (ok && (scratch != words || decodedCount != insts.size() * options.iterations)) {
+            std::cerr << "RoundTrip Error: " << formatName(format) << " timing loops disagree with the first pass\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// --- Assembler / Disassembler ---
+
+struct PipelineResult {
+    size_t sourceBytes = 0;
+    size_t listingBytes = 0;
+    size_t codeBytes = 0;
+    double assembleSeconds = 0;
+    double disassembleSeconds = 0;
+    double reassembleSeconds = 0;
+};
+
+bool assembleFile(const std::string& source, const std::string& object) {
+    QuietLog quiet;
+    OpuAssembler assembler(source, object);
+    return assembler.assemble();
+}
+
+bool sameFile(const std::string& first, const std::string& second) {
+    std::string a, b;
+    return utils::readFileToString(first, a) && utils::readFileToString(second, b) && a == b;
+}
+
+// Report the first instruction where the two objects' kernels differ.
+void explainMismatch(const std::string& first, const std::string& second) {
+    QuietLog quiet;
+    elf::ElfObjectReader a(first), b(second);
+    if (!a.read() || !b.read()) return;
+    const std::vector<elf::KernelCode>& ka = a.getCodeObject().kernels;
+    const std::vector<elf::KernelCode>& kb = b.getCodeObject().kernels;
+    if (ka.size() != kb.size()) {
+        std::cerr << "  kernel count " << ka.size() << " vs " << kb.size() << "\n";
+        return;
+    }
+    for (size_t k = 0; k < ka.size(); ++k) {
+        if (ka[k].name != kb[k].name) {
+            std::cerr << "  kernel " << k << " is '" << ka[k].name << "' vs '" << kb[k].name << "'\n";
+            return;
+        }
+        Kernel da, db;
+        std::vector<uint32_t> oa, ob;
+        if (!OpuDisassembler::decodeKernel(ka[k], da, &oa) || !OpuDisassembler::decodeKernel(kb[k], db, &ob)) return;
+        for (size_t i = 0; i < std::max(da.instructions.size(), db.instructions.size()); ++i) {
+            const bool inA = i < da.instructions.size(), inB = i < db.instructions.size();
+            if (inA && inB && oa[i] == ob[i] && sameInstruction(da.instructions[i], db.instructions[i])) continue;
+            std::cerr << "  kernel '" << ka[k].name << "' instruction " << i << ": '"
+                      << (inA ? formatInstruction(da.instructions[i]) : "<none>") << "' (stall "
+                      << (inA ? da.instructions[i].stall : 0) << ") vs '"
+                      << (inB ? formatInstruction(db.instructions[i]) : "<none>") << "' (stall "
+                      << (inB ? db.instructions[i].stall : 0) << ")\n";
+            return;
+        }
+    }
+    std::cerr << "  code is identical; descriptors, arguments or relocations differ\n";
+}
+
+// A profile of `object` with counters at every PC, uneven so that some
+// instructions are hot and some never issue.
+bool writeProfile(const std::string& object, const std::string& profileFile) {
+    QuietLog quiet;
+    elf::ElfObjectReader reader(object);
+    if (!reader.read()) return false;
+    sim::ExecutionProfile profile;
+    for (const elf::KernelCode& code : reader.getCodeObject().kernels) {
+        Kernel kernel;
+        std::vector<uint32_t> offsets;
+        if (!OpuDisassembler::decodeKernel(code, kernel, &offsets)) return false;
+        sim::KernelProfile& counters = profile.kernels.emplace_back();
+        counters.name = code.name;
+        counters.workgroups = counters.waves = 1;
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+            const uint64_t count = (i * 7) % 5 == 0 ? 0 : 1 + (i * 13) % 64;
+            if (count) counters.pcs[offsets[i]] = {count, count * 32, count * kernel.instructions[i].stall, 0};
+        }
+    }
+    return utils::writeStringToFile(profileFile, profile.toText());
+}
+
+// object -> annotated listing (with a profile) -> object, byte for byte.
+bool annotatedRoundTrip(const std::string& source, const std::string& first, const std::filesystem::path& dir,
+                        const std::string& stem) {
+    const std::string profileFile = (dir / (stem + ".profile")).string();
+    const std::string listing = (dir / (stem + ".ann.coasm")).string();
+    const std::string second = (dir / (stem + ".ann.o")).string();
+
+    DisassemblerOptions options;
+    options.profileFile = profileFile;
+    bool disassembled = writeProfile(first, profileFile);
+    if (disassembled) {
+        QuietLog quiet;
+        OpuDisassembler disassembler(first, listing, options);
+        disassembled = disassembler.disassemble();
+    }
+    std::string text;
+    if (!disassembled || !utils::readFileToString(listing, text) || text.find("// profile: ") == std::string::npos) {
+        std::cerr << "RoundTrip Error: '" << first << "' does not disassemble with --profile\n";
+        return false;
+    }
+    if (!assembleFile(listing, second)) {
+        std::cerr << "RoundTrip Error: the annotated disassembly of '" << source << "' does not assemble\n";
+        return false;
+    }
+    if (!sameFile(first, second)) {
+        std::cerr << "RoundTrip Error: the annotated disassembly of '" << source << "' reassembles to different bytes\n";
+        explainMismatch(first, second);
+        return false;
+    }
+    return true;
+}
+
+// source -> object -> listing -> object, byte for byte.
+bool assemblerRoundTrip(const std::string& source, const std::filesystem::path& dir, const std::string& stem,
+                        PipelineResult& result) {
+    const std::string first = (dir / (stem + ".o")).string();
+    const std::string listing = (dir / (stem + ".dis.coasm")).string();
+    const std::string second = (dir / (stem + ".re.o")).string();
+
+    auto start = Clock::now();
+    if (!assembleFile(source, first)) {
+        std::cerr << "RoundTrip Error: '" << source << "' does not assemble\n";
+        return false;
+    }
+    result.assembleSeconds = secondsSince(start);
+
+    start = Clock::now();
+    {
+        QuietLog quiet;
+        OpuDisassembler disassembler(first, listing);
+        if (!disassembler.disassemble()) {
+            std::cerr << "RoundTrip Error: '" << first << "' does not disassemble\n";
+            return false;
+        }
+    }
+    result.disassembleSeconds = secondsSince(start);
+
+    start = Clock::now();
+    if (!assembleFile(listing, second)) {
+        std::cerr << "RoundTrip Error: the disassembly of '" << source << "' does not assemble\n";
+        return false;
+    }
+    result.reassembleSeconds = secondsSince(start);
+
+    std::string a, b;
+    if (!utils::readFileToString(source, a)) return false;
+    result.sourceBytes = a.size();
+    if (!utils::readFileToString(listing, a)) return false;
+    result.listingBytes = a.size();
+    if (!utils::readFileToString(first, a) || !utils::readFileToString(second, b)) return false;
+    result.codeBytes = a.size();
+    if (a != b) {
+        std::cerr << "RoundTrip Error: '" << source << "' reassembles to different bytes\n";
+        explainMismatch(first, second);
+        return false;
+    }
+    return annotatedRoundTrip(source, first, dir, stem);
+}
+
+// --- Assembly Modes ---
+
+// Assemble through OpuAssembler::assemble(), as the command line does.
+// `log` receives the progress output.
+bool assembleWith(const std::string& source, const std::string& object, const AssemblerOptions& options,
+                  std::string* log = nullptr) {
+    QuietLog quiet;
+    OpuAssembler assembler(source, object, options);
+    const bool ok = assembler.assemble();
+    if (log) *log = quiet.text();
+    return ok;
+}
+
+// The corpus listing rearranged the ways that make --stream's chunking hard:
+// a prologue before .text, the declarations of every other kernel hoisted
+// to the top, and the opu.kernels entries in reverse order.
+std::string rearranged(const std::string& listing) {
+    std::vector<std::string> lines = utils::split(listing, '\n');
+    std::vector<std::string> body, hoisted, entries, tail;
+    size_t kernel = 0;
+    bool inKernels = false;
+    for (const std::string& line : lines) {
+        const std::string text = utils::trim(line);
+        if (text == "opu.kernels:") {
+            inKernels = true;
+            body.push_back(line);
+            continue;
+        }
+        if (inKernels) {
+            if (text == "opu.version:") inKernels = false;
+            if (!inKernels) {
+                tail.push_back(line);
+            } else if (text.rfind("- .name:", 0) == 0) {
+                entries.push_back(line + "\n");
+            } else if (!entries.empty()) {
+                entries.back() += line + "\n";
+            } else {
+                body.push_back(line);
+            }
+            continue;
+        }
+        if (!tail.empty()) {
+            tail.push_back(line);
+            continue;
+        }
+        const bool declaration = text.rfind(".global", 0) == 0 || text.rfind(".type", 0) == 0;
+        if (declaration && kernel % 2 == 1) {
+            hoisted.push_back(line);
+        } else {
+            body.push_back(line);
+        }
+        if (text.rfind(".type", 0) == 0) ++kernel;
+    }
+
+    std::string out = "// Rearranged round-trip corpus\n\n";
+    for (const std::string& line : body) {
+        out += line + "\n";
+        if (utils::trim(line) == ".text") {
+            for (const std::string& declaration : hoisted) out += declaration + "\n";
+        }
+        if (utils::trim(line) == "opu.kernels:") {
+            for (auto it = entries.rbegin(); it != entries.rend(); ++it) out += *it;
+        }
+    }
+    for (const std::string& line : tail) out += line + "\n";
+    return out;
+}
+
+// --stream must write the object a normal assemble writes, byte for byte,
+// and reject what a normal assemble rejects.
+bool streamRoundTrip(const std::string& source, const std::filesystem::path& dir, const std::string& stem,
+                     bool expectValid = true) {
+    const std::string whole = (dir / (stem + ".whole.o")).string();
+    const std::string streamed = (dir / (stem + ".stream.o")).string();
+    AssemblerOptions options;
+    bool wholeOk, streamOk;
+    {
+        QuietLog quietErrors(expectValid ? std::clog : std::cerr);
+        wholeOk = assembleWith(source, whole, options);
+        options.streaming = true;
+        streamOk = assembleWith(source, streamed, options);
+    }
+    if (wholeOk != expectValid || streamOk != expectValid) {
+        std::cerr << "RoundTrip Error: '" << source << "' " << (expectValid ? "does not assemble" : "assembles")
+                  << (wholeOk == streamOk ? "" : streamOk ? " without --stream" : " with --stream") << "\n";
+        return false;
+    }
+    if (expectValid && !sameFile(whole, streamed)) {
+        std::cerr << "RoundTrip Error: '" << source << "' assembles to different bytes with --stream\n";
+        explainMismatch(whole, streamed);
+        return false;
+    }
+    return true;
+}
+
+// After one kernel of `listing` is edited, --incremental against the object
+// of the original must write the bytes a full assemble of the edit writes,
+// and must have reused the other kernels to get there.
+bool incrementalRoundTrip(const std::string& listing, const std::filesystem::path& dir) {
+    const std::string original = (dir / "incremental.coasm").string();
+    const std::string edited = (dir / "incremental.edited.coasm").string();
+    const std::string base = (dir / "incremental.base.o").string();
+    const std::string full = (dir / "incremental.full.o").string();
+    const std::string updated = (dir / "incremental.o").string();
+
+    const size_t label = listing.find("\nrt_kernel_1:\n");
+    if (label == std::string::npos) {
+        std::cerr << "RoundTrip Error: the corpus has no rt_kernel_1 to edit\n";
+        return false;
+    }
+    std::string changed = listing;
+    changed.insert(label + 14, "    s_nop\n");
+
+    AssemblerOptions options;
+    if (!utils::writeStringToFile(original, listing) || !utils::writeStringToFile(edited, changed) ||
+        !assembleWith(original, base, options) || !assembleWith(edited, full, options)) {
+        std::cerr << "RoundTrip Error: the incremental test sources do not assemble\n";
+        return false;
+    }
+    options.incrementalBase = base;
+    std::string log;
+    if (!assembleWith(edited, updated, options, &log)) {
+        std::cerr << "RoundTrip Error: '" << edited << "' does not assemble with --incremental\n";
+        return false;
+    }
+    if (!sameFile(full, updated)) {
+        std::cerr << "RoundTrip Error: --incremental after a one-kernel edit differs from a full assemble\n";
+        explainMismatch(full, updated);
+        return false;
+    }
+    const size_t reused = log.find("Info: Incremental: ");
+    if (reused == std::string::npos || std::atoi(log.c_str() + reused + 19) == 0) {
+        std::cerr << "RoundTrip Error: --incremental reused no kernel after a one-kernel edit\n";
+        return false;
+    }
+    return true;
+}
+
+std::string rate(double amount, double seconds, const char* unit) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << (seconds > 0 ? amount / seconds / 1e6 : 0.0) << " " << unit;
+    return out.str();
+}
+
+void printPipeline(const std::string& name, const PipelineResult& result) {
+    std::cout << "  " << name << ": assemble " << rate(result.sourceBytes, result.assembleSeconds, "MB/s")
+              << ", disassemble " << rate(result.codeBytes, result.disassembleSeconds, "MB/s")
+              << ", reassemble " << rate(result.listingBytes, result.reassembleSeconds, "MB/s") << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--kernels" && i + 1 < argc) {
+            options.kernels = std::atoi(argv[++i]);
+        } else if (arg == "--instructions" && i + 1 < argc) {
+            options.instructions = std::atoi(argv[++i]);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = std::atoi(argv[++i]);
+        } else if (arg == "--keep" && i + 1 < argc) {
+            options.keepDir = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--seed N] [--kernels N] [--instructions N] [--iterations N]"
+                      << " [--keep DIR] [file.coasm ...]\n";
+            return 2;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+
+    namespace fs = std::filesystem;
+    fs::path dir = options.keepDir;
+    if (dir.empty()) {
+        dir = test::makeScratchDirectory("opuas_roundtrip");
+        if (dir.empty()) {
+            std::cerr << "RoundTrip Error: could not create a scratch directory in "
+                      << fs::temp_directory_path() << "\n";
+            return 1;
+        }
+    } else {
+        fs::create_directories(dir);
+    }
+
+    const Program corpus = generateCorpus(options);
+    size_t instructions = 0;
+    for (const Kernel& kernel : corpus.kernels) instructions += kernel.instructions.size();
+    std::cout << "Round trip: seed " << options.seed << ", " << corpus.kernels.size() << " kernel(s), "
+              << instructions << " instruction(s), " << allVariants().size() << " opcode variant(s)\n";
+
+    bool ok = true;
+    std::map<isa::Format, FormatResult> formats;
+    ok = encodeDecodeRoundTrip(corpus, options, formats) && ok;
+    std::cout << "Encode/decode (" << options.iterations << " iteration(s)):\n";
+    for (isa::Format format : kFormats) {
+        const FormatResult& result = formats[format];
+        const double count = static_cast<double>(result.instructions) * options.iterations;
+        std::cout << "  " << std::left << std::setw(9) << formatName(format) << std::right << std::setw(7)
+                  << result.instructions << " instr  encode " << std::setw(16)
+                  << rate(count, result.encodeSeconds, "Minstr/s") << "  decode " << std::setw(16)
+                  << rate(count, result.decodeSeconds, "Minstr/s") << "\n";
+        if (result.instructions == 0) {
+            std::cerr << "RoundTrip Error: the corpus has no " << formatName(format) << " instruction\n";
+            ok = false;
+        }
+    }
+
+    std::ostringstream text;
+    OpuDisassembler::printProgram(corpus, text);
+    const std::string corpusFile = (dir / "corpus.coasm").string();
+    if (!utils::writeStringToFile(corpusFile, text.str())) return 1;
+
+    std::cout << "Assemble/disassemble/reassemble:\n";
+    PipelineResult pipeline;
+    if (assemblerRoundTrip(corpusFile, dir, "corpus", pipeline)) {
+        printPipeline("corpus", pipeline);
+    } else {
+        ok = false;
+    }
+    for (const std::string& file : options.files) {
+        const std::string stem = fs::path(file).stem().string();
+        if (assemblerRoundTrip(file, dir, stem, pipeline)) {
+            printPipeline(file, pipeline);
+        } else {
+            ok = false;
+        }
+    }
+
+    std::cout << "Assembly modes:\n";
+    bool modesOk = streamRoundTrip(corpusFile, dir, "corpus");
+    const std::string rearrangedFile = (dir / "rearranged.coasm").string();
+    const std::string rearrangedText = rearranged(text.str());
+    modesOk = utils::writeStringToFile(rearrangedFile, rearrangedText) &&
+              streamRoundTrip(rearrangedFile, dir, "rearranged") && modesOk;
+    const std::string orphanFile = (dir / "orphan.coasm").string();
+    std::string orphanText = rearrangedText;
+    orphanText.insert(orphanText.find("opu.kernels:\n") + 13, " - .name: rt_no_such_kernel\n");
+    modesOk = utils::writeStringToFile(orphanFile, orphanText) &&
+              streamRoundTrip(orphanFile, dir, "orphan", false) && modesOk;
+    for (const std::string& file : options.files) {
+        modesOk = streamRoundTrip(file, dir, fs::path(file).stem().string()) && modesOk;
+    }
+    std::cout << "  --stream: " << (modesOk ? "same bytes as a whole-file assemble" : "FAILED") << "\n";
+    ok = modesOk && ok;
+    const bool incrementalOk = incrementalRoundTrip(text.str(), dir);
+    std::cout << "  --incremental: " << (incrementalOk ? "same bytes as a full assemble after a one-kernel edit"
+                                                       : "FAILED") << "\n";
+    ok = incrementalOk && ok;
+
+    if (options.keepDir.empty()) fs::remove_all(dir);
+    std::cout << (ok ? "Round trip PASSED\n" : "Round trip FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+// opuas/test/TestSupport.h
+//
+// Helpers shared by the test programs.
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+namespace opuas {
+namespace test {
+
+// Swallows the progress output of the assembler, disassembler and simulator
+// (std::clog) while in scope; errors still reach std::cerr unless it is
+// silenced as well.
+class QuietLog {
+public:
+    explicit QuietLog(std::ostream& stream = std::clog) : stream_(stream), saved_(stream.rdbuf(sink_.rdbuf())) {}
+    ~QuietLog() { stream_.rdbuf(saved_); }
+    QuietLog(const QuietLog&) = delete;
+    QuietLog& operator=(const QuietLog&) = delete;
+
+    std::string text() const { return sink_.str(); }
+
+private:
+    std::ostringstream sink_;
+    std::ostream& stream_;
+    std::streambuf* saved_;
+};
+
+// A new directory "<prefix>_<random>" under the system temporary directory;
+// concurrent runs each get their own. Empty on failure.
+inline std::filesystem::path makeScratchDirectory(const std::string& prefix) {
+    namespace fs = std::filesystem;
+    std::random_device entropy;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::ostringstream name;
+        name << prefix << "_" << std::hex << entropy() << entropy();
+        const fs::path dir = fs::temp_directory_path() / name.str();
+        std::error_code error;
+        if (fs::create_directory(dir, error)) return dir;
+    }
+    return {};
+}
+
+} // namespace test
+} // namespace opuas
+
+#endif // TEST_SUPPORT_H
@@ -7,8 +7,7 @@
 SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
 PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
 BUILD_DIR="$PROJECT_ROOT/build"
-TEST_INPUT="$SCRIPT_DIR/test_simple.coasm"
-TEST_OUTPUT="$SCRIPT_DIR/test_output.asm" # Or .o, .cubin
+TEST_INPUT="$SCRIPT_DIR/test_simple.asm"
 
 echo "Testing opuas project..."
 
@@ -28,17 +27,17 @@ cd "$BUILD_DIR" || exit 1
 make clean # Optional, for a clean test
 make || { echo "Build failed!"; exit 1; }
 
-# --- 3. Run the test ---
-echo "Running assembly test on '$TEST_INPUT'..."
-./opuas assemble "$TEST_INPUT" "$TEST_OUTPUT"
+# --- 3. Run the round-trip test ---
+# Generated kernels covering every opcode and format, plus the sample input,
+# go through assemble -> disassemble -> assemble and must come back byte for
+# byte. Encode/decode throughput per format is printed along the way.
+echo "Running round-trip test..."
+./opuas_roundtrip "$@" "$TEST_INPUT"
 
 if [ $? -eq 0 ]; then
-    echo "Test PASSED: opuas successfully assembled '$TEST_INPUT'."
-    echo "Output written to '$TEST_OUTPUT'."
-    echo "Contents of '$TEST_OUTPUT':"
-    cat "$TEST_OUTPUT"
+    echo "Test PASSED: generated kernels and '$TEST_INPUT' reassemble to identical objects."
 else
-    echo "Test FAILED: opuas failed to assemble '$TEST_INPUT'."
+    echo "Test FAILED: see the round-trip errors above."
     exit 1
 fi
 
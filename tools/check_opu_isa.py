@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# opuas/tools/check_opu_isa.py
+#
+# Build-time check that src/isa/OpuIsa.def still matches coasm_infra's
+# coasm_isa.md. The assembler, disassembler and simulator all decode with
+# OpuIsa.def, so an opcode added, renamed or reformatted in the ISA document
+# must fail the build until the table follows.
+#
+# Checks:
+#   - every mnemonic in OpuIsa.def appears in coasm_isa.md;
+#   - every instruction row of a coasm_isa.md table whose first column is
+#     "Instruction", "Opcode" or "Mnemonic" names an opcode in OpuIsa.def;
+#   - where such a table has a "Format" column, it agrees with OpuIsa.def.
+#
+# Usage: check_opu_isa.py <OpuIsa.def> <coasm_isa.md> [stamp_file]
+
+import os
+import re
+import sys
+
+OPCODE_RE = re.compile(r'^\s*OPU_OPCODE\(\s*(\w+)\s*,\s*"([^"]+)"\s*,\s*(\w+)\s*,\s*(\w+)\s*,\s*(\w+)\s*\)')
+NAME_COLUMNS = ("instruction", "opcode", "mnemonic")
+
+
+def read_def(path):
+    table = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = OPCODE_RE.match(line)
+            if m:
+                table[m.group(2)] = m.group(3)
+    return table
+
+
+def cells(row):
+    return [c.strip().strip("`").strip() for c in row.strip().strip("|").split("|")]
+
+
+def read_tables(path):
+    """Yields (line number, mnemonic, format or None) for instruction rows."""
+    with open(path, encoding="utf-8") as f:
+        lines = f.readlines()
+    header = None
+    for number, line in enumerate(lines, 1):
+        if not line.lstrip().startswith("|"):
+            header = None
+            continue
+        row = cells(line)
+        if header is None:
+            header = [c.lower() for c in row]
+            continue
+        if all(re.fullmatch(r":?-+:?", c) for c in row if c):
+            continue
+        if header[0] not in NAME_COLUMNS or not row[0]:
+            continue
+        # "set_tcc.<cmp>.<type>" documents suffixes; the opcode is the first part.
+        mnemonic = row[0].split()[0].split(".")[0]
+        fmt = None
+        if "format" in header and header.index("format") < len(row):
+            fmt = row[header.index("format")] or None
+        yield number, mnemonic, fmt
+
+
+def main(argv):
+    if len(argv) not in (3, 4):
+        sys.stderr.write("Usage: check_opu_isa.py <OpuIsa.def> <coasm_isa.md> [stamp_file]\n")
+        return 2
+    def_path, md_path = argv[1], argv[2]
+    table = read_def(def_path)
+    if not table:
+        sys.stderr.write("ISA Check Error: no OPU_OPCODE entries in '%s'\n" % def_path)
+        return 1
+    with open(md_path, encoding="utf-8") as f:
+        document = f.read()
+
+    errors = []
+    for mnemonic in table:
+        if not re.search(r"(?<![\w.])" + re.escape(mnemonic) + r"(?!\w)", document):
+            errors.append("'%s' is in OpuIsa.def but not in coasm_isa.md" % mnemonic)
+    name = os.path.basename(md_path)
+    rows = 0
+    for number, mnemonic, fmt in read_tables(md_path):
+        rows += 1
+        if mnemonic not in table:
+            errors.append("%s:%d: '%s' has no entry in OpuIsa.def" % (name, number, mnemonic))
+        elif fmt and fmt.upper() != table[mnemonic].upper():
+            errors.append("%s:%d: '%s' is %s, OpuIsa.def says %s" % (name, number, mnemonic, fmt, table[mnemonic]))
+    if rows == 0:
+        sys.stderr.write("ISA Check Warning: no instruction table in '%s'; only mnemonics were checked\n" % md_path)
+
+    for error in errors:
+        sys.stderr.write("ISA Check Error: %s\n" % error)
+    if errors:
+        sys.stderr.write("ISA Check Error: update src/isa/OpuIsa.def to match '%s'\n" % md_path)
+        return 1
+    if len(argv) == 4:
+        with open(argv[3], "w", encoding="utf-8") as f:
+            f.write("%d opcodes checked\n" % len(table))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))